@@ -114,142 +114,157 @@ string Cfg::which_undef_read() const {
 }
 
 void Cfg::recompute_blocks() {
-  blocks_.clear();
+  auto& blocks = blocks_.reset();
+  auto& boundaries = boundaries_.reset();
 
-  boundaries_.resize_for_bits(get_code().size() + 1);
-  boundaries_.reset();
+  blocks.clear();
+
+  boundaries.resize_for_bits(get_code().size() + 1);
+  boundaries.reset();
 
   // We know a-priori that these are boundaries
-  boundaries_[0] = true;
-  boundaries_[get_code().size()] = true;
+  boundaries[0] = true;
+  boundaries[get_code().size()] = true;
 
   // Labels define the beginning of blocks; jumps and returns define the ends. */
   for (size_t i = 0, ie = get_code().size(); i < ie; ++i) {
     const auto& instr = get_code()[i];
     if (instr.is_label_defn()) {
-      boundaries_[i] = true;
+      boundaries[i] = true;
     } else if (instr.is_jump() || instr.is_return()) {
-      boundaries_[i + 1] = true;
+      boundaries[i + 1] = true;
     }
   }
 
   // Add sentinels for entry and exit blocks along with boundaries
-  blocks_.push_back(0);
-  for (auto i = boundaries_.set_bit_index_begin(), ie = boundaries_.set_bit_index_end(); i != ie;
+  blocks.push_back(0);
+  for (auto i = boundaries.set_bit_index_begin(), ie = boundaries.set_bit_index_end(); i != ie;
        ++i) {
-    blocks_.push_back(*i);
+    blocks.push_back(*i);
   }
-  blocks_.push_back(get_code().size());
+  blocks.push_back(get_code().size());
 }
 
 void Cfg::recompute_labels() {
-  labels_.clear();
+  auto& labels = labels_.reset();
+  labels.clear();
   for (auto i = get_entry() + 1, ie = get_exit(); i < ie; ++i) {
     if (num_instrs(i) > 0) {
       const auto& instr = get_code()[get_index({i, 0})];
       if (instr.is_label_defn()) {
-        labels_[instr.get_operand<Label>(0)] = i;
+        labels[instr.get_operand<Label>(0)] = i;
       }
     }
   }
 }
 
 void Cfg::recompute_succs() {
-  succs_.resize(num_blocks());
-  for (auto& s : succs_) {
+  auto& succs = succs_.reset();
+  succs.resize(num_blocks());
+  for (auto& s : succs) {
     s.clear();
   }
 
   for (auto i = get_entry(), ie = get_exit(); i < ie; ++i) {
     // Control passes from empty blocks to the next.
     if (num_instrs(i) == 0) {
-      succs_[i].push_back(i + 1);
+      succs[i].push_back(i + 1);
       continue;
     }
     // Control passes from return statements to the exit.
     const auto& instr = get_code()[get_index({i, num_instrs(i) - 1})];
     if (instr.is_return()) {
-      succs_[i].push_back(get_exit());
+      succs[i].push_back(get_exit());
       continue;
     }
     // Conditional jump targets are always listed second in succs_.
-    const auto itr = labels_.find(instr.get_operand<Label>(0));
-    const auto dest = itr == labels_.end() ? get_exit() : itr->second;
+    const auto itr = labels_.get().find(instr.get_operand<Label>(0));
+    const auto dest = itr == labels_.get().end() ? get_exit() : itr->second;
     if (instr.is_uncond_jump()) {
-      succs_[i].push_back(dest);
+      succs[i].push_back(dest);
     } else {
-      succs_[i].push_back(i + 1);
+      succs[i].push_back(i + 1);
       if (instr.is_cond_jump()) {
-        succs_[i].push_back(dest);
+        succs[i].push_back(dest);
       }
     }
   }
 }
 
 void Cfg::recompute_preds() {
-  preds_.resize(num_blocks());
-  for (auto& p : preds_) {
+  auto& preds = preds_.reset();
+  preds.resize(num_blocks());
+  for (auto& p : preds) {
     p.clear();
   }
 
   for (auto i = get_entry(), ie = get_exit(); i < ie; ++i) {
     for (auto s = succ_begin(i), se = succ_end(i); s != se; ++s) {
-      preds_[*s].push_back(i);
+      preds[*s].push_back(i);
     }
   }
 }
 
 void Cfg::recompute_reachable() {
-  reachable_.resize_for_bits(num_blocks());
-  reachable_.reset();
+  auto& reachable = reachable_.reset();
+  auto& work_list = work_list_;
+
+  reachable.resize_for_bits(num_blocks());
+  reachable.reset();
 
-  work_list_.clear();
+  work_list.clear();
 
-  work_list_.push_back(get_entry());
-  reachable_[get_entry()] = true;
+  work_list.push_back(get_entry());
+  reachable[get_entry()] = true;
 
-  for (size_t i = 0; i < work_list_.size(); ++i) {
-    const auto next = work_list_[i];
+  for (size_t i = 0; i < work_list.size(); ++i) {
+    const auto next = work_list[i];
     for (auto s = succ_begin(next), se = succ_end(next); s != se; ++s) {
-      if (!reachable_[*s]) {
-        reachable_[*s] = true;
-        work_list_.push_back(*s);
+      if (!reachable[*s]) {
+        reachable[*s] = true;
+        work_list.push_back(*s);
       }
     }
   }
 }
 
 void Cfg::recompute_defs_gen_kill() {
-  gen_.assign(num_blocks(), RegSet::empty());
-  kill_.assign(num_blocks(), RegSet::empty());
+  auto& gen = gen_.reset();
+  auto& kill = kill_.reset();
+
+  gen.assign(num_blocks(), RegSet::empty());
+  kill.assign(num_blocks(), RegSet::empty());
 
   // No sense in checking the entry; we'll consider the exit, but it'll be a nop.
   for (auto i = ++reachable_begin(), ie = reachable_end(); i != ie; ++i) {
     for (auto j = instr_begin(*i), je = instr_end(*i); j != je; ++j) {
-      gen_[*i] |= must_write_set(*j);
-      gen_[*i] -= maybe_undef_set(*j);
+      gen[*i] |= must_write_set(*j);
+      gen[*i] -= maybe_undef_set(*j);
 
-      kill_[*i] |= maybe_undef_set(*j);
-      kill_[*i] -= maybe_write_set(*j);
+      kill[*i] |= maybe_undef_set(*j);
+      kill[*i] -= maybe_write_set(*j);
     }
   }
 }
 void Cfg::recompute_defs() {
   recompute_defs_gen_kill();
 
+  auto& def_ins = def_ins_.reset();
+  auto& def_outs = def_outs_.reset();
+
   // Need a little extra room for def_ins_[get_exit()]
   // You'll notice that this function uses blocks_[...] instead of get_index(...)
   // This is to subvert the assertion we'd blow for trying to call get_index(get_exit(),0)
 
-  def_ins_.resize(get_code().size() + 1, RegSet::empty());
-  def_outs_.resize(num_blocks(), RegSet::empty());
+  def_ins.resize(get_code().size() + 1, RegSet::empty());
+  def_outs.resize(num_blocks(), RegSet::empty());
 
   // Boundary conditions
-  def_outs_[get_entry()] = fxn_def_ins_;
+  def_outs[get_entry()] = fxn_def_ins_;
 
   // Initial conditions
   for (auto i = ++reachable_begin(), ie = reachable_end(); i != ie; ++i) {
-    def_outs_[*i] = RegSet::universe();
+    def_outs[*i] = RegSet::universe();
   }
 
   // Iterate until fixed point
@@ -258,18 +273,18 @@ void Cfg::recompute_defs() {
 
     for (auto i = ++reachable_begin(), ie = reachable_end(); i != ie; ++i) {
       // Meet operator
-      def_ins_[blocks_[*i]] = RegSet::universe();
+      def_ins[blocks_[*i]] = RegSet::universe();
       for (auto p = pred_begin(*i), pe = pred_end(*i); p != pe; ++p) {
         if (is_reachable(*p)) {
-          def_ins_[blocks_[*i]] &= def_outs_[*p];
+          def_ins[blocks_[*i]] &= def_outs[*p];
         }
       }
       // Transfer function
-      const auto new_out = (def_ins_[blocks_[*i]] - kill_[*i]) | gen_[*i];
+      const auto new_out = (def_ins[blocks_[*i]] - kill_[*i]) | gen_[*i];
 
       // Check for fixed point
-      changed |= def_outs_[*i] != new_out;
-      def_outs_[*i] = new_out;
+      changed |= def_outs[*i] != new_out;
+      def_outs[*i] = new_out;
     }
   }
 
@@ -277,11 +292,11 @@ void Cfg::recompute_defs() {
   for (auto i = ++reachable_begin(), ie = reachable_end(); i != ie; ++i) {
     for (size_t j = 1, je = num_instrs(*i); j < je; ++j) {
       const auto idx = blocks_[*i] + j;
-      def_ins_[idx] = def_ins_[idx - 1];
+      def_ins[idx] = def_ins[idx - 1];
 
       const auto& instr = get_code()[idx - 1];
-      def_ins_[idx] |= must_write_set(instr);
-      def_ins_[idx] -= maybe_undef_set(instr);
+      def_ins[idx] |= must_write_set(instr);
+      def_ins[idx] -= maybe_undef_set(instr);
     }
   }
 }
@@ -289,9 +304,12 @@ void Cfg::recompute_defs() {
 void Cfg::recompute_liveness() {
   recompute_liveness_use_kill();
 
+  auto& live_ins = live_ins_.reset();
+  auto& live_outs = live_outs_.reset();
+
   // IMPORTANT NOTE: both vectors indexed by code size
-  live_ins_.assign(get_code().size() + 1, RegSet::empty());
-  live_outs_.assign(get_code().size() + 1, RegSet::empty());
+  live_ins.assign(get_code().size() + 1, RegSet::empty());
+  live_outs.assign(get_code().size() + 1, RegSet::empty());
 
   // If we ever encounter an indirect jump, we need to assume that everything
   // which we ever use (i.e. read) becomes live-out at that point.  So, let's
@@ -325,7 +343,7 @@ void Cfg::recompute_liveness() {
     }
 
     // Set the live-in of each block to the empty set.
-    live_ins_[blocks_[*i]] = RegSet::empty();
+    live_ins[blocks_[*i]] = RegSet::empty();
 
     // Set the live-out of each block to the empty set.  this requires
     // looking up the index of the last instruction in the block.  Except if
@@ -334,12 +352,12 @@ void Cfg::recompute_liveness() {
     size_t last_instr_index = blocks_[*i] + num_instrs(*i) - 1;
     Instruction last_instr = get_code()[last_instr_index];
     if (last_instr.is_any_indirect_jump()) {
-      live_outs_[last_instr_index] = ever_read;
+      live_outs[last_instr_index] = ever_read;
     } else {
-      live_outs_[last_instr_index] = RegSet::empty();
+      live_outs[last_instr_index] = RegSet::empty();
     }
   }
-  live_ins_[blocks_[get_exit()]] = fxn_live_outs_;
+  live_ins[blocks_[get_exit()]] = fxn_live_outs_;
 
   // Fixedpoint algorithm
   for (auto changed = true; changed;) {
@@ -359,14 +377,14 @@ void Cfg::recompute_liveness() {
       size_t last_instr_index = blocks_[*i] + num_instrs(*i) - 1;
       Instruction last_instr = get_code()[last_instr_index];
       if (last_instr.is_any_indirect_jump()) {
-        live_outs_[last_instr_index] = ever_read;
+        live_outs[last_instr_index] = ever_read;
       } else {
-        live_outs_[last_instr_index] = RegSet::empty();
+        live_outs[last_instr_index] = RegSet::empty();
       }
 
       for (auto s = succ_begin(*i), si = succ_end(*i); s != si; ++s) {
         if (is_reachable(*s)) {
-          live_outs_[last_instr_index] |= live_ins_[blocks_[*s]];
+          live_outs[last_instr_index] |= live_ins[blocks_[*s]];
         }
       }
 
@@ -374,19 +392,19 @@ void Cfg::recompute_liveness() {
       // Take the live outs at the end of the block, remove the
       // kill set, and union in the use set.
       const auto new_in =
-        (live_outs_[blocks_[*i] + num_instrs(*i) - 1] - liveness_kill_[*i]) |
+        (live_outs[blocks_[*i] + num_instrs(*i) - 1] - liveness_kill_[*i]) |
         liveness_use_[*i];
 
-      changed |= live_ins_[blocks_[*i]] != new_in;
+      changed |= live_ins[blocks_[*i]] != new_in;
 #ifdef DEBUG_CFG_LIVENESS
       if (changed) {
-        cout << "block " << *i << " from " << live_ins_[blocks_[*i]] << " --> " << new_in << endl;
-        cout << "   " << "live out: " << live_outs_[blocks_[*i] + num_instrs(*i) - 1] << endl;
+        cout << "block " << *i << " from " << live_ins[blocks_[*i]] << " --> " << new_in << endl;
+        cout << "   " << "live out: " << live_outs[blocks_[*i] + num_instrs(*i) - 1] << endl;
         cout << "   " << "kill: " << liveness_kill_[*i] << endl;
         cout << "   " << "use:  " << liveness_use_[*i] << endl;
       }
 #endif
-      live_ins_[blocks_[*i]] = new_in;
+      live_ins[blocks_[*i]] = new_in;
     }
   }
 
@@ -401,14 +419,14 @@ void Cfg::recompute_liveness() {
     // Update the live outs for each
     for (int j = num_instrs(*i) - 2; j >= 0; --j) {
       const auto idx = blocks_[*i] + j;
-      live_outs_[idx] = live_outs_[idx + 1];
+      live_outs[idx] = live_outs[idx + 1];
 
       const auto& instr = get_code()[idx + 1];
-      live_outs_[idx] -= must_write_set(instr);
-      live_outs_[idx] -= must_undef_set(instr);
-      live_outs_[idx] |= maybe_read_set(instr);
+      live_outs[idx] -= must_write_set(instr);
+      live_outs[idx] -= must_undef_set(instr);
+      live_outs[idx] |= maybe_read_set(instr);
 
-      live_ins_[idx + 1] = live_outs_[idx];
+      live_ins[idx + 1] = live_outs[idx];
     }
   }
 
@@ -416,22 +434,25 @@ void Cfg::recompute_liveness() {
 
 
 void Cfg::recompute_liveness_use_kill() {
-  liveness_use_.assign(num_blocks(), RegSet::empty());
-  liveness_kill_.assign(num_blocks(), RegSet::empty());
+  auto& use = liveness_use_.reset();
+  auto& kill = liveness_kill_.reset();
+
+  use.assign(num_blocks(), RegSet::empty());
+  kill.assign(num_blocks(), RegSet::empty());
 
   // No sense in checking the entry; we'll consider the exit, but it'll be a nop.
   for (auto i = reachable_begin(), ie = reachable_end(); i != ie; ++i) {
     for (auto j = instr_begin(*i), je = instr_end(*i); j != je; ++j) {
 
       /*      if(j->is_call()) {
-              liveness_use_[*i] |= (RegSet::linux_call_parameters() - liveness_kill_[*i]);
-              liveness_kill_[*i] |= RegSet::linux_call_scratch();
+              use[*i] |= (RegSet::linux_call_parameters() - kill[*i]);
+              kill[*i] |= RegSet::linux_call_scratch();
 
             } else {*/
-      liveness_use_[*i] |= (maybe_read_set(*j) - liveness_kill_[*i]);
+      use[*i] |= (maybe_read_set(*j) - kill[*i]);
 
-      liveness_kill_[*i] |= must_undef_set(*j);
-      liveness_kill_[*i] |= must_write_set(*j);
+      kill[*i] |= must_undef_set(*j);
+      kill[*i] |= must_write_set(*j);
       //      }
     }
   }
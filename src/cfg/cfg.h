@@ -24,6 +24,7 @@
 #include <unordered_map>
 #include <vector>
 
+#include "src/tunit/cow.h"
 #include "src/tunit/tunit.h"
 
 #include "src/ext/cpputil/include/container/bit_vector.h"
@@ -90,6 +91,9 @@ public:
     this relation, calling this method will restore it. Undefined if graph structure is not up to
     date. */
   void recompute_defs();
+  /** Recomputes liveness; modifying an instruction will invalidate it, calling this method will
+    restore it. Undefined if graph structure is not up to date. */
+  void recompute_liveness();
 
   /** Return a reference to the function underlying this graph. */
   TUnit& get_function() {
@@ -213,11 +217,11 @@ public:
   }
   /** Returns an iterator that points to the beginning of this graph's reachable block list. */
   reachable_iterator reachable_begin() const {
-    return reachable_.set_bit_index_begin();
+    return reachable_->set_bit_index_begin();
   }
   /** Returns an iterator that points to the end of this graph's reachable block list. */
   reachable_iterator reachable_end() const {
-    return reachable_.set_bit_index_end();
+    return reachable_->set_bit_index_end();
   }
 
   /** Returns true if control can proceed normally from the entry block to this block. */
@@ -423,45 +427,48 @@ private:
   /** User-specified registers that are defined on exit from this graph. */
   x64asm::RegSet fxn_live_outs_;
 
+  // The Cow tables below are shared between a Cfg and its copies, and a table is only duplicated
+  // when one of the copies recomputes it.  Scratch space is kept in plain containers.
+
   // This temporary state is maintained to reduce the overhead of repeated allocations
 
   /** A set of indices that correspond to the beginning of basic blocks. */
-  cpputil::BitVector boundaries_;
+  Cow<cpputil::BitVector> boundaries_;
   /** A stack of basic block ids. */
   std::stack<size_t, std::vector<size_t>> block_stack_;
   /** A list of remaining predecessors for each block. */
   std::vector<size_t> remaining_preds_;
   /** A map from labels to the basic blocks they mark the beginning of. */
-  std::unordered_map<x64asm::Label, size_t> labels_;
+  Cow<std::unordered_map<x64asm::Label, size_t>> labels_;
 
   /** A list of the indices that correspond to the first instruction in each basic block. */
-  std::vector<size_t> blocks_;
+  Cow<std::vector<size_t>> blocks_;
   /** Basic block predecessor lists. */
-  std::vector<std::vector<id_type>> preds_;
+  Cow<std::vector<std::vector<id_type>>> preds_;
   /** Basic block successor lists. */
-  std::vector<std::vector<id_type>> succs_;
+  Cow<std::vector<std::vector<id_type>>> succs_;
   /** The set of reachable basic blocks. */
-  cpputil::BitVector reachable_;
-  /** Scratch space for computing reachability. */
+  Cow<cpputil::BitVector> reachable_;
+  /** Scratch space for computing reachability (not worth sharing). */
   std::vector<id_type> work_list_;
 
   /** The set of registers defined in for every instruction. The final element refers to the exit block. */
-  std::vector<x64asm::RegSet> def_ins_;
+  Cow<std::vector<x64asm::RegSet>> def_ins_;
   /** The set of registers defined out of every block. */
-  std::vector<x64asm::RegSet> def_outs_;
+  Cow<std::vector<x64asm::RegSet>> def_outs_;
   /** The gen set for each block. */
-  std::vector<x64asm::RegSet> gen_;
+  Cow<std::vector<x64asm::RegSet>> gen_;
   /** The kill set for each block. */
-  std::vector<x64asm::RegSet> kill_;
+  Cow<std::vector<x64asm::RegSet>> kill_;
 
   /** The set of registers live out for every instruction. The final element refers to the exit block. */
-  std::vector<x64asm::RegSet> live_outs_;
+  Cow<std::vector<x64asm::RegSet>> live_outs_;
   /** The set of registers live in at each instruction */
-  std::vector<x64asm::RegSet> live_ins_;
+  Cow<std::vector<x64asm::RegSet>> live_ins_;
   /** The use set for each block. */
-  std::vector<x64asm::RegSet> liveness_use_;
+  Cow<std::vector<x64asm::RegSet>> liveness_use_;
   /** The def set for each block. */
-  std::vector<x64asm::RegSet> liveness_kill_;
+  Cow<std::vector<x64asm::RegSet>> liveness_kill_;
 
   /** Recompute the indices in blocks_. */
   void recompute_blocks();
@@ -479,8 +486,6 @@ private:
   void recompute_defs_gen_kill();
   /** Recomputes the use and defs set used for liveness */
   void recompute_liveness_use_kill();
-  /** Recomputes live_outs_ using the generic LFP dataflow algorithm */
-  void recompute_liveness();
 
   /** Used to get sizes of instructions for invariant checks. */
   static x64asm::Assembler assembler_;
@@ -0,0 +1,119 @@
+// Copyright 2013-2016 Stanford University
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "src/cfg/sccs.h"
+#include "src/cost/avx_transition.h"
+
+using namespace std;
+using namespace x64asm;
+
+namespace stoke {
+
+bool AvxTransitionCost::is_avx256(const Instruction& instr) {
+  for (size_t i = 0, ie = instr.arity(); i < ie; ++i) {
+    if (instr.type(i) == Type::YMM || instr.type(i) == Type::M_256) {
+      return true;
+    }
+  }
+  return false;
+}
+
+Cost AvxTransitionCost::transfer(const Instruction& instr, uint8_t& state) {
+  const auto opcode = instr.get_opcode();
+  if (opcode == VZEROUPPER || opcode == VZEROALL) {
+    state = CLEAN;
+    return 0;
+  }
+
+  // Callers expect clean upper state when we return
+  if (instr.is_any_return()) {
+    return (state & DIRTY) ? 1 : 0;
+  }
+
+  // Legacy SSE (including an ABI-conforming callee) saves dirty upper state
+  const auto vex = instr.is_avx() || instr.is_avx2();
+  if ((instr.is_sse() && !vex) || instr.is_any_call()) {
+    if (state & DIRTY) {
+      state = (state & ~DIRTY) | SAVED;
+      return 1;
+    }
+    return 0;
+  }
+
+  // Any VEX instruction restores saved upper state; 256-bit ones also dirty it
+  if (vex) {
+    Cost res = 0;
+    if (state & SAVED) {
+      state = (state & ~SAVED) | DIRTY;
+      res = 1;
+    }
+    if (is_avx256(instr)) {
+      state = DIRTY;
+    }
+    return res;
+  }
+
+  return 0;
+}
+
+AvxTransitionCost::result_type AvxTransitionCost::operator()(const Cfg& cfg, Cost max) {
+  const auto& code = cfg.get_code();
+
+  // Forward may-analysis; the function is entered with clean upper state.
+  ins_.assign(cfg.num_blocks(), 0);
+  ins_[cfg.get_entry()] = CLEAN;
+  for (bool changed = true; changed;) {
+    changed = false;
+    for (auto b = cfg.reachable_begin(), be = cfg.reachable_end(); b != be; ++b) {
+      auto state = ins_[*b];
+      if (cfg.num_instrs(*b) > 0) {
+        const auto first = cfg.get_index(Cfg::loc_type(*b, 0));
+        for (size_t i = first, ie = first + cfg.num_instrs(*b); i < ie; ++i) {
+          transfer(code[i], state);
+        }
+      }
+      for (auto s = cfg.succ_begin(*b), se = cfg.succ_end(*b); s != se; ++s) {
+        if ((ins_[*s] | state) != ins_[*s]) {
+          ins_[*s] |= state;
+          changed = true;
+        }
+      }
+    }
+  }
+
+  // Count the transitions that each block may cause.
+  CfgSccs sccs(cfg);
+  Cost cost = 0;
+  for (auto b = cfg.reachable_begin(), be = cfg.reachable_end(); b != be; ++b) {
+    if (cfg.num_instrs(*b) == 0) {
+      continue;
+    }
+
+    auto state = ins_[*b];
+    Cost block_cost = 0;
+    const auto first = cfg.get_index(Cfg::loc_type(*b, 0));
+    for (size_t i = first, ie = first + cfg.num_instrs(*b); i < ie; ++i) {
+      block_cost += transfer(code[i], state);
+    }
+
+    cost += sccs.in_scc(*b) ? block_cost * loop_penalty_ : block_cost;
+    if (cost >= max) {
+      return result_type(true, max);
+    }
+  }
+
+  return result_type(true, cost);
+}
+
+} // namespace stoke
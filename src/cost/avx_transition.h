@@ -0,0 +1,71 @@
+// Copyright 2013-2016 Stanford University
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef STOKE_SRC_COST_AVX_TRANSITION_H
+#define STOKE_SRC_COST_AVX_TRANSITION_H
+
+#include <vector>
+
+#include "src/cost/cost_function.h"
+
+namespace stoke {
+
+/** Counts SSE/AVX state transitions (rule 71 in the Intel Optimization Manual).
+  The state of the upper halves of the ymm registers is tracked with a forward
+  dataflow analysis over the cfg.  A 256-bit AVX instruction dirties the upper
+  state; vzeroupper and vzeroall clean it.  Executing a legacy SSE instruction
+  with dirty upper state costs a transition, as does going back to 256-bit AVX
+  afterwards.  Calls and returns are treated as boundaries to code that follows
+  the ABI convention of using legacy SSE with clean upper state.  Transitions
+  inside loops are multiplied by the loop penalty. */
+class AvxTransitionCost : public CostFunction {
+public:
+  /** Creates a new cost function. */
+  AvxTransitionCost() {
+    set_loop_penalty(5);
+  }
+
+  /** Set the multiplier for transitions that occur inside of a loop. */
+  AvxTransitionCost& set_loop_penalty(Cost penalty) {
+    loop_penalty_ = penalty;
+    return *this;
+  }
+
+  /** Returns the weighted number of transitions in a rewrite. */
+  result_type operator()(const Cfg& cfg, Cost max = max_cost);
+
+private:
+  /** The set of states that the upper halves of the ymm registers may be in. */
+  enum State {
+    CLEAN = 0x1,
+    DIRTY = 0x2,
+    SAVED = 0x4
+  };
+
+  /** The multiplier for transitions inside of loops. */
+  Cost loop_penalty_;
+
+  /** Per-block entry states for the most recent cfg. */
+  std::vector<uint8_t> ins_;
+
+  /** Applies the effect of an instruction to a set of states; returns the number of
+    transitions it may cause. */
+  static Cost transfer(const x64asm::Instruction& instr, uint8_t& state);
+  /** Does this instruction use 256-bit vector operands? */
+  static bool is_avx256(const x64asm::Instruction& instr);
+};
+
+} // namespace stoke
+
+#endif
@@ -17,8 +17,11 @@
 #include <algorithm>
 #include <array>
 #include <limits>
+#include <numeric>
 
+#include "src/cfg/sccs.h"
 #include "src/cost/correctness.h"
+#include "src/cost/reference_cache.h"
 #include "src/ext/x64asm/include/x64asm.h"
 
 using namespace cpputil;
@@ -38,12 +41,48 @@ CorrectnessCost& CorrectnessCost::set_target(const Cfg& target, bool stack_out,
   reference_out_.clear();
   recompute_target_defs(target.live_outs());
 
+  // The reference run doubles as the trace of the target's loop heads
+  cutpoint_gp_.clear();
+  cutpoint_sse_.clear();
+  if (cutpoints_) {
+    const auto lines = loop_heads(target);
+    for (auto l : lines) {
+      const auto live = target.live_ins(target.get_loc(l));
+      cutpoint_gp_.push_back({});
+      for (size_t r = 0; r < 16; ++r) {
+        if (live.contains(r64s[r]) || live.contains(r32s[r]) || live.contains(r16s[r]) || live.contains(r8s[r])) {
+          cutpoint_gp_.back().push_back(r);
+        }
+      }
+      cutpoint_sse_.push_back({});
+      for (size_t r = 0; r < 16; ++r) {
+        if (live.contains(xmms[r]) || live.contains(ymms[r])) {
+          cutpoint_sse_.back().push_back(r);
+        }
+      }
+    }
+    trace_cutpoints(target, lines, target_trace_);
+    for (auto i = test_sandbox_->result_begin(), ie = test_sandbox_->result_end(); i != ie; ++i) {
+      reference_out_.push_back(*i);
+    }
+    return *this;
+  }
+
   test_sandbox_->insert_function(target);
   test_sandbox_->set_entrypoint(target.get_code()[0].get_operand<x64asm::Label>(0));
+
+  const auto key = reference_cache_ ? ReferenceCache::key(target, *test_sandbox_) : "";
+  if (reference_cache_ && ReferenceCache::lookup(key, reference_cache_dir_, test_sandbox_->size(), reference_out_)) {
+    return *this;
+  }
+
   test_sandbox_->run();
   for (auto i = test_sandbox_->result_begin(), ie = test_sandbox_->result_end(); i != ie; ++i) {
     reference_out_.push_back(*i);
   }
+  if (reference_cache_) {
+    ReferenceCache::insert(key, reference_cache_dir_, reference_out_);
+  }
   return *this;
 }
 
@@ -74,13 +113,254 @@ void CorrectnessCost::recompute_target_defs(const RegSet& rs) {
   result would equal or exceed that value. */
 CorrectnessCost::result_type CorrectnessCost::operator()(const Cfg& cfg, const Cost max) {
 
-  run_test_sandbox(cfg);
+  if (cutpoints_) {
+    return cutpoint_correctness(cfg, max);
+  }
+  if (use_minibatch()) {
+    return minibatch_correctness(cfg, max);
+  }
+  // If it's up to us to run the sandbox, we can stop it once we know the answer
+  if (runs_test_sandbox()) {
+    return bounded_correctness(cfg, max);
+  }
 
   auto cost = evaluate_correctness(cfg, max);
   bool correct = cost == 0;
   return result_type(correct, cost);
 }
 
+CorrectnessCost::result_type CorrectnessCost::minibatch_correctness(const Cfg& cfg, const Cost max) {
+  test_sandbox_->insert_function(cfg);
+  test_sandbox_->set_entrypoint(cfg.get_code()[0].get_operand<x64asm::Label>(0));
+
+  // Batches are consecutive slices of a random permutation, so every testcase
+  // is visited once per pass; reshuffle when the pass runs out.
+  const auto n = num_testcases();
+  const auto k = minibatch_size_;
+  if (order_.size() != n) {
+    order_.resize(n);
+    iota(order_.begin(), order_.end(), 0);
+    next_ = n;
+  }
+  if (next_ + k > n) {
+    shuffle(order_.begin(), order_.end(), gen_);
+    next_ = 0;
+  }
+
+  const auto sum = reduction_ == Reduction::SUM;
+  const auto scale = sum ? (double)n / k : 1.0;
+  counter_example_testcase_ = -1;
+
+  Cost res = 0;
+  double total = 0;
+  double total_sq = 0;
+  for (size_t j = next_, je = next_ + k; j < je; ++j) {
+    const auto i = order_[j];
+    test_sandbox_->run(i);
+    const auto err = evaluate_error(reference_out_[i], *(test_sandbox_->get_result(i)), cfg.def_outs());
+    assert(err <= max_testcase_cost);
+    if (err != 0 && counter_example_testcase_ < 0) {
+      counter_example_testcase_ = i;
+    }
+
+    res = sum ? res + err : std::max(res, err);
+    total += err;
+    total_sq += (double)err * err;
+    if (res * scale >= max) {
+      next_ += k;
+      return result_type(false, max);
+    }
+  }
+  next_ += k;
+
+  // Looks correct; confirm against everything before anyone relies on it.
+  if (res == 0) {
+    test_sandbox_->run();
+    const auto cost = evaluate_correctness(cfg, max);
+    return result_type(cost == 0, cost);
+  }
+  if (!sum) {
+    return result_type(false, res);
+  }
+
+  // Unbiased estimate of the full sum, plus the penalty for its variance
+  // (with the finite population correction since we sample without replacement).
+  double est = res * scale;
+  if (k > 1) {
+    const auto s2 = std::max(0.0, (total_sq - total * total / k) / (k - 1));
+    const auto var = n * scale * s2 * (1.0 - 1.0 / scale);
+    est += minibatch_beta_ / 2 * var;
+  }
+  est = std::min(ceil(est), (double)max_correctness_cost);
+  return result_type(false, std::min((Cost)est, max));
+}
+
+CorrectnessCost::result_type CorrectnessCost::bounded_correctness(const Cfg& cfg, const Cost max) {
+  bound_ = max;
+  bound_cost_ = 0;
+  bound_defs_ = cfg.def_outs();
+  counter_example_testcase_ = -1;
+
+  test_sandbox_->insert_function(cfg);
+  test_sandbox_->set_entrypoint(cfg.get_code()[0].get_operand<x64asm::Label>(0));
+  test_sandbox_->set_stop_callback(stop_callback, this);
+  test_sandbox_->run();
+  test_sandbox_->set_stop_callback(nullptr, nullptr);
+
+  assert(bound_cost_ <= max_correctness_cost);
+  return result_type(bound_cost_ == 0, bound_cost_);
+}
+
+vector<size_t> CorrectnessCost::loop_heads(const Cfg& cfg) {
+  const auto& code = cfg.get_code();
+  vector<size_t> res;
+
+  // The head of a loop is its first block in code order; callbacks go after
+  // its labels, or jumps to the head would skip them
+  CfgSccs sccs(cfg);
+  for (size_t s = 0, se = sccs.count(); s < se; ++s) {
+    auto head = cfg.get_exit();
+    for (auto b : sccs.get_blocks(s)) {
+      if (cfg.num_instrs(b) > 0 && (head == cfg.get_exit() || cfg.get_index({b, 0}) < cfg.get_index({head, 0}))) {
+        head = b;
+      }
+    }
+    if (head == cfg.get_exit()) {
+      continue;
+    }
+    auto i = cfg.get_index({head, 0});
+    const auto ie = i + cfg.num_instrs(head);
+    for (; i < ie && code[i].is_label_defn(); ++i);
+    if (i < ie) {
+      res.push_back(i);
+    }
+  }
+
+  sort(res.begin(), res.end());
+  return res;
+}
+
+void CorrectnessCost::trace_cutpoints(const Cfg& cfg, const vector<size_t>& lines, CutpointTrace& trace) {
+  const auto label = cfg.get_code()[0].get_operand<x64asm::Label>(0);
+  test_sandbox_->insert_function(cfg);
+  test_sandbox_->set_entrypoint(label);
+
+  trace.resize(num_testcases());
+  for (auto& t : trace) {
+    t.resize(lines.size());
+    for (auto& visits : t) {
+      visits.clear();
+    }
+  }
+  cutpoint_trace_ = &trace;
+  cutpoint_testcase_ = 0;
+
+  cutpoint_args_.resize(lines.size());
+  for (size_t k = 0, ke = lines.size(); k < ke; ++k) {
+    cutpoint_args_[k] = {this, k};
+    test_sandbox_->insert_before(label, lines[k], cutpoint_callback, &cutpoint_args_[k]);
+  }
+  test_sandbox_->run();
+  if (!lines.empty()) {
+    test_sandbox_->clear_callbacks(label);
+  }
+}
+
+void CorrectnessCost::cutpoint_callback(const StateCallbackData& data, void* arg) {
+  const auto ca = (pair<CorrectnessCost*, size_t>*)arg;
+  const auto cc = ca->first;
+  const auto k = ca->second;
+
+  // Inputs run in order, so the current one is never before the last one seen
+  auto& i = cc->cutpoint_testcase_;
+  while (&*(cc->test_sandbox_->get_output(i)) != &data.state) {
+    ++i;
+    assert(i < cc->num_testcases());
+  }
+
+  // Rewrites can loop until they run out of jumps; don't let them run out of memory too
+  auto& visits = (*cc->cutpoint_trace_)[i][k];
+  const auto width = cc->cutpoint_gp_[k].size() + 4 * cc->cutpoint_sse_[k].size();
+  if (visits.size() >= max_cutpoint_visits * width) {
+    return;
+  }
+  for (auto r : cc->cutpoint_gp_[k]) {
+    visits.push_back(data.state.gp[r].get_fixed_quad(0));
+  }
+  for (auto r : cc->cutpoint_sse_[k]) {
+    for (size_t q = 0; q < 4; ++q) {
+      visits.push_back(data.state.sse[r].get_fixed_quad(q));
+    }
+  }
+}
+
+CorrectnessCost::result_type CorrectnessCost::cutpoint_correctness(const Cfg& cfg, const Cost max) {
+  // Pair loop heads in order; any the target doesn't have are ignored
+  auto lines = loop_heads(cfg);
+  lines.resize(std::min(lines.size(), cutpoint_gp_.size()));
+  trace_cutpoints(cfg, lines, rewrite_trace_);
+
+  // Final states alone decide correctness; cutpoints just grade the wrong answers
+  auto cost = evaluate_correctness(cfg, max);
+  if (cost == 0 || cost >= max) {
+    return result_type(cost == 0, cost);
+  }
+  for (size_t i = 0, ie = num_testcases(); i < ie; ++i) {
+    cost += cutpoint_error(i);
+    if (cost >= max) {
+      return result_type(false, max);
+    }
+  }
+
+  return result_type(false, std::min(cost, max_correctness_cost));
+}
+
+Cost CorrectnessCost::cutpoint_error(size_t testcase) const {
+  const auto& t = target_trace_[testcase];
+  const auto& r = rewrite_trace_[testcase];
+
+  Cost cost = 0;
+  for (size_t k = 0, ke = std::min(t.size(), r.size()); k < ke; ++k) {
+    const auto width = cutpoint_gp_[k].size() + 4 * cutpoint_sse_[k].size();
+    if (width == 0) {
+      continue;
+    }
+    const auto t_visits = t[k].size() / width;
+    const auto r_visits = r[k].size() / width;
+    const auto common = std::min(t_visits, r_visits);
+    const auto total = std::max(t_visits, r_visits);
+    if (total == 0) {
+      continue;
+    }
+
+    // Iterations that only one side ran count as entirely wrong
+    Cost err = (total - common) * width * undef_default(8);
+    for (size_t j = 0, je = common * width; j < je; ++j) {
+      err += evaluate_distance(t[k][j], r[k][j]);
+    }
+    cost += err / total;
+  }
+
+  return std::min(cost, max_testcase_cost);
+}
+
+bool CorrectnessCost::stop_callback(size_t index, void* arg) {
+  auto cc = (CorrectnessCost*)arg;
+
+  const auto err = cc->evaluate_error(cc->reference_out_[index], *(cc->test_sandbox_->get_result(index)), cc->bound_defs_);
+  assert(err <= max_testcase_cost);
+  if (err != 0 && cc->counter_example_testcase_ < 0) {
+    cc->counter_example_testcase_ = index;
+  }
+
+  if (cc->reduction_ == Reduction::SUM) {
+    cc->bound_cost_ += err;
+  } else {
+    cc->bound_cost_ = std::max(cc->bound_cost_, err);
+  }
+  return cc->bound_cost_ >= cc->bound_;
+}
+
 Cost CorrectnessCost::evaluate_correctness(const Cfg& cfg, const Cost max) {
 
   switch (reduction_) {
@@ -279,18 +559,28 @@ Cost CorrectnessCost::sse_error(const Regs& t, const Regs& r, const RegSet& defs
 Cost CorrectnessCost::mem_error(const Memory& t, const Memory& r) const {
   Cost cost = 0;
 
-  for (auto i = t.valid_begin(), ie = t.valid_end(); i != ie; ++i) {
-    if (relax_mem_) {
+  if (!relax_mem_) {
+    t.for_each_valid_range([this, &t, &r, &cost](uint64_t begin, uint64_t end) {
+      for (auto i = begin; i != end; ++i) {
+        cost += evaluate_distance(t[i], r[i]);
+      }
+    });
+    return cost;
+  }
+
+  const auto r_ranges = r.valid_ranges();
+  t.for_each_valid_range([this, &t, &r, &r_ranges, &cost](uint64_t begin, uint64_t end) {
+    for (auto i = begin; i != end; ++i) {
       Cost delta = undef_default(1);
-      for (auto j = r.valid_begin(), je = r.valid_end(); j != je; ++j) {
-        const auto eval = evaluate_distance(t[*i], r[*j]) + (*i == *j ? 0 : misalign_penalty_);
-        delta = min(delta, eval);
+      for (const auto& range : r_ranges) {
+        for (auto j = range.begin; j != range.end; ++j) {
+          const auto eval = evaluate_distance(t[i], r[j]) + (i == j ? 0 : misalign_penalty_);
+          delta = min(delta, eval);
+        }
       }
       cost += delta;
-    } else {
-      cost += evaluate_distance(t[*i], r[*i]);
     }
-  }
+  });
 
   return cost;
 }
@@ -298,34 +588,30 @@ Cost CorrectnessCost::mem_error(const Memory& t, const Memory& r) const {
 Cost CorrectnessCost::block_mem_error(const Memory& t, const Memory& rmem, const Regs& rsse, const RegSet& defs) const {
   Cost cost = 0;
 
-  for (size_t i = *t.valid_begin(), ie = t.upper_bound(); i < ie; i += 16) {
-    // Skip invalid blocks
-    if (!t.is_valid(i)) {
-      assert(!t.is_valid_quad(i));
-      assert(!t.is_valid_quad(i+8));
-      continue;
-    }
-    // Make sure that this block is valid in the target and rewrite
-    assert(t.is_valid_quad(i) && rmem.is_valid_quad(i));
-    assert(t.is_valid_quad(i+8) && rmem.is_valid_quad(i+8));
-
-    // Start off with vanilla memory to memory comparison
-    Cost delta = evaluate_distance(t.get_quad(i), rmem.get_quad(i)) +
-                 evaluate_distance(t.get_quad(i+8), rmem.get_quad(i+8));
-
-    // If we've relaxed mem, we can also look in sse registers
-    if (relax_mem_) {
-      for (auto s_r = defs.any_sub_sse_begin(), s_re = defs.any_sub_sse_end(); s_r != s_re; ++s_r) {
-        Cost eval = evaluate_distance(t.get_quad(i), rsse[*s_r].get_fixed_quad(0)) +
-                    evaluate_distance(t.get_quad(i+8), rsse[*s_r].get_fixed_quad(1)) +
-                    misalign_penalty_;
-        delta = min(delta, eval);
+  t.for_each_valid_range([&](uint64_t begin, uint64_t end) {
+    for (auto i = begin; i < end; i += 16) {
+      // Make sure that this block is valid in the target and rewrite
+      assert(t.is_valid_quad(i) && rmem.is_valid_quad(i));
+      assert(t.is_valid_quad(i+8) && rmem.is_valid_quad(i+8));
+
+      // Start off with vanilla memory to memory comparison
+      Cost delta = evaluate_distance(t.get_quad(i), rmem.get_quad(i)) +
+                   evaluate_distance(t.get_quad(i+8), rmem.get_quad(i+8));
+
+      // If we've relaxed mem, we can also look in sse registers
+      if (relax_mem_) {
+        for (auto s_r = defs.any_sub_sse_begin(), s_re = defs.any_sub_sse_end(); s_r != s_re; ++s_r) {
+          Cost eval = evaluate_distance(t.get_quad(i), rsse[*s_r].get_fixed_quad(0)) +
+                      evaluate_distance(t.get_quad(i+8), rsse[*s_r].get_fixed_quad(1)) +
+                      misalign_penalty_;
+          delta = min(delta, eval);
+        }
       }
-    }
 
-    // Now accrue the lowest cost we were able to find
-    cost += delta;
-  }
+      // Now accrue the lowest cost we were able to find
+      cost += delta;
+    }
+  });
 
   return cost;
 }
@@ -18,6 +18,7 @@
 #include <cassert>
 #include <stdint.h>
 
+#include <string>
 #include <vector>
 
 #include "src/ext/cpputil/include/bits/bit_manip.h"
@@ -43,10 +44,14 @@ public:
   static constexpr auto max_testcase_cost = (Cost)(0x1ull << 42);
   /** The maximum cost that a single error calculation should produce. */
   static constexpr auto max_error_cost = (Cost)(0x1ull << 32);
+  /** The most visits to a loop head recorded per testcase. */
+  static constexpr size_t max_cutpoint_visits = 1024;
 
   /** Create a new cost function with default values for extended features. */
-  CorrectnessCost(Sandbox* sb) : CostFunction(), counter_example_testcase_(-1) {
+  CorrectnessCost(Sandbox* sb) : CostFunction(), next_(0), counter_example_testcase_(-1) {
     test_sandbox_ = sb;
+    set_cutpoints(false);
+    set_reference_cache(false);
     const x64asm::Code code {
       {x64asm::LABEL_DEFN, {x64asm::Label{".main"}}},
       {x64asm::RET}
@@ -58,8 +63,27 @@ public:
     set_penalty(0, 0);
     set_min_ulp(0);
     set_reduction(Reduction::SUM);
+    set_minibatch(0, 1.0);
   }
 
+  /** Also compare states at loop heads (cutpoints) when a rewrite isn't correct.
+    The target's and rewrite's loop heads are paired in code order, and each pair
+    adds the mean error over the iterations that both ran; only the first
+    max_cutpoint_visits iterations are recorded. This must be set before the
+    target, and takes precedence over minibatches. */
+  CorrectnessCost& set_cutpoints(bool cutpoints) {
+    cutpoints_ = cutpoints;
+    return *this;
+  }
+  /** Reuse the target's outputs from earlier calls to set_target() in this process
+    with the same target and testcases rather than running it again.  If dir isn't
+    empty, outputs are also stored there and shared with other processes.  This
+    must be set before the target, and is ignored when tracing cutpoints. */
+  CorrectnessCost& set_reference_cache(bool cache, const std::string& dir = "") {
+    reference_cache_ = cache;
+    reference_cache_dir_ = dir;
+    return *this;
+  }
   /** Reset target function; evaluates testcases and caches the results. */
   CorrectnessCost& set_target(const Cfg& target, bool stack_out, bool heap_out);
   /** Set metric for measuring distance between 64-bit values. */
@@ -97,6 +121,22 @@ public:
     return *this;
   }
 
+  /** Score rewrites on a rotating random subset of k testcases rather than on all of
+    them (k = 0 disables). Sums are scaled up to the full set, and the variance of
+    that estimate is charged at beta/2 (the penalty method for noisy Metropolis
+    acceptance; beta should match the search's annealing constant). A rewrite is
+    only reported correct after it has been confirmed on every testcase. */
+  CorrectnessCost& set_minibatch(size_t k, double beta) {
+    minibatch_size_ = k;
+    minibatch_beta_ = beta;
+    return *this;
+  }
+  /** Set the seed used to choose minibatches. */
+  CorrectnessCost& set_seed(std::default_random_engine::result_type seed) {
+    gen_.seed(seed);
+    return *this;
+  }
+
   /** Evaluate a rewrite. This method may shortcircuit and return max as soon as its
     result would equal or exceed that value. */
   virtual result_type operator()(const Cfg& cfg, const Cost max = max_cost);
@@ -117,9 +157,10 @@ public:
     return get_testcase(counter_example_testcase_);
   }
 
-  /** We need the sandbox! */
+  /** We need the sandbox!  Unless we're sampling minibatches or tracing
+      cutpoints, in which case we run the sandbox ourselves. */
   bool need_test_sandbox() {
-    return true;
+    return !use_minibatch() && !cutpoints_;
   }
 
   /** Just make sure our sandbox is the same as theirs...
@@ -163,9 +204,47 @@ private:
   Cost min_ulp_;
   /** Reduction method. */
   Reduction reduction_;
+  /** The number of testcases to evaluate per call, or 0 for all of them. */
+  size_t minibatch_size_;
+  /** Annealing constant used to penalize the variance of minibatch estimates. */
+  double minibatch_beta_;
+
+  /** Source of randomness for choosing minibatches. */
+  std::default_random_engine gen_;
+  /** A random permutation of testcase indices; minibatches are consecutive slices. */
+  std::vector<size_t> order_;
+  /** The start of the next minibatch in order_. */
+  size_t next_;
+
+  /** The bound for the current call, when we run the sandbox ourselves. */
+  Cost bound_;
+  /** The cost accumulated so far in the current call. */
+  Cost bound_cost_;
+  /** The registers defined by the rewrite in the current call. */
+  x64asm::RegSet bound_defs_;
+
+  /** Should states at loop heads be compared as well? */
+  bool cutpoints_;
+  /** The gp and sse registers live at each of the target's loop heads. */
+  std::vector<std::vector<size_t>> cutpoint_gp_;
+  std::vector<std::vector<size_t>> cutpoint_sse_;
+  /** For each testcase and loop head, the live register values on every visit. */
+  typedef std::vector<std::vector<std::vector<uint64_t>>> CutpointTrace;
+  CutpointTrace target_trace_;
+  CutpointTrace rewrite_trace_;
+  /** The trace that the cutpoint callback is recording into. */
+  CutpointTrace* cutpoint_trace_;
+  /** The testcase that the cutpoint callback last saw. */
+  size_t cutpoint_testcase_;
+  /** Arguments for the cutpoint callback, one per loop head. */
+  std::vector<std::pair<CorrectnessCost*, size_t>> cutpoint_args_;
 
   /** The results produced by executing the target on testcases. */
   std::vector<CpuState> reference_out_;
+  /** Are reference outputs shared through the ReferenceCache? */
+  bool reference_cache_;
+  /** Where the ReferenceCache stores outputs, if anywhere. */
+  std::string reference_cache_dir_;
 
   /** A test-case (index) that has non-zero cost (or -1). */
   long counter_example_testcase_;
@@ -186,6 +265,26 @@ private:
   Cost max_correctness(const Cfg& cfg, const Cost max);
   /** Evaluate correctness by summing cost over testcases. */
   Cost sum_correctness(const Cfg& cfg, const Cost max);
+  /** Is minibatch mode enabled, and is it smaller than the testcase set? */
+  bool use_minibatch() const {
+    return minibatch_size_ > 0 && minibatch_size_ < num_testcases();
+  }
+  /** Evaluate a rewrite on the next minibatch, and on all testcases if that looks correct. */
+  result_type minibatch_correctness(const Cfg& cfg, const Cost max);
+  /** Run and evaluate a rewrite, stopping the sandbox as soon as the cost reaches max. */
+  result_type bounded_correctness(const Cfg& cfg, const Cost max);
+  /** Returns the first line of every loop head, in code order. */
+  static std::vector<size_t> loop_heads(const Cfg& cfg);
+  /** Runs a function on every testcase, recording a trace at these lines. */
+  void trace_cutpoints(const Cfg& cfg, const std::vector<size_t>& lines, CutpointTrace& trace);
+  /** Sandbox callback; records the live registers at a loop head. */
+  static void cutpoint_callback(const StateCallbackData& data, void* arg);
+  /** Run and evaluate a rewrite, adding errors at cutpoints if it isn't correct. */
+  result_type cutpoint_correctness(const Cfg& cfg, const Cost max);
+  /** Evaluate error between the target and rewrite traces for a testcase. */
+  Cost cutpoint_error(size_t testcase) const;
+  /** Sandbox stop callback; accumulates the cost of each testcase as it finishes. */
+  static bool stop_callback(size_t index, void* arg);
 
   /** Evaluate error between states. */
   Cost evaluate_error(const CpuState& t, const CpuState& r, const x64asm::RegSet& defs) const;
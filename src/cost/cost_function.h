@@ -132,6 +132,11 @@ public:
 
 protected:
 
+  /** Will run_test_sandbox() run the sandbox, or has the client already done so? */
+  bool runs_test_sandbox() {
+    return must_run_test_sandbox_ && need_test_sandbox();
+  }
+
   /** Runs the test sandbox if necessary (i.e. it's needed and the client doesn't do
    * so).  This function should be avoided for performance reasons; so be sure
    to call set_run_sandbox(false)! */
@@ -0,0 +1,116 @@
+// Copyright 2013-2016 Stanford University
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "src/cfg/sccs.h"
+#include "src/cost/frontend.h"
+
+using namespace std;
+using namespace x64asm;
+
+namespace {
+
+/** Uops per way of the decoded icache, and ways per 32-byte window. */
+constexpr size_t dsb_uops_per_way = 6;
+constexpr size_t dsb_ways_per_window = 3;
+
+} // namespace
+
+namespace stoke {
+
+FrontEndCost::result_type FrontEndCost::operator()(const Cfg& cfg, Cost max) {
+  const auto& fxn = cfg.get_function();
+  const auto& code = cfg.get_code();
+
+  // Lay out the code without nops; tunit keeps the assembled size of every instruction.
+  offsets_.resize(code.size() + 1);
+  size_t pos = 0;
+  for (size_t i = 0, ie = code.size(); i < ie; ++i) {
+    offsets_[i] = pos;
+    if (!code[i].is_nop()) {
+      pos += fxn.hex_size(i);
+    }
+  }
+  offsets_[code.size()] = pos;
+  windows_.assign(pos / 32 + 1, 0);
+
+  CfgSccs sccs(cfg);
+  vector<bool> is_head(cfg.num_blocks(), false);
+  for (size_t s = 0, se = sccs.count(); s < se; ++s) {
+    Cfg::id_type head = cfg.get_exit();
+    size_t head_offset = pos + 1;
+    for (auto b : sccs.get_blocks(s)) {
+      if (cfg.num_instrs(b) > 0 && offsets_[cfg.get_index({b, 0})] < head_offset) {
+        head = b;
+        head_offset = offsets_[cfg.get_index({b, 0})];
+      }
+    }
+    is_head[head] = true;
+  }
+
+  Cost cost = 0;
+  for (auto b = cfg.reachable_begin(), be = cfg.reachable_end(); b != be; ++b) {
+    if (cfg.num_instrs(*b) == 0) {
+      continue;
+    }
+
+    const auto in_loop = sccs.in_scc(*b);
+    const auto weight = in_loop ? loop_penalty_ : 1;
+    const auto first = cfg.get_index({*b, 0});
+
+    if (is_head[*b] && offsets_[first] % 16 != 0) {
+      cost += weight;
+    }
+
+    for (size_t i = first, ie = first + cfg.num_instrs(*b); i < ie; ++i) {
+      const auto begin = offsets_[i];
+      const auto end = offsets_[i + 1];
+      if (begin == end) {
+        continue;
+      }
+
+      // Instructions split across decode windows
+      if (begin / 16 != (end - 1) / 16) {
+        cost += weight;
+      }
+      // Branches that cross or end on a 32-byte boundary can't be cached
+      if ((code[i].is_any_jump() || code[i].is_any_call() || code[i].is_any_return()) &&
+          (begin / 32 != (end - 1) / 32 || end % 32 == 0)) {
+        cost += weight;
+      }
+      if (in_loop) {
+        windows_[begin / 32]++;
+      }
+    }
+
+    if (cost >= max) {
+      return result_type(true, max);
+    }
+  }
+
+  // Footprint of loop bodies in the decoded icache
+  for (auto uops : windows_) {
+    if (uops == 0) {
+      continue;
+    }
+    const auto ways = (uops + dsb_uops_per_way - 1) / dsb_uops_per_way;
+    cost += loop_penalty_;
+    if (ways > dsb_ways_per_window) {
+      cost += loop_penalty_ * (ways - dsb_ways_per_window);
+    }
+  }
+
+  return result_type(true, cost < max ? cost : max);
+}
+
+} // namespace stoke
@@ -0,0 +1,59 @@
+// Copyright 2013-2016 Stanford University
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef STOKE_SRC_COST_FRONTEND_H
+#define STOKE_SRC_COST_FRONTEND_H
+
+#include <vector>
+
+#include "src/cost/cost_function.h"
+
+namespace stoke {
+
+/** Estimates front-end stalls caused by code layout.  The rewrite is laid out
+  as it would be after nops are removed, starting at a 32-byte aligned address.
+  Penalties are charged for instructions that straddle a 16-byte decode window,
+  for branches that cross or end on a 32-byte boundary, for loop heads that are
+  not 16-byte aligned, and for every 32-byte window a loop body touches, with an
+  extra charge for windows that hold more uops than fit in the decoded icache.
+  Penalties in loop bodies are multiplied by the loop penalty. */
+class FrontEndCost : public CostFunction {
+public:
+  /** Creates a new cost function. */
+  FrontEndCost() {
+    set_loop_penalty(5);
+  }
+
+  /** Set the multiplier for penalties that occur inside of a loop. */
+  FrontEndCost& set_loop_penalty(Cost penalty) {
+    loop_penalty_ = penalty;
+    return *this;
+  }
+
+  /** Returns the weighted sum of layout penalties for a rewrite. */
+  result_type operator()(const Cfg& cfg, Cost max = max_cost);
+
+private:
+  /** The multiplier for penalties inside of loops. */
+  Cost loop_penalty_;
+
+  /** Byte offset of each instruction once nops are removed. */
+  std::vector<size_t> offsets_;
+  /** Number of uops (approximated by instructions) in each 32-byte loop window. */
+  std::vector<size_t> windows_;
+};
+
+} // namespace stoke
+
+#endif
@@ -14,15 +14,84 @@
 
 
 #include <array>
+#include <utility>
 
 #include "src/cost/latency.h"
 #include "src/ext/x64asm/include/x64asm.h"
 
 using namespace std;
+using namespace x64asm;
 
 namespace stoke {
 
+vector<pair<size_t, Instruction>> LatencyCost::get_signature(const Cfg& cfg) {
+  vector<pair<size_t, Instruction>> res;
+  const auto& code = cfg.get_code();
+  for (size_t i = 0, ie = code.size(); i < ie; ++i) {
+    if (!code[i].is_label_defn() && !code[i].is_any_jump() && !code[i].is_any_return()) {
+      continue;
+    }
+    // A conditional jump goes the way the last write to its flags in the block says
+    if (code[i].is_cond_jump()) {
+      const auto flags = code[i].maybe_read_set();
+      for (size_t j = i; j > 0 && !code[j-1].is_label_defn() && !code[j-1].is_any_jump(); --j) {
+        if (code[j-1].maybe_write_set().intersects(flags)) {
+          res.push_back({j-1, code[j-1]});
+          break;
+        }
+      }
+    }
+    res.push_back({i, code[i]});
+  }
+  return res;
+}
+
+void LatencyCost::count_callback(const StateCallbackData& data, void* arg) {
+  auto lc = (LatencyCost*)arg;
+  lc->counts_[lc->line_to_block_[data.line]]++;
+}
+
+void LatencyCost::profile(const Cfg& cfg) {
+  const auto& code = cfg.get_code();
+  const auto fxn = code[0].get_operand<Label>(0);
+
+  counts_.assign(cfg.num_blocks(), 0);
+  line_to_block_.assign(code.size(), cfg.get_exit());
+
+  // Runs with callbacks never go native, so the copy doesn't need an executor
+  if (profile_sandbox_ == nullptr || profile_sandbox_->size() != perf_sandbox_->size()) {
+    profile_sandbox_.reset(new Sandbox(*perf_sandbox_));
+    profile_sandbox_->set_native(false);
+  }
+  profile_sandbox_->insert_function(cfg);
+  profile_sandbox_->set_entrypoint(fxn);
+  for (auto b = ++cfg.reachable_begin(), be = cfg.reachable_end(); b != be; ++b) {
+    if (cfg.is_exit(*b) || cfg.num_instrs(*b) == 0) {
+      continue;
+    }
+    const auto first = cfg.get_index(Cfg::loc_type(*b, 0));
+    line_to_block_[first] = *b;
+    profile_sandbox_->insert_before(fxn, first, count_callback, this);
+  }
+  profile_sandbox_->run();
+  profile_sandbox_->clear_callbacks(fxn);
+}
+
 LatencyCost::result_type LatencyCost::operator()(const Cfg& cfg, Cost max) {
+  // Frequencies are only available if there's something to run
+  const auto weighted = profile_ && perf_sandbox_ != nullptr && perf_sandbox_->size() > 0;
+  if (weighted) {
+    auto signature = get_signature(cfg);
+    if (signature != signature_) {
+      profile(cfg);
+      signature_ = std::move(signature);
+    }
+  }
+
+  // Weighted latencies are summed over all testcases and averaged at the end
+  const auto scale = weighted ? (Cost)perf_sandbox_->size() : 1;
+  const auto limit = max > max_cost / scale ? max_cost : max * scale;
+
   Cost latency = 0;
 
   const auto& code = cfg.get_code();
@@ -40,15 +109,15 @@ LatencyCost::result_type LatencyCost::operator()(const Cfg& cfg, Cost max) {
       }
     }
 
-    // Increment latency by block latency scaled by nesting penalty
-    latency += block_latency;
+    // Increment latency by block latency scaled by execution frequency
+    latency += weighted ? block_latency * counts_[*b] : block_latency;
 
-    if (latency >= max) {
+    if (latency >= limit) {
       return result_type(true, max);
     }
   }
 
-  return result_type(true, latency);
+  return result_type(true, (latency + scale / 2) / scale);
 }
 
 } //namespace stoke
@@ -15,6 +15,10 @@
 #ifndef STOKE_SRC_COST_LATENCY_H
 #define STOKE_SRC_COST_LATENCY_H
 
+#include <memory>
+#include <utility>
+#include <vector>
+
 #include "src/cost/cost_function.h"
 
 namespace stoke {
@@ -23,11 +27,50 @@ class LatencyCost : public CostFunction {
 
 public:
   LatencyCost() {
+    set_profile(false);
+  }
+
+  /** Weight each block by how often it executes on the performance set.  Frequencies are
+    measured with per-block counters and recomputed only when the control flow changes: when
+    a label, jump or return, or the last instruction before a conditional jump in its block to
+    write the flags it reads, changes or moves.  Changes further up the computation of those
+    flags can change which way a jump goes without a new profile, so frequencies are an
+    estimate between control flow changes. */
+  LatencyCost& set_profile(bool b) {
+    profile_ = b;
+    signature_.clear();
+    return *this;
+  }
+
+  /** Profiles run on a private copy of this sandbox, so that the callbacks
+    other cost functions install on it don't see the extra runs. */
+  LatencyCost& setup_perf_sandbox(Sandbox* sb) {
+    CostFunction::setup_perf_sandbox(sb);
+    profile_sandbox_.reset();
+    signature_.clear();
+    return *this;
   }
 
   result_type operator()(const Cfg& cfg, Cost max = max_cost);
 
 private:
+  /** Weight blocks by their execution frequency? */
+  bool profile_;
+  /** Control instructions (and their positions) of the last profiled cfg. */
+  std::vector<std::pair<size_t, x64asm::Instruction>> signature_;
+  /** A copy of the performance sandbox without its callbacks. */
+  std::unique_ptr<Sandbox> profile_sandbox_;
+  /** Maps the first line of each block to its id. */
+  std::vector<Cfg::id_type> line_to_block_;
+  /** Number of times each block was entered over all performance testcases. */
+  std::vector<uint64_t> counts_;
+
+  /** Returns a summary of the control flow of a cfg. */
+  static std::vector<std::pair<size_t, x64asm::Instruction>> get_signature(const Cfg& cfg);
+  /** Recomputes block frequencies by running the performance sandbox. */
+  void profile(const Cfg& cfg);
+  /** Callback used to count block entries. */
+  static void count_callback(const StateCallbackData& data, void* arg);
 
 };
 
@@ -0,0 +1,183 @@
+// Copyright 2013-2016 Stanford University
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <fstream>
+#include <list>
+#include <sstream>
+#include <utility>
+
+#include "src/cost/reference_cache.h"
+
+using namespace std;
+using namespace x64asm;
+
+namespace {
+
+/** 64-bit FNV-1a. */
+class Hash {
+public:
+  Hash() : h_(0xcbf29ce484222325ull) { }
+
+  Hash& operator<<(const string& s) {
+    for (auto c : s) {
+      h_ = (h_ ^ (uint8_t)c) * 0x100000001b3ull;
+    }
+    return *this;
+  }
+  Hash& operator<<(uint64_t x) {
+    for (size_t i = 0; i < 8; ++i, x >>= 8) {
+      h_ = (h_ ^ (x & 0xff)) * 0x100000001b3ull;
+    }
+    return *this;
+  }
+
+  string str() const {
+    char buf[17];
+    snprintf(buf, sizeof(buf), "%016llx", (unsigned long long)h_);
+    return buf;
+  }
+
+private:
+  uint64_t h_;
+};
+
+/** Entries held in memory, most recently used first. */
+list<pair<string, vector<stoke::CpuState>>>& entries() {
+  static list<pair<string, vector<stoke::CpuState>>> es;
+  return es;
+}
+
+string path(const string& dir, const string& key) {
+  return dir + "/" + key + ".ref";
+}
+
+} // namespace
+
+namespace stoke {
+
+constexpr const char* ReferenceCache::magic;
+constexpr size_t ReferenceCache::capacity;
+
+string ReferenceCache::key(const Cfg& target, const Sandbox& sb) {
+  const auto label = target.get_code()[0].get_operand<Label>(0);
+
+  ostringstream ss;
+  ss << target.get_code();
+  Hash code;
+  code << ss.str();
+
+  // Functions are stored in a hash table; sort them for a stable key
+  vector<string> fxns;
+  for (auto i = sb.function_begin(), ie = sb.function_end(); i != ie; ++i) {
+    if (i->get_code()[0].get_operand<Label>(0) != label) {
+      ss.str("");
+      ss << i->get_code();
+      fxns.push_back(ss.str());
+    }
+  }
+  sort(fxns.begin(), fxns.end());
+
+  Hash rest;
+  rest << (uint64_t)sb.get_abi_check() << (uint64_t)sb.get_stack_check() << (uint64_t)sb.get_max_jumps();
+  rest << (uint64_t)fxns.size();
+  for (const auto& f : fxns) {
+    rest << f;
+  }
+  rest << (uint64_t)sb.size();
+  for (size_t i = 0, ie = sb.size(); i < ie; ++i) {
+    ss.str("");
+    sb.get_input(i)->write_bin(ss);
+    rest << ss.str();
+  }
+
+  return code.str() + "-" + rest.str();
+}
+
+bool ReferenceCache::lookup(const string& key, const string& dir, size_t count, vector<CpuState>& outs) {
+  auto& es = entries();
+  for (auto i = es.begin(), ie = es.end(); i != ie; ++i) {
+    if (i->first == key && i->second.size() == count) {
+      es.splice(es.begin(), es, i);
+      outs = es.front().second;
+      return true;
+    }
+  }
+
+  if (dir.empty()) {
+    return false;
+  }
+  ifstream ifs(path(dir, key), ios::in | ios::binary);
+  if (!ifs.is_open()) {
+    return false;
+  }
+
+  // The count comes from the file; don't trust it with an allocation
+  char buf[8];
+  uint64_t file_count = 0;
+  ifs.read(buf, 8);
+  ifs.read((char*)&file_count, sizeof(file_count));
+  if (!ifs.good() || !equal(buf, buf + 8, magic) || file_count != count) {
+    return false;
+  }
+  vector<CpuState> res(count);
+  for (auto& cs : res) {
+    cs.read_bin(ifs);
+    if (!ifs.good()) {
+      return false;
+    }
+  }
+
+  outs = res;
+  insert(key, "", outs);
+  return true;
+}
+
+void ReferenceCache::insert(const string& key, const string& dir, const vector<CpuState>& outs) {
+  auto& es = entries();
+  es.remove_if([&key](const pair<string, vector<CpuState>>& e) {
+    return e.first == key;
+  });
+  es.emplace_front(key, outs);
+  if (es.size() > capacity) {
+    es.pop_back();
+  }
+
+  if (dir.empty()) {
+    return;
+  }
+  // Write to a private file and rename it, so that concurrent readers never see partial entries
+  const auto file = path(dir, key);
+  const auto tmp = file + "." + to_string(getpid());
+  ofstream ofs(tmp, ios::out | ios::binary);
+  const uint64_t count = outs.size();
+  ofs.write(magic, 8);
+  ofs.write((const char*)&count, sizeof(count));
+  for (const auto& cs : outs) {
+    cs.write_bin(ofs);
+  }
+  ofs.close();
+  if (ofs.fail() || rename(tmp.c_str(), file.c_str()) != 0) {
+    unlink(tmp.c_str());
+  }
+}
+
+void ReferenceCache::clear() {
+  entries().clear();
+}
+
+} // namespace stoke
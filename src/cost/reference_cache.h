@@ -0,0 +1,60 @@
+// Copyright 2013-2016 Stanford University
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef STOKE_SRC_COST_REFERENCE_CACHE_H
+#define STOKE_SRC_COST_REFERENCE_CACHE_H
+
+#include <string>
+#include <vector>
+
+#include "src/cfg/cfg.h"
+#include "src/sandbox/sandbox.h"
+#include "src/state/cpu_state.h"
+
+namespace stoke {
+
+/** Remembers the outputs of running a target on a sandbox's inputs, so that cost
+  functions created for the same target and testcases don't have to run it again.
+  Entries are keyed by a hash of the target's code and one of everything else that
+  determines the outputs: the sandbox's inputs, its other functions and settings.
+  Any change to these produces a new key, so stale entries are never returned.
+
+  The most recent entries are kept in memory for the life of the process.  If a
+  directory is given, entries are also written to (and read from) binary files
+  named after their key, which lets parallel searches share them. */
+class ReferenceCache {
+public:
+  /** Magic bytes at the start of a cache file. */
+  static constexpr const char* magic = "STOKERC1";
+  /** The number of entries kept in memory. */
+  static constexpr size_t capacity = 4;
+
+  /** Returns the key for running a target on a sandbox. */
+  static std::string key(const Cfg& target, const Sandbox& sb);
+
+  /** Looks for count outputs in memory, then in dir if it isn't empty; returns
+    true and fills outs on a hit.  Entries of the wrong size, and files that
+    can't be read in full, are misses. */
+  static bool lookup(const std::string& key, const std::string& dir, size_t count, std::vector<CpuState>& outs);
+  /** Remembers outputs in memory, and in dir if it isn't empty.  Failures to
+    write files are ignored; the cache is only an optimization. */
+  static void insert(const std::string& key, const std::string& dir, const std::vector<CpuState>& outs);
+
+  /** Forgets every entry held in memory. */
+  static void clear();
+};
+
+} // namespace stoke
+
+#endif
@@ -25,7 +25,7 @@ namespace stoke {
     (ii) use the fact that vzeroupper removes the penalty;
     (iii) track the state of the ymms with a program analysis.
 
-    (i) and (ii) might be useful.  (iii) probably not. */
+    AvxTransitionCost does all three. */
 
 class SseAvxCost : public CostFunction {
 
@@ -0,0 +1,114 @@
+// Copyright 2013-2016 Stanford University
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <sys/mman.h>
+
+#include <algorithm>
+#include <cstring>
+
+#include "src/sandbox/exec_arena.h"
+
+using namespace std;
+using namespace x64asm;
+
+namespace {
+
+/** Chunks are sized and aligned for a single 2MB huge page. */
+constexpr size_t chunk_size = 2 * 1024 * 1024;
+/** Entrypoints are aligned to the decoder's fetch width. */
+constexpr size_t fxn_align = 16;
+
+} // namespace
+
+namespace stoke {
+
+ExecArena::~ExecArena() {
+  for (const auto& c : chunks_) {
+    munmap(c.base, c.capacity);
+  }
+}
+
+void* ExecArena::insert(const Function& fxn) {
+  const auto n = fxn.size();
+  head_ = (head_ + fxn_align - 1) & ~(fxn_align - 1);
+  if (chunks_.empty() || head_ + n > chunks_.back().capacity) {
+    if (!grow(n)) {
+      return nullptr;
+    }
+  }
+
+  auto res = chunks_.back().base + head_;
+  memcpy(res, fxn.get_entrypoint(), n);
+  head_ += n;
+
+  return res;
+}
+
+ExecArena& ExecArena::clear() {
+  for (size_t i = 1, ie = chunks_.size(); i < ie; ++i) {
+    munmap(chunks_[i].base, chunks_[i].capacity);
+  }
+  if (!chunks_.empty()) {
+    chunks_.resize(1);
+  }
+  head_ = 0;
+
+  return *this;
+}
+
+size_t ExecArena::size() const {
+  size_t res = head_;
+  for (size_t i = 0, ie = chunks_.empty() ? 0 : chunks_.size() - 1; i < ie; ++i) {
+    res += chunks_[i].capacity;
+  }
+  return res;
+}
+
+bool ExecArena::grow(size_t min) {
+  const auto capacity = (max(min, chunk_size) + chunk_size - 1) & ~(chunk_size - 1);
+  const auto prot = PROT_READ | PROT_WRITE | PROT_EXEC;
+  const auto flags = MAP_PRIVATE | MAP_ANONYMOUS;
+
+  // Ask for the pages right after the last chunk so that code stays contiguous
+  // across chunks; the kernel is free to ignore the hint.
+  auto hint = chunks_.empty() ? nullptr : chunks_.back().base + chunks_.back().capacity;
+
+  void* base = MAP_FAILED;
+#ifdef MAP_HUGETLB
+  if (huge_pages_) {
+    base = mmap(hint, capacity, prot, flags | MAP_HUGETLB, -1, 0);
+  }
+#endif
+  if (base == MAP_FAILED) {
+    base = mmap(hint, capacity, prot, flags, -1, 0);
+    if (base == MAP_FAILED) {
+      return false;
+    }
+#ifdef MADV_HUGEPAGE
+    if (huge_pages_) {
+      madvise(base, capacity, MADV_HUGEPAGE);
+    }
+#endif
+  }
+
+  // Pad unused space with int3 so that stray jumps trap
+  memset(base, 0xcc, capacity);
+
+  chunks_.push_back({(uint8_t*)base, capacity});
+  head_ = 0;
+
+  return true;
+}
+
+} // namespace stoke
@@ -0,0 +1,88 @@
+// Copyright 2013-2016 Stanford University
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef STOKE_SRC_SANDBOX_EXEC_ARENA_H
+#define STOKE_SRC_SANDBOX_EXEC_ARENA_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include "src/ext/x64asm/include/x64asm.h"
+
+namespace stoke {
+
+/** A bump allocator for executable code. Assembled functions are copied into
+  large executable chunks one after the other, so code that runs together sits
+  together in memory and on as few pages as possible. Individual allocations
+  can't be freed; clear() releases everything at once. Only position-independent
+  code may be copied (i.e. code that refers to other functions by absolute
+  address rather than by relative displacement). */
+class ExecArena {
+public:
+  /** Creates an empty arena. */
+  ExecArena() : head_(0) {
+    set_huge_pages(false);
+  }
+  /** Arenas hand out raw pointers and can't be copied. */
+  ExecArena(const ExecArena& rhs) = delete;
+  ExecArena& operator=(const ExecArena& rhs) = delete;
+  /** Releases all memory. */
+  ~ExecArena();
+
+  /** Toggles whether new chunks should be backed by huge pages. If none are
+    available, chunks fall back to regular pages with a transparent huge page hint. */
+  ExecArena& set_huge_pages(bool b) {
+    huge_pages_ = b;
+    return *this;
+  }
+  /** Are new chunks backed by huge pages? */
+  bool get_huge_pages() const {
+    return huge_pages_;
+  }
+
+  /** Copies the code in fxn into the arena; returns its new entrypoint, or nullptr
+    if no memory could be mapped. */
+  void* insert(const x64asm::Function& fxn);
+  /** Frees every allocation; the first chunk is kept around for reuse. */
+  ExecArena& clear();
+
+  /** Returns the number of bytes spanned by allocations since the last clear. */
+  size_t size() const;
+  /** Returns the number of chunks currently mapped. */
+  size_t num_chunks() const {
+    return chunks_.size();
+  }
+
+private:
+  /** A contiguous region of executable memory. */
+  struct Chunk {
+    uint8_t* base;
+    size_t capacity;
+  };
+
+  /** Mapped chunks; only the last one is allocated from. */
+  std::vector<Chunk> chunks_;
+  /** Offset of the next free byte in the last chunk. */
+  size_t head_;
+  /** Should new chunks use huge pages? */
+  bool huge_pages_;
+
+  /** Maps a new chunk of at least this many bytes; returns false on failure. */
+  bool grow(size_t min);
+};
+
+} // namespace stoke
+
+#endif
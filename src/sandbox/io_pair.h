@@ -15,6 +15,8 @@
 #ifndef STOKE_SRC_SANDBOX_IO_PAIR_H
 #define STOKE_SRC_SANDBOX_IO_PAIR_H
 
+#include <vector>
+
 #include "src/ext/x64asm/include/x64asm.h"
 
 #include "src/state/cpu_state.h"
@@ -31,17 +33,31 @@ class IoPair {
 
   /** Input state (this never changes). */
   CpuState in_;
-  /** Copies input state to cpu. */
-  x64asm::Function in2cpu_;
+  /** Copies input state to cpu (lives in the sandbox's code arena). */
+  void* in2cpu_;
 
   /** Output state (this is modified as code executes). */
   CpuState out_;
-  /** Copies output state to cpu. */
-  x64asm::Function out2cpu_;
-  /** Reads output state from cpu. */
-  x64asm::Function cpu2out_;
-  /** Sandboxes memory accesses for this output state. */
-  x64asm::Function map_addr_;
+  /** Copies output state to cpu (lives in the sandbox's code arena). */
+  void* out2cpu_;
+  /** Reads output state from cpu (lives in the sandbox's code arena). */
+  void* cpu2out_;
+  /** Sandboxes memory accesses for this output state (lives in the sandbox's code arena). */
+  void* map_addr_;
+
+  /** States part way through the snapshot function (see Sandbox::take_snapshots()). */
+  std::vector<CpuState> snapshots_;
+  /** The snapshot a resumed run starts from. */
+  CpuState resume_;
+  /** Copies the resumed state to cpu (lives in the sandbox's code arena). */
+  void* resume2cpu_;
+
+  /** Is the input worth running?  It isn't if it's in an error state, or if
+    there was no room in the arena for its helper functions. */
+  bool runnable() const {
+    return in_.code == ErrorCode::NORMAL && in2cpu_ != nullptr && out2cpu_ != nullptr &&
+           cpu2out_ != nullptr && map_addr_ != nullptr && resume2cpu_ != nullptr;
+  }
 };
 
 } // namespace stoke
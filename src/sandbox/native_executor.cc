@@ -0,0 +1,821 @@
+// Copyright 2013-2016 Stanford University
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <fcntl.h>
+#include <setjmp.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include "src/sandbox/dispatch_table.h"
+#include "src/sandbox/native_executor.h"
+
+// Older headers don't know about this flag, and older kernels treat it as a
+// hint; run_one() checks the address it gets back either way.
+#ifndef MAP_FIXED_NOREPLACE
+#define MAP_FIXED_NOREPLACE 0x100000
+#endif
+
+using namespace std;
+using namespace stoke;
+using namespace x64asm;
+
+namespace {
+
+constexpr uint64_t page_size = 4096;
+/** Below this, mmap is refused by default (vm.mmap_min_addr). */
+constexpr uint64_t min_addr = 0x10000;
+/** Above this, addresses are either non-canonical or reserved by the kernel. */
+constexpr uint64_t max_addr = 0x00007ffffffff000;
+
+uint64_t round_up(uint64_t x, uint64_t align) {
+  return (x + align - 1) & ~(align - 1);
+}
+
+/** The number of bytes a region takes up in a record: its contents and its valid mask. */
+size_t record_bytes(const Memory& m) {
+  return round_up(m.size(), 8) + round_up((m.size() + 7) / 8, 8);
+}
+
+/** The helper's guard list, for the signal handler. */
+const uint64_t* helper_num_guards_ = nullptr;
+const void* helper_guards_ = nullptr;
+
+sigjmp_buf helper_buf_;
+void helper_handler(int signum) {
+  // Everything but the control block may be read-only; put it back before
+  // returning to code that expects to write its stack
+  const auto guards = (const uint64_t*)helper_guards_;
+  for (size_t i = 0, ie = *helper_num_guards_; i < ie; ++i) {
+    syscall(SYS_mprotect, guards[4*i], guards[4*i+1], guards[4*i+3]);
+  }
+  siglongjmp(helper_buf_, signum);
+}
+
+ErrorCode to_error_code(int signum) {
+  switch (signum) {
+  case 0:
+    return ErrorCode::NORMAL;
+  case SIGSEGV:
+    return ErrorCode::SIGSEGV_;
+  case SIGBUS:
+    return ErrorCode::SIGBUS_;
+  case SIGFPE:
+    return ErrorCode::SIGFPE_;
+  default:
+    // Unsupported opcodes never run natively; this is the trap after the last instruction
+    return ErrorCode::SIGCUSTOM_NO_RETURN;
+  }
+}
+
+template <typename F>
+void for_each_region(CpuState& cs, F f) {
+  f(cs.stack);
+  f(cs.heap);
+  f(cs.data);
+  for (auto& s : cs.segments) {
+    f(s);
+  }
+}
+
+/** Does the page at this address hold a valid byte of any region? */
+bool page_is_valid(CpuState& cs, uint64_t page) {
+  bool valid = false;
+  for_each_region(cs, [&](Memory& m) {
+    if (valid || m.size() == 0) {
+      return;
+    }
+    const auto lb = m.lower_bound();
+    const auto lo = max(page, lb);
+    const auto hi = min(page + page_size, lb + m.size());
+    if (lo >= hi) {
+      return;
+    }
+    // Regions and pages are 32-byte aligned, so every page starts on a mask byte
+    const auto mask = (const uint8_t*)m.valid_mask();
+    for (size_t i = (lo - lb) / 8, ie = (hi - lb + 7) / 8; i < ie && !valid; ++i) {
+      valid = mask[i] != 0;
+    }
+  });
+  return valid;
+}
+
+/** Parses a hex number; advances p past it. */
+uint64_t parse_hex(const char*& p) {
+  uint64_t x = 0;
+  for (;; ++p) {
+    if (*p >= '0' && *p <= '9') {
+      x = x * 16 + (*p - '0');
+    } else if (*p >= 'a' && *p <= 'f') {
+      x = x * 16 + (*p - 'a' + 10);
+    } else {
+      return x;
+    }
+  }
+}
+
+} // namespace
+
+namespace stoke {
+
+NativeExecutor::NativeExecutor() :
+  assembled_(false), dirty_(true), code_(nullptr), code_size_(0), shared_(nullptr), shared_size_(0),
+  helper_(-1), socket_(-1), runs_(0), helper_starts_(0) {
+  set_timeout(100000);
+
+  // The control block has to be at the same address in the helper, so it's
+  // mapped here, before there is a helper
+  control_size_ = round_up(sizeof(Control), page_size);
+  auto ptr = mmap(0, control_size_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  control_ = ptr == MAP_FAILED ? nullptr : (Control*)ptr;
+  frame_ = control_ == nullptr ? nullptr : &control_->frame;
+}
+
+NativeExecutor::~NativeExecutor() {
+  stop_helper();
+  clear_functions();
+  if (control_ != nullptr) {
+    munmap(control_, control_size_);
+  }
+  if (code_ != nullptr) {
+    munmap(code_, code_size_);
+  }
+  if (shared_ != nullptr) {
+    munmap(shared_, shared_size_);
+  }
+}
+
+bool NativeExecutor::is_supported(const Instruction& instr) {
+  static DispatchTable table;
+  switch (table.lookup(instr)) {
+  case DispatchTable::SIGILL_:
+  case DispatchTable::CALL_LABEL:
+  case DispatchTable::POPF:
+    return false;
+  case DispatchTable::MEM_DIV:
+  case DispatchTable::MEM_PUSH:
+  case DispatchTable::MEM_POP:
+  case DispatchTable::MEM_BT:
+  case DispatchTable::MEM_INSTR:
+    return !instr.get_operand<Mem>(instr.mem_index()).rip_offset();
+  case DispatchTable::INSTR:
+    return !(instr.is_lea() && instr.get_operand<Mem>(1).rip_offset());
+  default:
+    return true;
+  }
+}
+
+NativeExecutor& NativeExecutor::insert_function(const Cfg& cfg) {
+  assert(cfg.get_function().invariant_first_instr_is_label());
+  const auto label = cfg.get_function().get_leading_label();
+  const auto& code = cfg.get_code();
+
+  fxns_[label] = code;
+  dirty_ = true;
+
+  unsupported_.erase(label);
+  for (const auto& instr : code) {
+    if (!is_supported(instr)) {
+      unsupported_[label] = true;
+      break;
+    }
+  }
+
+  // Only loop-free code runs natively, so that every jump runs at most once and
+  // the sandbox's jump limit can be checked before running anything
+  unordered_map<Label, size_t> defs;
+  for (size_t i = 0, ie = code.size(); i < ie; ++i) {
+    if (code[i].is_label_defn()) {
+      defs[code[i].get_operand<Label>(0)] = i;
+    }
+  }
+  auto& jumps = jumps_[label];
+  jumps = 0;
+  for (size_t i = 0, ie = code.size(); i < ie; ++i) {
+    if (code[i].is_any_loop()) {
+      unsupported_[label] = true;
+    } else if (code[i].is_cond_jump() || code[i].is_uncond_jump()) {
+      const auto itr = defs.find(code[i].get_operand<Label>(0));
+      if (itr == defs.end() || itr->second <= i) {
+        unsupported_[label] = true;
+      }
+      jumps++;
+    }
+  }
+  return *this;
+}
+
+NativeExecutor& NativeExecutor::clear_functions() {
+  fxns_.clear();
+  unsupported_.clear();
+  jumps_.clear();
+  dirty_ = true;
+  return *this;
+}
+
+void NativeExecutor::run(const vector<pair<const CpuState*, CpuState*>>& tcs, vector<bool>& done) {
+  done.assign(tcs.size(), false);
+  if (!good() || control_ == nullptr || fxns_.find(main_fxn_) == fxns_.end()) {
+    return;
+  }
+
+  // Work out where everything goes in the shared buffer
+  plans_.clear();
+  ranges_.clear();
+  size_t offset = sizeof(Header);
+  for (size_t i = 0, ie = tcs.size(); i < ie; ++i) {
+    const auto first = ranges_.size();
+    if (!plan(*tcs[i].second)) {
+      continue;
+    }
+    plans_.push_back({i, first, ranges_.size(), offset});
+
+    offset += sizeof(Record) + (ranges_.size() - first) * sizeof(Range);
+    for_each_region(*tcs[i].second, [&](Memory& m) {
+      offset += sizeof(Region) + record_bytes(m);
+    });
+  }
+  if (plans_.empty() || !reserve(offset) || !publish() || !start_helper()) {
+    return;
+  }
+
+  // Write the request
+  auto header = (Header*)shared_;
+  header->count = plans_.size();
+  header->timeout = timeout_;
+  for (const auto& p : plans_) {
+    auto& cs = *tcs[p.index].second;
+    auto rec = (Record*)(shared_ + p.offset);
+    rec->done = 0;
+    rec->num_ranges = p.range_end - p.range_begin;
+    rec->num_regions = 0;
+    for_each_region(cs, [&](Memory&) {
+      rec->num_regions++;
+    });
+
+    for (size_t r = 0; r < 16; ++r) {
+      rec->frame.gp[r] = cs.gp[r].get_fixed_quad(0);
+    }
+    for (size_t s = 0; s < 16; ++s) {
+      memcpy(rec->frame.sse[s], cs.sse[s].data(), sizeof(rec->frame.sse[s]));
+    }
+    memcpy(&rec->frame.rf, cs.rf.data(), sizeof(rec->frame.rf));
+
+    auto ranges = (Range*)(rec + 1);
+    copy(ranges_.begin() + p.range_begin, ranges_.begin() + p.range_end, ranges);
+    auto regions = (Region*)(ranges + rec->num_ranges);
+    auto mem = (uint8_t*)(regions + rec->num_regions);
+    for_each_region(cs, [&](Memory& m) {
+      *regions++ = {m.lower_bound(), m.size()};
+      memcpy(mem, m.data(), m.size());
+      memcpy(mem + round_up(m.size(), 8), m.valid_mask(), (m.size() + 7) / 8);
+      mem += record_bytes(m);
+    });
+  }
+
+  // One byte each way; anything the helper didn't finish (because it died) is left to the caller
+  char c = 0;
+  if (send(socket_, &c, 1, MSG_NOSIGNAL) != 1 || recv(socket_, &c, 1, 0) != 1) {
+    stop_helper();
+  }
+
+  for (const auto& p : plans_) {
+    const auto rec = (const Record*)(shared_ + p.offset);
+    if (!rec->done) {
+      continue;
+    }
+    auto& cs = *tcs[p.index].second;
+    cs.code = (ErrorCode)rec->code;
+
+    for (size_t r = 0; r < 16; ++r) {
+      cs.gp[r].get_fixed_quad(0) = rec->frame.gp[r];
+    }
+    // The trampoline called into the user's code from one quad above their %rsp
+    if (cs.code == ErrorCode::NORMAL) {
+      cs.gp[rsp].get_fixed_quad(0) -= 8;
+    }
+    for (size_t s = 0; s < 16; ++s) {
+      memcpy(cs.sse[s].data(), rec->frame.sse[s], sizeof(rec->frame.sse[s]));
+    }
+    memcpy(cs.rf.data(), &rec->frame.rf, sizeof(rec->frame.rf));
+
+    auto mem = (const uint8_t*)((const Region*)((const Range*)(rec + 1) + rec->num_ranges) + rec->num_regions);
+    for_each_region(cs, [&](Memory& m) {
+      memcpy(m.data(), mem, m.size());
+      mem += record_bytes(m);
+    });
+    done[p.index] = true;
+    runs_++;
+  }
+}
+
+bool NativeExecutor::plan(CpuState& cs) {
+  // The trampoline's return address temporarily replaces the quad at the user's %rsp
+  const auto user_rsp = cs.gp[rsp].get_fixed_quad(0);
+  for (size_t i = 0; i < 8; ++i) {
+    if (!cs.stack.in_range(user_rsp + i) || !cs.stack.is_valid(user_rsp + i)) {
+      return false;
+    }
+  }
+
+  const auto first = ranges_.size();
+  bool ok = true;
+  for_each_region(cs, [&](Memory& m) {
+    if (m.size() == 0) {
+      return;
+    }
+    const auto lb = m.lower_bound();
+    const auto ub = lb + m.size();
+    if (lb < min_addr || ub < lb || ub > max_addr) {
+      ok = false;
+      return;
+    }
+    ranges_.push_back({lb & ~(page_size - 1), (ub + page_size - 1) & ~(page_size - 1), true});
+  });
+  if (!ok) {
+    ranges_.resize(first);
+    return false;
+  }
+
+  // Regions can share pages; merge them so that every page is mapped once
+  sort(ranges_.begin() + first, ranges_.end(), [](const Range& a, const Range& b) {
+    return a.begin < b.begin;
+  });
+  auto n = first;
+  for (size_t i = first, ie = ranges_.size(); i < ie; ++i) {
+    if (n > first && ranges_[i].begin <= ranges_[n-1].end) {
+      ranges_[n-1].end = max(ranges_[n-1].end, ranges_[i].end);
+    } else {
+      ranges_[n++] = ranges_[i];
+    }
+  }
+  ranges_.resize(n);
+
+  // Then split them into runs of pages with the same protection
+  const auto merged = ranges_.size();
+  for (auto i = first; i < merged; ++i) {
+    const auto r = ranges_[i];
+    for (auto page = r.begin; page < r.end; page += page_size) {
+      const uint64_t writable = page_is_valid(cs, page);
+      if (ranges_.size() > merged && ranges_.back().end == page && ranges_.back().writable == writable) {
+        ranges_.back().end += page_size;
+      } else {
+        ranges_.push_back({page, page + page_size, writable});
+      }
+    }
+  }
+  ranges_.erase(ranges_.begin() + first, ranges_.begin() + merged);
+
+  return true;
+}
+
+bool NativeExecutor::reserve(size_t size) {
+  if (size <= shared_size_) {
+    return true;
+  }
+
+  // The helper only knows the old mapping
+  stop_helper();
+  if (shared_ != nullptr) {
+    munmap(shared_, shared_size_);
+  }
+  size = round_up(max(size, 2 * shared_size_), page_size);
+  const auto ptr = mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if (ptr == MAP_FAILED) {
+    shared_ = nullptr;
+    shared_size_ = 0;
+    return false;
+  }
+  shared_ = (uint8_t*)ptr;
+  shared_size_ = size;
+  return true;
+}
+
+bool NativeExecutor::publish() {
+  if (!dirty_) {
+    return assembled_;
+  }
+  dirty_ = false;
+  assembled_ = false;
+
+  // Calls the main function with the register state in frame_, and writes the
+  // register state it returns with back to frame_.
+  //
+  // Calling Context:
+  //   - run_one(), in the helper process
+  // Assumptions:
+  //   - frame_->gp[rsp] holds the user's %rsp, and the quad it points to is mapped
+  //   - control_ holds the mappings to guard
+  // Requirements:
+  //   - MUST leave callee-save registers unmodified
+  //   - MUST NOT touch the host stack while mappings are guarded
+  // Arguments:
+  //   - <none>
+
+  const auto& code = fxns_[main_fxn_];
+  blob_.reserve(32 * code.size() + 4096);
+  assm_.start(blob_);
+
+  assm_.push_1(rbx);
+  assm_.push_1(rbp);
+  assm_.push_1(r12);
+  assm_.push_1(r13);
+  assm_.push_1(r14);
+  assm_.push_1(r15);
+  assm_.mov(rax, rsp);
+  assm_.mov(Moffs64(&frame_->host_rsp), rax);
+
+  // From here until the user's code returns, only the control block is writable
+  emit_guard(true);
+
+  // Load RFLAGS first, on the scratch stack; nothing that follows modifies them
+  assm_.mov((R64)rax, Imm64(control_->scratch + sizeof(control_->scratch)));
+  assm_.mov(rsp, rax);
+  assm_.mov(rax, Moffs64(&frame_->rf));
+  assm_.push_1(rax);
+  assm_.popfq();
+  for (const auto& s : xmms) {
+    assm_.mov((R64)rax, Imm64(frame_->sse[s]));
+#if defined(HASWELL_BUILD) || defined(SANDYBRIDGE_BUILD)
+    assm_.vmovdqu(ymms[s], M256(rax));
+#else
+    assm_.movdqu(xmms[s], M128(rax));
+#endif
+  }
+  for (const auto& r : r64s) {
+    if (r != rsp && r != rax) {
+      assm_.mov(r, Imm64(&frame_->gp[r]));
+      assm_.mov(r, M64(r));
+    }
+  }
+  // Offset %rsp so that the call leaves the user's %rsp pointing at the return address
+  assm_.mov(rax, Moffs64(&frame_->gp[rsp]));
+  assm_.mov(rsp, rax);
+  assm_.lea(rsp, M64(rsp, Imm32(8)));
+  assm_.mov(rax, Moffs64(&frame_->gp[rax]));
+
+  assm_.assemble({CALL_LABEL, {main_fxn_}});
+
+  assm_.mov(Moffs64(&frame_->gp[rax]), rax);
+  assm_.mov(rax, rsp);
+  assm_.mov(Moffs64(&frame_->gp[rsp]), rax);
+  for (const auto& r : r64s) {
+    if (r != rsp && r != rax) {
+      assm_.mov(rax, r);
+      assm_.mov(Moffs64(&frame_->gp[r]), rax);
+    }
+  }
+  for (const auto& s : xmms) {
+    assm_.mov((R64)rax, Imm64(frame_->sse[s]));
+#if defined(HASWELL_BUILD) || defined(SANDYBRIDGE_BUILD)
+    assm_.vmovdqu(M256(rax), ymms[s]);
+#else
+    assm_.movdqu(M128(rax), xmms[s]);
+#endif
+  }
+  // RFLAGS next, on the scratch stack, since putting the guards back changes them
+  assm_.mov((R64)rax, Imm64(control_->scratch + sizeof(control_->scratch)));
+  assm_.mov(rsp, rax);
+  assm_.pushfq();
+  assm_.pop_1(rax);
+  assm_.mov(Moffs64(&frame_->rf), rax);
+  assm_.assemble({CLD});
+
+  emit_guard(false);
+
+  assm_.mov(rax, Moffs64(&frame_->host_rsp));
+  assm_.mov(rsp, rax);
+  assm_.pop_1(r15);
+  assm_.pop_1(r14);
+  assm_.pop_1(r13);
+  assm_.pop_1(r12);
+  assm_.pop_1(rbp);
+  assm_.pop_1(rbx);
+  assm_.ret();
+
+  // The main function follows; code that runs off its end traps rather than
+  // running into whatever follows
+  for (const auto& instr : code) {
+    assm_.assemble(instr);
+  }
+  assm_.assemble({UD2});
+  if (!assm_.finish()) {
+    return false;
+  }
+
+  // Only a bigger code buffer needs a new helper
+  if (blob_.size() > code_size_) {
+    stop_helper();
+    if (code_ != nullptr) {
+      munmap(code_, code_size_);
+    }
+    const auto size = round_up(max(blob_.size(), 2 * code_size_), page_size);
+    const auto ptr = mmap(0, size, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (ptr == MAP_FAILED) {
+      code_ = nullptr;
+      code_size_ = 0;
+      return false;
+    }
+    code_ = (uint8_t*)ptr;
+    code_size_ = size;
+  }
+  memcpy(code_, blob_.get_entrypoint(), blob_.size());
+
+  assembled_ = true;
+  return true;
+}
+
+void NativeExecutor::emit_guard(bool guard) {
+  const Label loop(guard ? "__native_guard_loop" : "__native_unguard_loop");
+  const Label done(guard ? "__native_guard_done" : "__native_unguard_done");
+
+  // for (rbx = guards, r12 = num_guards; r12 != 0; rbx += sizeof(Guard), --r12)
+  //   mprotect(rbx->begin, rbx->size, guard ? rbx->guarded : rbx->prot)
+  assm_.mov((R64)rbx, Imm64(control_->guards));
+  assm_.mov(rax, Moffs64(&control_->num_guards));
+  assm_.mov(r12, rax);
+  assm_.bind(loop);
+  assm_.test(r12, r12);
+  assm_.je_1(done);
+  assm_.mov(rax, Imm32(SYS_mprotect));
+  assm_.mov(rdi, M64(rbx));
+  assm_.mov(rsi, M64(rbx, Imm32(8)));
+  assm_.mov(rdx, M64(rbx, Imm32(guard ? 16 : 24)));
+  assm_.assemble({SYSCALL});
+  assm_.add(rbx, Imm32(sizeof(Guard)));
+  assm_.dec(r12);
+  assm_.jmp_1(loop);
+  assm_.bind(done);
+}
+
+bool NativeExecutor::start_helper() {
+  if (helper_ != -1) {
+    return true;
+  }
+
+  int fds[2];
+  if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) {
+    return false;
+  }
+  const auto pid = fork();
+  if (pid == -1) {
+    close(fds[0]);
+    close(fds[1]);
+    return false;
+  } else if (pid == 0) {
+    prctl(PR_SET_PDEATHSIG, SIGKILL);
+    close(fds[0]);
+    socket_ = fds[1];
+    run_helper();
+  }
+
+  close(fds[1]);
+  helper_ = pid;
+  socket_ = fds[0];
+  helper_starts_++;
+  return true;
+}
+
+void NativeExecutor::stop_helper() {
+  if (helper_ == -1) {
+    return;
+  }
+  // Other helpers may hold a copy of our end of the socket, so closing it
+  // isn't enough to make this one exit
+  close(socket_);
+  kill(helper_, SIGKILL);
+  while (waitpid(helper_, nullptr, 0) == -1 && errno == EINTR);
+  helper_ = -1;
+  socket_ = -1;
+}
+
+void NativeExecutor::run_helper() {
+  stack_t ss;
+  ss.ss_sp = control_->alt_stack;
+  ss.ss_size = sizeof(control_->alt_stack);
+  ss.ss_flags = 0;
+  sigaltstack(&ss, 0);
+
+  struct sigaction sa;
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = helper_handler;
+  sigemptyset(&sa.sa_mask);
+  sa.sa_flags = SA_ONSTACK | SA_NODEFER;
+  for (auto sig : {
+         SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGALRM
+       }) {
+    sigaction(sig, &sa, 0);
+  }
+  helper_num_guards_ = &control_->num_guards;
+  helper_guards_ = control_->guards;
+
+  // The helper only ever runs the code buffer
+  mprotect(code_, code_size_, PROT_READ | PROT_EXEC);
+
+  char c;
+  while (recv(socket_, &c, 1, 0) == 1) {
+    // Mappings can come and go (the stack grows, for one), so look every time
+    if (find_guards()) {
+      const auto header = (const Header*)shared_;
+      const auto timeout = header->timeout;
+      auto rec = (Record*)(shared_ + sizeof(Header));
+      for (size_t i = 0, ie = header->count; i < ie; ++i) {
+        run_one(rec, timeout);
+        auto next = (uint8_t*)((Region*)((Range*)(rec + 1) + rec->num_ranges) + rec->num_regions);
+        for (auto r = (Region*)((Range*)(rec + 1) + rec->num_ranges), re = r + rec->num_regions; r != re; ++r) {
+          next += round_up(r->size, 8) + round_up((r->size + 7) / 8, 8);
+        }
+        rec = (Record*)next;
+      }
+    }
+    if (send(socket_, &c, 1, MSG_NOSIGNAL) != 1) {
+      break;
+    }
+  }
+  _exit(0);
+}
+
+bool NativeExecutor::find_guards() {
+  const auto fd = open("/proc/self/maps", O_RDONLY);
+  if (fd == -1) {
+    return false;
+  }
+
+  // Lines are read into a fixed buffer; the helper must not allocate
+  const auto ctrl_begin = (uint64_t)control_;
+  const auto ctrl_end = ctrl_begin + control_size_;
+  const auto add = [this](uint64_t begin, uint64_t end, uint64_t prot) {
+    if (begin >= end) {
+      return true;
+    }
+    // Adjacent mappings with the same protection take a single mprotect
+    auto& n = control_->num_guards;
+    if (n > 0 && control_->guards[n-1].begin + control_->guards[n-1].size == begin &&
+        control_->guards[n-1].prot == prot) {
+      control_->guards[n-1].size += end - begin;
+      return true;
+    }
+    if (control_->num_guards == max_guards) {
+      return false;
+    }
+    control_->guards[control_->num_guards++] = {begin, end - begin, prot & ~(uint64_t)PROT_WRITE, prot};
+    return true;
+  };
+
+  control_->num_guards = 0;
+  char buf[4096];
+  char line[512];
+  size_t len = 0;
+  bool ok = true;
+  ssize_t n;
+  while (ok && (n = read(fd, buf, sizeof(buf))) > 0) {
+    for (ssize_t i = 0; i < n && ok; ++i) {
+      if (buf[i] != '\n') {
+        if (len + 1 < sizeof(line)) {
+          line[len++] = buf[i];
+        }
+        continue;
+      }
+      line[len] = '\0';
+      len = 0;
+
+      // begin-end perms ...
+      const char* p = line;
+      const auto begin = parse_hex(p);
+      if (*p++ != '-') {
+        continue;
+      }
+      const auto end = parse_hex(p);
+      if (*p++ != ' ' || p[0] == '\0' || p[1] != 'w') {
+        continue;
+      }
+      const uint64_t prot = (p[0] == 'r' ? PROT_READ : 0) | PROT_WRITE | (p[2] == 'x' ? PROT_EXEC : 0);
+
+      // The control block may have been merged with its neighbors
+      ok = add(begin, min(end, max(begin, ctrl_begin)), prot) && add(max(begin, min(end, ctrl_end)), end, prot);
+    }
+  }
+  close(fd);
+  if (!ok) {
+    control_->num_guards = 0;
+  }
+  return ok && n == 0;
+}
+
+void NativeExecutor::run_one(Record* rec, size_t timeout) {
+  const auto ranges = (const Range*)(rec + 1);
+  const auto regions = (const Region*)(ranges + rec->num_ranges);
+  const auto data = (uint8_t*)(regions + rec->num_regions);
+
+  // Map memory at its original addresses; give up if anything is in the way
+  for (size_t i = 0; i < rec->num_ranges; ++i) {
+    const auto& r = ranges[i];
+    const auto ptr = mmap((void*)r.begin, r.end - r.begin, PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+    if (ptr != (void*)r.begin) {
+      if (ptr != MAP_FAILED) {
+        munmap(ptr, r.end - r.begin);
+      }
+      for (size_t j = 0; j < i; ++j) {
+        munmap((void*)ranges[j].begin, ranges[j].end - ranges[j].begin);
+      }
+      return;
+    }
+  }
+  auto mem = data;
+  for (size_t i = 0; i < rec->num_regions; ++i) {
+    memcpy((void*)regions[i].begin, mem, regions[i].size);
+    mem += round_up(regions[i].size, 8) + round_up((regions[i].size + 7) / 8, 8);
+  }
+  for (size_t i = 0; i < rec->num_ranges; ++i) {
+    if (!ranges[i].writable) {
+      mprotect((void*)ranges[i].begin, ranges[i].end - ranges[i].begin, PROT_NONE);
+    }
+  }
+
+  // Load the frame and save the quad that the return address will overwrite
+  *frame_ = rec->frame;
+  const auto user_rsp = (uint64_t*)frame_->gp[rsp];
+  const auto saved = *user_rsp;
+
+  itimerval timer;
+  memset(&timer, 0, sizeof(timer));
+  timer.it_value.tv_sec = timeout / 1000000;
+  timer.it_value.tv_usec = timeout % 1000000;
+  setitimer(ITIMER_REAL, &timer, 0);
+
+  const auto signum = sigsetjmp(helper_buf_, 1);
+  if (signum == 0) {
+    ((void (*)())code_)();
+  }
+
+  memset(&timer, 0, sizeof(timer));
+  setitimer(ITIMER_REAL, &timer, 0);
+
+  // Loop-free code can't legitimately get here; leave the testcase to the sandbox
+  if (signum == SIGALRM) {
+    for (size_t i = 0; i < rec->num_ranges; ++i) {
+      munmap((void*)ranges[i].begin, ranges[i].end - ranges[i].begin);
+    }
+    return;
+  }
+  auto code = to_error_code(signum);
+
+  // Undo the protections and the return address, then look for writes to invalid bytes
+  for (size_t i = 0; i < rec->num_ranges; ++i) {
+    if (!ranges[i].writable) {
+      mprotect((void*)ranges[i].begin, ranges[i].end - ranges[i].begin, PROT_READ | PROT_WRITE);
+    }
+  }
+  *user_rsp = saved;
+  mem = data;
+  for (size_t r = 0; r < rec->num_regions; ++r) {
+    const auto size = regions[r].size;
+    const auto before = mem;
+    const auto mask = mem + round_up(size, 8);
+    const auto after = (uint8_t*)regions[r].begin;
+    if (code == ErrorCode::NORMAL) {
+      for (size_t i = 0; i < size; ++i) {
+        if (!((mask[i/8] >> (i%8)) & 0x1) && before[i] != after[i]) {
+          code = ErrorCode::SIGSEGV_;
+        }
+      }
+    }
+    mem += round_up(size, 8) + round_up((size + 7) / 8, 8);
+  }
+
+  // Publish the results and release the memory
+  mem = data;
+  for (size_t r = 0; r < rec->num_regions; ++r) {
+    memcpy(mem, (const void*)regions[r].begin, regions[r].size);
+    mem += round_up(regions[r].size, 8) + round_up((regions[r].size + 7) / 8, 8);
+  }
+  for (size_t i = 0; i < rec->num_ranges; ++i) {
+    munmap((void*)ranges[i].begin, ranges[i].end - ranges[i].begin);
+  }
+  rec->frame = *frame_;
+  rec->code = (uint64_t)code;
+  rec->done = 1;
+}
+
+} // namespace stoke
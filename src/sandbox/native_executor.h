@@ -0,0 +1,253 @@
+// Copyright 2013-2016 Stanford University
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef STOKE_SRC_SANDBOX_NATIVE_EXECUTOR_H
+#define STOKE_SRC_SANDBOX_NATIVE_EXECUTOR_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "src/ext/x64asm/include/x64asm.h"
+
+#include "src/cfg/cfg.h"
+#include "src/state/cpu_state.h"
+
+namespace stoke {
+
+/** Runs uninstrumented code against testcases in a helper process.  The
+  helper is forked once and kept alive between runs; testcases, code and
+  results are exchanged through shared memory, and each run is a single
+  message over a socket.  For every testcase, the helper maps its stack,
+  heap, data and segments at their original addresses, with read/write access
+  for pages that hold a valid byte and no access otherwise, and reports
+  hardware faults as error codes.  Testcases that can't be run this way (their
+  memory collides with the helper's own mappings, isn't canonical, or the
+  helper dies) are reported as not done so that the caller can fall back to
+  the instrumented sandbox.
+
+  While user code runs, every other writable mapping in the helper (its heap,
+  stack, libraries and the shared result buffer) is made read-only, so stray
+  stores fault instead of corrupting the helper.  The exception is a small
+  control block the trampoline itself needs; damaging it can only kill the
+  helper, which the caller sees as testcases not done.
+
+  Protection is page-granular: reads of invalid bytes that share a page with a
+  valid byte go unnoticed, and writes to them are only caught by comparing the
+  invalid bytes of every region before and after execution.
+
+  Only loop-free code runs natively: every jump must go forward and calls are
+  unsupported, so each jump runs at most once and whether a run would exceed
+  the sandbox's jump limit is known from get_jumps() before running it.  A
+  wall-clock timeout remains as a backstop; testcases that hit it are reported
+  as not done rather than given an error code, so results never depend on
+  machine load. */
+class NativeExecutor {
+public:
+  /** Creates an executor with no functions. */
+  NativeExecutor();
+  /** Executors own a helper process and can't be copied. */
+  NativeExecutor(const NativeExecutor& rhs) = delete;
+  NativeExecutor& operator=(const NativeExecutor& rhs) = delete;
+  /** Stops the helper and releases all memory. */
+  ~NativeExecutor();
+
+  /** Returns true if an instruction can be executed without instrumentation.
+    Calls and rip-relative operands would observe the code's real location. */
+  static bool is_supported(const x64asm::Instruction& instr);
+
+  /** Sets the wall-clock limit for a single testcase, in microseconds; a
+    backstop only, since loop-free code always terminates. */
+  NativeExecutor& set_timeout(size_t usec) {
+    timeout_ = usec;
+    return *this;
+  }
+
+  /** Records a function, replacing any previous version with the same name. */
+  NativeExecutor& insert_function(const Cfg& cfg);
+  /** Removes all functions. */
+  NativeExecutor& clear_functions();
+  /** Designates the function that run() calls. */
+  NativeExecutor& set_entrypoint(const x64asm::Label& l) {
+    main_fxn_ = l;
+    dirty_ = true;
+    return *this;
+  }
+  /** Returns true if every function inserted so far can be run natively. */
+  bool good() const {
+    return unsupported_.empty();
+  }
+  /** Returns the number of jumps in the entrypoint; no run executes more. */
+  size_t get_jumps() const {
+    const auto itr = jumps_.find(main_fxn_);
+    return itr == jumps_.end() ? 0 : itr->second;
+  }
+
+  /** Runs the entrypoint on every testcase. Outputs must hold a copy of their
+    input on entry. done[i] is set if testcase i was run natively, in which case
+    its output state (including the error code) is up to date. */
+  void run(const std::vector<std::pair<const CpuState*, CpuState*>>& tcs, std::vector<bool>& done);
+
+  /** Returns the number of testcases run natively so far. */
+  size_t get_runs() const {
+    return runs_;
+  }
+  /** Returns the number of times a helper process was started. */
+  size_t get_helper_starts() const {
+    return helper_starts_;
+  }
+
+private:
+  /** Register state exchanged with the trampoline. */
+  struct Frame {
+    uint64_t gp[16];
+    uint8_t sse[16][32];
+    uint64_t rf;
+    uint64_t host_rsp;
+  };
+  /** A page-aligned range of addresses to map for a testcase. */
+  struct Range {
+    uint64_t begin;
+    uint64_t end;
+    /** Does a page in this range hold a valid byte? */
+    uint64_t writable;
+  };
+  /** A helper mapping that is write-protected while user code runs. */
+  struct Guard {
+    uint64_t begin;
+    uint64_t size;
+    /** Protection while user code runs. */
+    uint64_t guarded;
+    /** Protection otherwise. */
+    uint64_t prot;
+  };
+  /** The most mappings the helper can write-protect. */
+  static constexpr size_t max_guards = 1024;
+  /** State that stays writable in the helper while user code runs. Lives on
+    pages of its own, mapped before the helper is forked. */
+  struct Control {
+    Frame frame;
+    uint64_t num_guards;
+    Guard guards[max_guards];
+    /** Stack for the trampoline while the helper's own stack is guarded. */
+    uint8_t scratch[256];
+    /** Stack for signal handlers; the user's stack may be anywhere. */
+    uint8_t alt_stack[64 * 1024];
+  };
+  /** Where a testcase's mappings and record live. */
+  struct Plan {
+    /** Index into tcs. */
+    size_t index;
+    /** Ranges to map, in ranges_. */
+    size_t range_begin;
+    size_t range_end;
+    /** Offset of this testcase's record in the shared buffer. */
+    size_t offset;
+  };
+  /** Header of a request in the shared buffer. */
+  struct Header {
+    uint64_t count;
+    uint64_t timeout;
+  };
+  /** Header of a testcase's record in the shared buffer.  It's followed by its
+    ranges, its regions, and the contents and valid mask of every region. */
+  struct Record {
+    /** Set by the helper once the result is complete. */
+    uint64_t done;
+    uint64_t code;
+    uint64_t num_ranges;
+    uint64_t num_regions;
+    /** The input registers going in, the output registers coming out. */
+    Frame frame;
+  };
+  /** A memory region of a testcase. */
+  struct Region {
+    uint64_t begin;
+    uint64_t size;
+  };
+
+  /** Microseconds before a testcase is considered non-terminating. */
+  size_t timeout_;
+
+  /** Assembler, no sense in always creating these. */
+  x64asm::Assembler assm_;
+  /** The code of every function inserted so far. */
+  std::unordered_map<x64asm::Label, x64asm::Code> fxns_;
+  /** Functions that contain instructions that can't be run natively. */
+  std::unordered_map<x64asm::Label, bool> unsupported_;
+  /** The number of jumps in every function inserted so far. */
+  std::unordered_map<x64asm::Label, size_t> jumps_;
+  /** The function that the trampoline calls. */
+  x64asm::Label main_fxn_;
+  /** The trampoline followed by the main function; only relative jumps refer
+    to anything inside it, so it can be copied anywhere. */
+  x64asm::Function blob_;
+  /** Did blob_ assemble? */
+  bool assembled_;
+  /** Does blob_ need to be reassembled and published? */
+  bool dirty_;
+
+  /** Private state of the helper; see Control. */
+  Control* control_;
+  size_t control_size_;
+  /** The frame used by the trampoline, in control_. */
+  Frame* frame_;
+
+  /** Executable memory shared with the helper that holds a copy of blob_. */
+  uint8_t* code_;
+  size_t code_size_;
+  /** Memory shared with the helper that holds requests and results. */
+  uint8_t* shared_;
+  size_t shared_size_;
+
+  /** The helper process and our end of the socket to it, or -1. */
+  pid_t helper_;
+  int socket_;
+
+  /** Statistics. */
+  size_t runs_;
+  size_t helper_starts_;
+
+  /** Testcases in the current call to run(). */
+  std::vector<Plan> plans_;
+  /** Ranges for every testcase in plans_. */
+  std::vector<Range> ranges_;
+
+  /** Computes the ranges for a testcase; returns false if it can't be mapped. */
+  bool plan(CpuState& cs);
+  /** Ensures the shared buffer holds at least this many bytes. */
+  bool reserve(size_t size);
+  /** Assembles the trampoline and main function, and copies them where the helper runs them. */
+  bool publish();
+  /** Emits a loop that applies the guarded (or original) protection to every mapping in control_. */
+  void emit_guard(bool guard);
+  /** Starts the helper if it isn't running; returns false on failure. */
+  bool start_helper();
+  /** Stops the helper if it's running. */
+  void stop_helper();
+
+  /** Serves requests until the socket closes; only ever called in the helper. */
+  void run_helper();
+  /** Finds the writable mappings to guard; only ever called in the helper. */
+  bool find_guards();
+  /** Runs a single testcase; only ever called in the helper. */
+  void run_one(Record* rec, size_t timeout);
+};
+
+} // namespace stoke
+
+#endif
@@ -14,7 +14,9 @@
 
 #include "src/sandbox/sandbox.h"
 
+#include <algorithm>
 #include <cassert>
+#include <cstddef>
 #include <set>
 #include <setjmp.h>
 #include <signal.h>
@@ -102,12 +104,19 @@ bool Sandbox::is_supported(Opcode o) {
 }
 
 void Sandbox::init() {
+  native_ = nullptr;
+  snapshot_interval_ = 0;
+  num_snapshots_ = 0;
+  resume_offset_ = 0;
+  resume_ = 0;
   set_abi_check(true);
   set_stack_check(true);
   set_max_jumps(16);
 
   harness_ = emit_harness();
   signal_trap_ = emit_signal_trap();
+  run_loop_ = emit_run_loop();
+  set_stop_callback(nullptr, nullptr);
   reset();
 
   static bool once = false;
@@ -125,6 +134,22 @@ void Sandbox::init() {
   }
 }
 
+Sandbox& Sandbox::set_native(bool native) {
+  if (native && native_ == nullptr) {
+    native_ = new NativeExecutor();
+    for (const auto& fxn : fxns_src_) {
+      native_->insert_function(*fxn.second);
+    }
+    if (num_functions() > 0) {
+      native_->set_entrypoint(main_fxn_);
+    }
+  } else if (!native && native_ != nullptr) {
+    delete native_;
+    native_ = nullptr;
+  }
+  return *this;
+}
+
 Sandbox& Sandbox::insert_input(const CpuState& input) {
   io_pairs_.push_back(new IoPair());
   auto io = io_pairs_.back();
@@ -135,20 +160,33 @@ Sandbox& Sandbox::insert_input(const CpuState& input) {
   io->in_ = input;
   io->out_ = input;
 
-  // Assemble helper functions for this io pair.
-  io->in2cpu_ = emit_state2cpu(io->in_);
-  io->out2cpu_ = emit_state2cpu(io->out_);
-  io->cpu2out_ = emit_cpu2state(io->out_);
-  io->map_addr_ = emit_map_addr(io->out_);
+  // Assemble helper functions for this io pair. They only refer to other code by
+  // absolute address, so they can be packed next to each other in the arena.
+  io->in2cpu_ = arena_.insert(emit_state2cpu(io->in_));
+  io->out2cpu_ = arena_.insert(emit_state2cpu(io->out_));
+  io->cpu2out_ = arena_.insert(emit_cpu2state(io->out_));
+  io->map_addr_ = arena_.insert(emit_map_addr(io->out_));
+  io->resume_ = input;
+  io->resume2cpu_ = arena_.insert(emit_state2cpu(io->resume_));
+
+  // If the arena is out of memory, the input is never run and its output reports the failure
+  if (!io->runnable() && io->in_.code == ErrorCode::NORMAL) {
+    io->out_.code = ErrorCode::SIGCUSTOM_LINKER_ERROR;
+  }
+
+  // This input has no snapshots
+  clear_snapshots();
 
   return *this;
 }
 
 Sandbox& Sandbox::clear_inputs() {
+  clear_snapshots();
   for (auto io : io_pairs_) {
     delete io;
   }
   io_pairs_.clear();
+  arena_.clear();
   return *this;
 }
 
@@ -159,6 +197,10 @@ Sandbox& Sandbox::insert_function(const Cfg& cfg) {
 
   // If this is the first time we've seen this function, allocate state
   // Otherwise just replace what's there
+  // The resume point is compiled into the function, so pick it first
+  if (!snapshot_code_.empty() && label == snapshot_fxn_) {
+    find_resume_point(cfg);
+  }
   if (!contains_function(label)) {
     fxns_[label] = new x64asm::Function(512 * cfg.get_code().size() + 8192);
     fxns_src_[label] = new Cfg(cfg);
@@ -167,6 +209,9 @@ Sandbox& Sandbox::insert_function(const Cfg& cfg) {
     *fxns_src_[label] = cfg;
     recompile(cfg);
   }
+  if (native_ != nullptr) {
+    native_->insert_function(cfg);
+  }
 
   // If this is the only function it becomes main by default
   if (num_functions() == 1) {
@@ -176,6 +221,7 @@ Sandbox& Sandbox::insert_function(const Cfg& cfg) {
 }
 
 Sandbox& Sandbox::clear_functions() {
+  clear_snapshots();
   for (auto fxn : fxns_) {
     delete fxn.second;
   }
@@ -186,6 +232,10 @@ Sandbox& Sandbox::clear_functions() {
   }
   fxns_src_.clear();
 
+  if (native_ != nullptr) {
+    native_->clear_functions();
+  }
+
   return *this;
 }
 
@@ -224,6 +274,14 @@ Sandbox& Sandbox::clear_callbacks() {
   return *this;
 }
 
+Sandbox& Sandbox::clear_callbacks(const Label& l) {
+  assert(contains_function(l));
+  before_.erase(l);
+  after_.erase(l);
+  recompile(*get_function(l));
+  return *this;
+}
+
 Sandbox& Sandbox::run(size_t index) {
 
   assert(num_functions() > 0);
@@ -231,58 +289,323 @@ Sandbox& Sandbox::run(size_t index) {
   auto io = io_pairs_[index];
 
   // Don't bother executing testcases that are in error states
-  if (io->in_.code != ErrorCode::NORMAL) {
+  if (!io->runnable()) {
     return *this;
   }
 
-  io->out_.stack.copy(io->in_.stack);
-  io->out_.heap.copy(io->in_.heap);
-  io->out_.data.copy(io->in_.data);
-  io->out_.segments.resize(io->in_.segments.size());
-  for (size_t i = 0, ie=io->out_.segments.size(); i < ie; ++i) {
-    io->out_.segments[i].copy(io->in_.segments[i]);
+  // Resume from a snapshot if possible, run natively if possible, and in the sandbox otherwise
+  const auto resume = use_snapshot();
+  auto done = false;
+  if (resume) {
+    reset_to_snapshot(*io);
+  } else {
+    reset_output(*io);
+    if (use_native()) {
+      native_tcs_.assign(1, {&io->in_, &io->out_});
+      native_->run(native_tcs_, native_done_);
+      done = native_done_[0];
+    }
+  }
+  if (!done) {
+    run_sandboxed(*io, resume);
+  }
+
+  // Finalize output state
+  if (abi_check_ && !check_abi(*io)) {
+    io->out_.code = ErrorCode::SIGCUSTOM_ABI_VIOLATION;
   }
 
+  return *this;
+}
+
+void Sandbox::run_sandboxed(IoPair& iop, bool resume) {
   // Reset error-related variables
   jumps_remaining_ = max_jumps_;
 
   // Initialize input-specific state that the instrumented function relies on
   // State that doesn't vary on a per-input basis (ie: entrypoint_) is set elsewhere
-  out_ = &io->out_;
-  in2cpu_ = io->in2cpu_.get_entrypoint();
-  out2cpu_ = io->out2cpu_.get_entrypoint();
-  cpu2out_ = io->cpu2out_.get_entrypoint();
-  map_addr_ = io->map_addr_.get_entrypoint();
+  out_ = &iop.out_;
+  in2cpu_ = resume ? iop.resume2cpu_ : iop.in2cpu_;
+  out2cpu_ = iop.out2cpu_;
+  cpu2out_ = iop.cpu2out_;
+  map_addr_ = iop.map_addr_;
 
   // Initialize state related to %rsp tracking
-  user_rsp_ = io->in_.gp[rsp].get_fixed_quad(0);
+  user_rsp_ = (resume ? iop.resume_ : iop.in_).gp[rsp].get_fixed_quad(0);
   harness_rsp_ = 0;
   stoke_rsp_ = 0;
 
+  const auto entrypoint = entrypoint_;
+  if (resume) {
+    entrypoint_ = (uint8_t*)fxns_[main_fxn_]->get_entrypoint() + resume_offset_;
+  }
+
   // Run the code (control exits abnormally for sigfpe or if linking failed)
   if (!lnkr_.good()) {
-    io->out_.code = ErrorCode::SIGCUSTOM_LINKER_ERROR;
+    iop.out_.code = ErrorCode::SIGCUSTOM_LINKER_ERROR;
   } else if (!sigsetjmp(buf_, 1)) {
-    io->out_.code = harness_.call<ErrorCode>();
+    iop.out_.code = harness_.call<ErrorCode>();
   } else {
-    io->out_.code = ErrorCode::SIGFPE_;
+    iop.out_.code = ErrorCode::SIGFPE_;
   }
 
-  // Finalize output state
-  if (abi_check_ && !check_abi(*io)) {
-    io->out_.code = ErrorCode::SIGCUSTOM_ABI_VIOLATION;
+  entrypoint_ = entrypoint;
+}
+
+Sandbox& Sandbox::run() {
+
+  assert(num_functions() > 0);
+
+  const auto resume = use_snapshot();
+  if (!resume && use_native()) {
+    run_native();
+    return *this;
+  }
+
+  // Describe every input that's worth running; memory is reset up front so
+  // that the loop only has to swap pointers between inputs
+  run_table_.clear();
+  for (size_t i = 0, ie = size(); i < ie; ++i) {
+    auto io = io_pairs_[i];
+    if (!io->runnable()) {
+      continue;
+    }
+    if (resume) {
+      reset_to_snapshot(*io);
+      run_table_.push_back({i, &io->out_, io->resume2cpu_, io->out2cpu_, io->cpu2out_, io->map_addr_,
+                            io->resume_.gp[rsp].get_fixed_quad(0), &io->out_.code
+                           });
+    } else {
+      reset_output(*io);
+      run_table_.push_back({i, &io->out_, io->in2cpu_, io->out2cpu_, io->cpu2out_, io->map_addr_,
+                            io->in_.gp[rsp].get_fixed_quad(0), &io->out_.code
+                           });
+    }
+  }
+  run_next_ = run_table_.data();
+  run_end_ = run_next_ + run_table_.size();
+
+  if (!lnkr_.good()) {
+    for (; run_next_ != run_end_; ++run_next_) {
+      *run_next_->code = ErrorCode::SIGCUSTOM_LINKER_ERROR;
+    }
+    return *this;
+  }
+
+  // Every input resumes from the same point in the main function
+  const auto entrypoint = entrypoint_;
+  if (resume) {
+    entrypoint_ = (uint8_t*)fxns_[main_fxn_]->get_entrypoint() + resume_offset_;
+  }
+
+  // Control only comes back here before the end if an input raises sigfpe;
+  // record the error and pick up where the loop left off
+  while (run_next_ < run_end_) {
+    if (!sigsetjmp(buf_, 1)) {
+      run_loop_.call<void>();
+    } else {
+      *(run_next_++)->code = ErrorCode::SIGFPE_;
+      if (stop_cb_.first != nullptr) {
+        finish_run(this, run_next_ - 1);
+      }
+    }
+  }
+
+  entrypoint_ = entrypoint;
+
+  // Finalize output states (the stop callback has already seen to this)
+  if (stop_cb_.first == nullptr && abi_check_) {
+    for (auto rd = run_table_.data(); rd != run_next_; ++rd) {
+      auto io = io_pairs_[rd->index];
+      if (!check_abi(*io)) {
+        io->out_.code = ErrorCode::SIGCUSTOM_ABI_VIOLATION;
+      }
+    }
   }
 
   return *this;
 }
 
-Sandbox& Sandbox::run() {
+void Sandbox::run_native() {
+  // Everything runs in a single helper process, so the stop callback can only
+  // decide which outputs get finalized, not which inputs run
+  native_index_.clear();
+  native_tcs_.clear();
   for (size_t i = 0, ie = size(); i < ie; ++i) {
-    run(i);
+    auto io = io_pairs_[i];
+    if (!io->runnable()) {
+      continue;
+    }
+    reset_output(*io);
+    native_index_.push_back(i);
+    native_tcs_.push_back({&io->in_, &io->out_});
+  }
+  native_->run(native_tcs_, native_done_);
+
+  for (size_t i = 0, ie = native_index_.size(); i < ie; ++i) {
+    auto io = io_pairs_[native_index_[i]];
+    if (!native_done_[i]) {
+      run_sandboxed(*io);
+    }
+    if (abi_check_ && !check_abi(*io)) {
+      io->out_.code = ErrorCode::SIGCUSTOM_ABI_VIOLATION;
+    }
+    if (stop_cb_.first != nullptr && stop_cb_.first(native_index_[i], stop_cb_.second)) {
+      break;
+    }
+  }
+}
+
+void Sandbox::finish_run(Sandbox* sb, const RunDescriptor* rd) {
+  auto io = sb->io_pairs_[rd->index];
+  if (sb->abi_check_ && !sb->check_abi(*io)) {
+    io->out_.code = ErrorCode::SIGCUSTOM_ABI_VIOLATION;
+  }
+  if (sb->stop_cb_.first(rd->index, sb->stop_cb_.second)) {
+    sb->run_end_ = sb->run_next_;
+  }
+}
+
+void Sandbox::reset_output(IoPair& iop) {
+  reset_memory(iop.out_, iop.in_);
+}
+
+void Sandbox::reset_memory(CpuState& out, const CpuState& from) const {
+  // Instrumented code can only write valid bytes, so those are all that need
+  // resetting; native runs can change the others before they're caught
+  const auto reset = [this](Memory& m, const Memory& rhs) {
+    if (native_ == nullptr) {
+      m.copy_valid(rhs);
+    } else {
+      m.copy(rhs);
+    }
+  };
+
+  reset(out.stack, from.stack);
+  reset(out.heap, from.heap);
+  reset(out.data, from.data);
+  out.segments.resize(from.segments.size());
+  for (size_t i = 0, ie = out.segments.size(); i < ie; ++i) {
+    reset(out.segments[i], from.segments[i]);
+  }
+}
+
+void Sandbox::reset_to_snapshot(IoPair& iop) {
+  const auto& snapshot = iop.snapshots_[resume_-1];
+  reset_memory(iop.out_, snapshot);
+
+  // Copy in place; resume2cpu_ reads from these addresses
+  for (size_t i = 0, ie = snapshot.gp.size(); i < ie; ++i) {
+    iop.resume_.gp[i].copy(snapshot.gp[i]);
+  }
+  for (size_t i = 0, ie = snapshot.sse.size(); i < ie; ++i) {
+    iop.resume_.sse[i].copy(snapshot.sse[i]);
+  }
+  for (size_t i = 0, ie = snapshot.rf.size(); i < ie; ++i) {
+    iop.resume_.rf.set(i, snapshot.rf.is_set(i));
+  }
+}
+
+Sandbox& Sandbox::take_snapshots(const Cfg& cfg) {
+  clear_snapshots();
+  if (snapshot_interval_ == 0 || native_ != nullptr || !is_straight_line(cfg) ||
+      global_before_.first != nullptr || !before_.empty() ||
+      global_after_.first != nullptr || !after_.empty()) {
+    return *this;
+  }
+
+  snapshot_fxn_ = cfg.get_function().get_leading_label();
+  snapshot_code_ = cfg.get_code();
+
+  // A snapshot is the state after the instruction before a resume point. The
+  // callbacks go in directly so that the function is compiled once with them
+  snapshot_args_.clear();
+  for (size_t i = snapshot_interval_, ie = cfg.get_code().size(); i < ie; i += snapshot_interval_) {
+    snapshot_args_.push_back({this, snapshot_args_.size()});
+  }
+  for (auto io : io_pairs_) {
+    io->snapshots_.clear();
+  }
+  for (size_t i = 0, ie = snapshot_args_.size(); i < ie; ++i) {
+    after_[snapshot_fxn_][(i+1) * snapshot_interval_ - 1] = {snapshot_callback, &snapshot_args_[i]};
+  }
+  insert_function(cfg);
+  set_entrypoint(snapshot_fxn_);
+
+  const auto stop_cb = stop_cb_;
+  stop_cb_ = {nullptr, nullptr};
+  run();
+  stop_cb_ = stop_cb;
+
+  // Inputs that signal part way through have fewer snapshots
+  num_snapshots_ = snapshot_args_.size();
+  for (auto io : io_pairs_) {
+    if (io->runnable()) {
+      num_snapshots_ = std::min(num_snapshots_, io->snapshots_.size());
+    }
+  }
+
+  // Removing the callbacks recompiles the function with its resume point
+  find_resume_point(cfg);
+  clear_callbacks(snapshot_fxn_);
+
+  return *this;
+}
+
+Sandbox& Sandbox::clear_snapshots() {
+  snapshot_code_.clear();
+  num_snapshots_ = 0;
+  resume_offset_ = 0;
+  resume_ = 0;
+  for (auto io : io_pairs_) {
+    io->snapshots_.clear();
   }
   return *this;
 }
 
+void Sandbox::find_resume_point(const Cfg& cfg) {
+  resume_ = 0;
+  if (num_snapshots_ == 0 || !is_straight_line(cfg)) {
+    return;
+  }
+
+  // The state before an instruction only depends on the ones before it
+  const auto& code = cfg.get_code();
+  size_t same = 0;
+  for (size_t ie = std::min(code.size(), snapshot_code_.size()); same < ie && code[same] == snapshot_code_[same]; ++same);
+
+  for (size_t i = 1; i <= num_snapshots_; ++i) {
+    if (i * snapshot_interval_ > same || i * snapshot_interval_ >= code.size()) {
+      break;
+    }
+    resume_ = i;
+  }
+}
+
+bool Sandbox::is_straight_line(const Cfg& cfg) {
+  const auto& code = cfg.get_code();
+  if (code.size() < 2 || !code[code.size()-1].is_any_return()) {
+    return false;
+  }
+  for (size_t i = 1, ie = code.size() - 1; i < ie; ++i) {
+    const auto& instr = code[i];
+    if (instr.is_label_defn() || instr.is_any_jump() || instr.is_any_call() ||
+        instr.is_any_return() || instr.is_any_loop()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void Sandbox::snapshot_callback(const StateCallbackData& data, void* arg) {
+  const auto sa = (SnapshotArg*)arg;
+  auto io = sa->sb->io_pairs_[sa->sb->run_next_->index];
+  if (io->snapshots_.size() == sa->index) {
+    io->snapshots_.push_back(data.state);
+    io->snapshots_.back().code = ErrorCode::NORMAL;
+  }
+}
+
 bool Sandbox::check_abi(const IoPair& iop) const {
   for (const auto& r : {
   rbx, rbp, rsp, r12, r13, r14, r15
@@ -407,6 +730,98 @@ Function Sandbox::emit_harness() {
   return fxn;
 }
 
+// Runs the harness once for every input in the run table.
+//
+// Calling Context:
+//   - run()
+// Assumptions:
+//   - This function is called in an x86 abi-consistent state
+//   - The class variables run_next_ and run_end_ delimit the inputs left to run
+// Requirements:
+//   - MUST leave callee-save registers unmodified
+//   - MUST advance run_next_ past an input as soon as its error code is recorded
+// Arguments:
+//   - <none>
+
+Function Sandbox::emit_run_loop() {
+  Function fxn;
+  assm_.start(fxn);
+  set_label_pool(x64asm::Label("GLOBAL_LABEL_POOL"));
+
+  const auto loop = get_label();
+  const auto done = get_label();
+
+  // The harness preserves these for us, even when it exits through the signal trap
+  assm_.push_1(rbx);
+  assm_.push_1(rbp);
+  assm_.push_1(r12);
+  assm_.push_1(r13);
+  assm_.push_1(r14);
+  assm_.push_1(r15);
+  // Keep the stack 16-byte aligned for calls out of here
+  assm_.push_1(rax);
+
+  // %rbx holds the current descriptor
+  assm_.bind(loop);
+  assm_.mov(rax, Moffs64(&run_next_));
+  assm_.mov(rbx, rax);
+  assm_.mov(rax, Moffs64(&run_end_));
+  assm_.cmp(rbx, rax);
+  assm_.jae_1(done);
+
+  // Load the class variables that the harness and instrumented code rely on
+  const vector<pair<size_t, void*>> fields {
+    {offsetof(RunDescriptor, out), &out_},
+    {offsetof(RunDescriptor, in2cpu), &in2cpu_},
+    {offsetof(RunDescriptor, out2cpu), &out2cpu_},
+    {offsetof(RunDescriptor, cpu2out), &cpu2out_},
+    {offsetof(RunDescriptor, map_addr), &map_addr_},
+    {offsetof(RunDescriptor, user_rsp), &user_rsp_}
+  };
+  for (const auto& f : fields) {
+    assm_.mov(rax, M64(rbx, Imm32(f.first)));
+    assm_.mov(Moffs64(f.second), rax);
+  }
+  assm_.mov(rax, Moffs64(&max_jumps_));
+  assm_.mov(Moffs64(&jumps_remaining_), rax);
+
+  // Run the input and record its error code
+  assm_.mov((R64)rax, Imm64(harness_.get_entrypoint()));
+  assm_.call(rax);
+  assm_.mov(rdx, M64(rbx, Imm32(offsetof(RunDescriptor, code))));
+  assm_.mov(M32(rdx), eax);
+
+  // Move on before anyone gets to look at this input
+  assm_.mov(rsi, rbx);
+  assm_.lea(rbx, M64(rbx, Imm32(sizeof(RunDescriptor))));
+  assm_.mov(rax, rbx);
+  assm_.mov(Moffs64(&run_next_), rax);
+
+  // Hand it to the stop callback, if there is one; %rsi = descriptor
+  assm_.mov(rax, Moffs64(&stop_cb_.first));
+  assm_.test(rax, rax);
+  assm_.je_1(loop);
+  assm_.mov(rdi, Imm64(this));
+  assm_.mov((R64)rax, Imm64(&finish_run));
+  assm_.call(rax);
+  assm_.jmp_1(loop);
+
+  // Restore callee-save state
+  assm_.bind(done);
+  assm_.pop_1(rax);
+  assm_.pop_1(r15);
+  assm_.pop_1(r14);
+  assm_.pop_1(r13);
+  assm_.pop_1(r12);
+  assm_.pop_1(rbp);
+  assm_.pop_1(rbx);
+  assm_.ret();
+
+  bool ok = assm_.finish();
+  assert(ok);
+  return fxn;
+}
+
 // Emits a function that sets the value of the error code and jumps control
 // back into stoke code
 //
@@ -724,6 +1139,9 @@ bool Sandbox::emit_function(const Cfg& cfg, Function* fxn) {
   // Make a unique label for representing the end
   const auto exit = get_label();
 
+  // Runs that resume from a snapshot jump into the middle of the function
+  const auto resume_point = label == snapshot_fxn_ && resume_ > 0 ? resume_ * snapshot_interval_ : 0;
+
   // Assemble instructions and add instrumentation for reachable blocks
   for (Cfg::id_type b = 0, be = cfg.num_blocks(); b < be; ++b) {
     if (!cfg.is_reachable(b)) {
@@ -740,6 +1158,16 @@ bool Sandbox::emit_function(const Cfg& cfg, Function* fxn) {
       const auto& instr = f.get_code()[i];
       const auto hex_offset = f.get_rip_offset() + f.hex_offset(i) + f.hex_size(i);
 
+      // A resume point loads the user's %rsp, just like the entrypoint; runs
+      // from the start jump over it
+      if (resume_point > 0 && i == resume_point) {
+        const auto skip = get_label();
+        assm_.jmp_1(skip);
+        resume_offset_ = fxn->size();
+        emit_load_user_rsp();
+        assm_.bind(skip);
+      }
+
       // Emit callbacks and instruction
       if (global_before_.first != nullptr || !before_.empty()) {
         emit_before(cfg.get_function().get_leading_label(), i);
@@ -21,11 +21,14 @@
 #include "src/ext/x64asm/include/x64asm.h"
 
 #include "src/cfg/cfg.h"
+#include "src/sandbox/exec_arena.h"
 #include "src/sandbox/io_pair.h"
+#include "src/sandbox/native_executor.h"
 #include "src/sandbox/function_iterator.h"
 #include "src/sandbox/input_iterator.h"
 #include "src/sandbox/output_iterator.h"
 #include "src/sandbox/state_callback.h"
+#include "src/sandbox/stop_callback.h"
 #include "src/state/cpu_state.h"
 
 namespace stoke {
@@ -51,6 +54,9 @@ public:
     set_abi_check(sb.abi_check_);
     set_stack_check(sb.stack_check_);
     set_max_jumps(sb.max_jumps_);
+    set_huge_pages(sb.arena_.get_huge_pages());
+    set_native(sb.native_ != nullptr);
+    set_snapshot_interval(sb.snapshot_interval_);
 
     // Inputs
     for (size_t i = 0; i < sb.size(); ++i) {
@@ -72,6 +78,7 @@ public:
   /** Deletes a sandbox. */
   ~Sandbox() {
     reset();
+    set_native(false);
   }
 
   /** Sets whether the sandbox should report sigsegv for abi violations. */
@@ -89,6 +96,59 @@ public:
     max_jumps_ = jumps;
     return *this;
   }
+  /** Returns the settings that affect the outputs of a run. */
+  bool get_abi_check() const {
+    return abi_check_;
+  }
+  bool get_stack_check() const {
+    return stack_check_;
+  }
+  size_t get_max_jumps() const {
+    return max_jumps_;
+  }
+
+  /** Sets whether per-input code should be backed by huge pages; affects inputs added later. */
+  Sandbox& set_huge_pages(bool huge) {
+    arena_.set_huge_pages(huge);
+    return *this;
+  }
+  /** Sets whether inputs should run natively in a helper process where possible.
+    Inputs whose memory can't be mapped at its original addresses, functions with
+    unsupported instructions or loops, functions with too many jumps to stay
+    under the jump limit, and runs with callbacks installed fall back to the
+    instrumented sandbox. */
+  Sandbox& set_native(bool native);
+  /** Returns the executor used for native runs, or nullptr if native runs are disabled. */
+  const NativeExecutor* get_native() const {
+    return native_;
+  }
+
+  /** Sets how many instructions apart to snapshot the state of each input in
+    take_snapshots(); zero disables snapshots. */
+  Sandbox& set_snapshot_interval(size_t n) {
+    snapshot_interval_ = n;
+    clear_snapshots();
+    return *this;
+  }
+  /** Runs a straight-line function on every input, recording each input's state
+    before every snapshot_interval'th instruction.  Until the snapshots are
+    cleared, runs of a version of this function that starts with the same
+    instructions resume from the last snapshot before the first difference
+    rather than from the start.  Does nothing for functions with control flow,
+    while callbacks are installed, or when running natively. */
+  Sandbox& take_snapshots(const Cfg& cfg);
+  /** Discards the snapshots; every run starts from the beginning. Inserting an
+    input or clearing the functions also does this. */
+  Sandbox& clear_snapshots();
+  /** Returns the snapshot that the next run resumes from, or zero if it runs from the start. */
+  size_t get_resume_point() const {
+    return resume_;
+  }
+  /** Returns how many snapshots every input has; a version of the snapshot
+    function that can't resume from the last one has changed before it. */
+  size_t get_num_snapshots() const {
+    return num_snapshots_;
+  }
 
   /** Resets the sandbox to a consistent state. Clears all inputs, functions and callbacks. */
   Sandbox& reset() {
@@ -172,17 +232,30 @@ public:
   Sandbox& insert_after(const x64asm::Label& l, size_t line, StateCallback cb, void* arg);
   /** Clears the set of callbacks to invoke during execution. */
   Sandbox& clear_callbacks();
+  /** Clears the per-line callbacks for this function; global callbacks are untouched. */
+  Sandbox& clear_callbacks(const x64asm::Label& l);
+  /** Set a callback to invoke after each input when running all inputs; nullptr for none.
+    Inputs after the one where the callback returns true are not run, and their output
+    states are left stale. */
+  Sandbox& set_stop_callback(StopCallback cb, void* arg) {
+    stop_cb_ = {cb, arg};
+    return *this;
+  }
 
   /** Designates a function as the entrypoint. */
   Sandbox& set_entrypoint(const x64asm::Label& l) {
     assert(contains_function(l));
     main_fxn_ = l;
     entrypoint_ = fxns_[main_fxn_]->get_entrypoint();
+    if (native_ != nullptr) {
+      native_->set_entrypoint(l);
+    }
     return *this;
   }
   /** Run a main function for just one input. */
   Sandbox& run(size_t index);
-  /** Run a main function for all inputs. */
+  /** Run a main function for all inputs. Control stays in generated code from the
+    first input to the last unless an input raises sigfpe. */
   Sandbox& run();
 
   /** @deprecated */
@@ -257,6 +330,57 @@ private:
 
   /** I/O pairs. These are pointers to simplify vector reallocations. */
   std::vector<IoPair*> io_pairs_;
+  /** Holds the helper functions for every io pair, packed together in input order. */
+  ExecArena arena_;
+
+  /** Everything the run loop needs to know about an input, in one place. */
+  struct RunDescriptor {
+    /** Index of the io pair. */
+    size_t index;
+    /** Per-input values for the class variables of the same names. */
+    void* out;
+    void* in2cpu;
+    void* out2cpu;
+    void* cpu2out;
+    void* map_addr;
+    uint64_t user_rsp;
+    /** Where to record the error code. */
+    ErrorCode* code;
+  };
+  /** Runs uninstrumented code in a helper process; nullptr unless set_native(true). */
+  NativeExecutor* native_;
+  /** Indices, states and results of the inputs handed to native_. */
+  std::vector<size_t> native_index_;
+  std::vector<std::pair<const CpuState*, CpuState*>> native_tcs_;
+  std::vector<bool> native_done_;
+
+  /** Descriptors for the inputs in the current call to run(). */
+  std::vector<RunDescriptor> run_table_;
+  /** The next input for the run loop. */
+  RunDescriptor* run_next_;
+  /** One past the last input for the run loop. */
+  RunDescriptor* run_end_;
+  /** Callback to invoke after each input in the run loop. */
+  std::pair<StopCallback, void*> stop_cb_;
+
+  /** How many instructions apart snapshots are taken; zero for never. */
+  size_t snapshot_interval_;
+  /** The function the snapshots were taken of, and its code at the time. */
+  x64asm::Label snapshot_fxn_;
+  x64asm::Code snapshot_code_;
+  /** How many snapshots every input has. */
+  size_t num_snapshots_;
+  /** Offset into the snapshot function's code where runs resume; only the
+    resume point in use is compiled in, so runs from the start don't jump over any. */
+  size_t resume_offset_;
+  /** The snapshot that the next run resumes from (counting from one), or zero. */
+  size_t resume_;
+  /** Callback arguments for taking snapshots. */
+  struct SnapshotArg {
+    Sandbox* sb;
+    size_t index;
+  };
+  std::vector<SnapshotArg> snapshot_args_;
 
   /** Global callback to invoke before any line is executed. */
   std::pair<StateCallback, void*> global_before_;
@@ -307,6 +431,8 @@ private:
   x64asm::Function harness_;
   /** Pointer to the signal trap function */
   x64asm::Function signal_trap_;
+  /** Pointer to the function that runs the harness for every input */
+  x64asm::Function run_loop_;
   /** Functions that the code may invoke at runtime. Pointers to simplify reallocation. */
   std::unordered_map<x64asm::Label, x64asm::Function*> fxns_;
   /** Pointer to the current main function */
@@ -320,6 +446,38 @@ private:
 
   /** Check for abi violations between input and output states */
   bool check_abi(const IoPair& iop) const;
+  /** Can the current functions run natively? */
+  bool use_native() const {
+    // The sandbox traps on the max_jumps'th jump; loop-free code that can't
+    // reach it behaves the same natively
+    return native_ != nullptr && native_->good() && native_->get_jumps() < max_jumps_ &&
+           global_before_.first == nullptr && before_.empty() &&
+           global_after_.first == nullptr && after_.empty();
+  }
+  /** Runs every input natively, falling back to the sandbox where necessary. */
+  void run_native();
+  /** Runs an input in the sandbox, from the start or from its snapshot; leaves abi checks to the caller. */
+  void run_sandboxed(IoPair& iop, bool resume = false);
+  /** Resets an output state's memory to that of its input. */
+  void reset_output(IoPair& iop);
+  /** Resets a state's memory to that of another. */
+  void reset_memory(CpuState& out, const CpuState& from) const;
+  /** Resets an output state's memory, and the state the run starts from, to a snapshot. */
+  void reset_to_snapshot(IoPair& iop);
+  /** Should the next run resume from a snapshot? */
+  bool use_snapshot() const {
+    return resume_ > 0 && main_fxn_ == snapshot_fxn_ &&
+           global_before_.first == nullptr && before_.empty() &&
+           global_after_.first == nullptr && after_.empty();
+  }
+  /** Picks the snapshot that runs of a new version of the snapshot function resume from. */
+  void find_resume_point(const Cfg& cfg);
+  /** Returns true if a function runs from its first instruction to its last without branching. */
+  static bool is_straight_line(const Cfg& cfg);
+  /** Records an input's state at a snapshot point. */
+  static void snapshot_callback(const StateCallbackData& data, void* arg);
+  /** Finalizes an input in the run loop and passes it to the stop callback. */
+  static void finish_run(Sandbox* sb, const RunDescriptor* rd);
 
   /** Returns true if this instruction uses rh */
   bool uses_rh(const x64asm::Instruction& instr) const {
@@ -378,6 +536,8 @@ private:
   x64asm::Function emit_harness();
   /** Assembles a signal handler trap */
   x64asm::Function emit_signal_trap();
+  /** Assembles a loop that invokes the harness for every input in the run table */
+  x64asm::Function emit_run_loop();
   /** Assembles a function for writing user state (modulo rsp) to the cpu */
   x64asm::Function emit_state2cpu(const CpuState& cs);
   /** Assembles a function for reading user state from the cpu */
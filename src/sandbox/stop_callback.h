@@ -0,0 +1,28 @@
+// Copyright 2013-2016 Stanford University
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef STOKE_SRC_SANDBOX_STOP_CALLBACK_H
+#define STOKE_SRC_SANDBOX_STOP_CALLBACK_H
+
+#include <stddef.h>
+
+namespace stoke {
+
+/** Callback signature; invoked with the index of each input as soon as it has
+  finished running. Returning true stops the sandbox before any further inputs. */
+typedef bool (*StopCallback)(size_t index, void* arg);
+
+} // namespace stoke
+
+#endif
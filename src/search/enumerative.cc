@@ -0,0 +1,351 @@
+// Copyright 2013-2016 Stanford University
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <sstream>
+#include <string>
+
+#include "src/search/enumerative.h"
+
+using namespace std;
+using namespace std::chrono;
+using namespace x64asm;
+
+namespace {
+
+/** 64-bit FNV-1a, a word at a time. */
+void mix(uint64_t& h, uint64_t x) {
+  for (size_t i = 0; i < 8; ++i, x >>= 8) {
+    h = (h ^ (x & 0xff)) * 0x100000001b3ull;
+  }
+}
+
+const uint64_t fnv_basis = 0xcbf29ce484222325ull;
+
+/** Writes all of a string to a file descriptor. */
+void write_all(int fd, const string& s) {
+  for (size_t done = 0; done < s.length();) {
+    const auto n = write(fd, s.data() + done, s.length() - done);
+    if (n <= 0) {
+      return;
+    }
+    done += n;
+  }
+}
+
+/** Reads a file descriptor until end of file. */
+string read_all(int fd) {
+  string s;
+  char buf[4096];
+  ssize_t n;
+  while ((n = read(fd, buf, sizeof(buf))) > 0) {
+    s.append(buf, n);
+  }
+  return s;
+}
+
+} // namespace
+
+namespace stoke {
+
+void EnumerativeSearch::run(const Cfg& target, CostFunction& fxn, Sandbox& sb, SearchState& state) {
+  const auto start = steady_clock::now();
+  const auto deadline = timeout_sec_ == duration<double>::zero() ?
+                        steady_clock::time_point::max() :
+                        start + duration_cast<steady_clock::duration>(timeout_sec_);
+  iterations_ = 0;
+
+  Cfg best = target;
+  bool found = false;
+
+  if (jobs_ == 1) {
+    found = enumerate(target, fxn, sb, 0, 1, deadline, best);
+  } else {
+    // Each child reports how many programs it ran, followed by its match (if any)
+    vector<pid_t> pids;
+    vector<int> fds;
+    for (size_t i = 0; i < jobs_; ++i) {
+      int fd[2];
+      if (pipe(fd) != 0) {
+        break;
+      }
+      const auto pid = fork();
+      if (pid == 0) {
+        close(fd[0]);
+        Cfg match = target;
+        const auto ok = enumerate(target, fxn, sb, i, jobs_, deadline, match);
+        ostringstream oss;
+        oss << iterations_ << " " << ok << endl;
+        if (ok) {
+          oss << match.get_function();
+        }
+        write_all(fd[1], oss.str());
+        close(fd[1]);
+        _exit(0);
+      }
+      close(fd[1]);
+      if (pid < 0) {
+        close(fd[0]);
+        break;
+      }
+      pids.push_back(pid);
+      fds.push_back(fd[0]);
+    }
+
+    Cost best_cost = 0;
+    for (size_t i = 0; i < fds.size(); ++i) {
+      istringstream iss(read_all(fds[i]));
+      close(fds[i]);
+      waitpid(pids[i], nullptr, 0);
+
+      size_t its = 0;
+      bool ok = false;
+      iss >> its >> ok;
+      iterations_ += its;
+      if (!ok) {
+        continue;
+      }
+
+      TUnit fxn_text;
+      iss >> fxn_text;
+      if (iss.fail()) {
+        continue;
+      }
+      Cfg match(fxn_text, target.def_ins(), target.live_outs());
+      const auto res = fxn(match);
+      if (!res.first) {
+        continue;
+      }
+      // Shorter programs first, then cheaper ones
+      if (!found || match.get_code().size() < best.get_code().size() ||
+          (match.get_code().size() == best.get_code().size() && res.second < best_cost)) {
+        best = match;
+        best_cost = res.second;
+        found = true;
+      }
+    }
+  }
+
+  if (found) {
+    const auto cost = fxn(best).second;
+    state.current = best;
+    state.current_cost = cost;
+    state.best_yet = best;
+    state.best_yet_cost = cost;
+    state.best_correct = best;
+    state.best_correct_cost = cost;
+    state.success = true;
+  }
+
+  elapsed_ = duration_cast<duration<double>>(steady_clock::now() - start);
+}
+
+bool EnumerativeSearch::enumerate(const Cfg& target, CostFunction& fxn, Sandbox& sb, size_t shard, size_t shards,
+                                  steady_clock::time_point deadline, Cfg& best) {
+
+  // What a correct program must produce
+  sb.run(target);
+  const auto goal = live_out_fingerprint(sb, target.live_outs());
+
+  // Start from the empty program
+  vector<Program> level(1);
+  level[0].defs = target.def_ins();
+  level[0].cost = 0;
+  unordered_set<uint64_t> seen;
+  {
+    uint64_t h = 0;
+    sb.run(make_cfg(target, level[0].code));
+    fingerprint(sb, h);
+    seen.insert(h);
+  }
+
+  bool found = false;
+  Cost best_cost = 0;
+  vector<Instruction> instrs;
+
+  for (size_t length = 1; length <= max_length_ && !found && !level.empty(); ++length) {
+    vector<Program> next;
+
+    for (const auto& p : level) {
+      instrs.clear();
+      extensions(p, instrs);
+
+      for (size_t k = 0; k < instrs.size(); ++k) {
+        if (length == 1 && k % shards != shard) {
+          continue;
+        }
+        if ((timeout_itr_ > 0 && iterations_ >= timeout_itr_) || steady_clock::now() > deadline) {
+          return found;
+        }
+
+        Program q = p;
+        q.code.push_back(instrs[k]);
+        q.defs |= instrs[k].must_write_set();
+
+        const auto cfg = make_cfg(target, q.code);
+        if (!cfg.invariant_no_undef_reads()) {
+          continue;
+        }
+
+        iterations_++;
+        sb.run(cfg);
+
+        uint64_t h = 0;
+        if (!fingerprint(sb, h)) {
+          continue;
+        }
+        const auto matches = cfg.invariant_no_undef_live_outs() &&
+                             live_out_fingerprint(sb, target.live_outs()) == goal;
+        const auto is_new = seen.insert(h).second;
+        if (!matches && !is_new) {
+          continue;
+        }
+
+        // The cost ranks matches and decides which programs get extended
+        const auto res = fxn(cfg);
+        if (matches && res.first && (!found || res.second < best_cost)) {
+          best = cfg;
+          best_cost = res.second;
+          found = true;
+        }
+        if (is_new) {
+          q.cost = res.second;
+          next.push_back(q);
+          if (next.size() >= 2 * max_programs_) {
+            keep_cheapest(next, max_programs_);
+          }
+        }
+      }
+    }
+
+    keep_cheapest(next, max_programs_);
+    stable_sort(next.begin(), next.end(), [](const Program& a, const Program& b) {
+      return a.cost < b.cost;
+    });
+    level.swap(next);
+  }
+
+  return found;
+}
+
+void EnumerativeSearch::extensions(const Program& p, vector<Instruction>& instrs) {
+  for (auto o : pools_.get_opcodes()) {
+    Instruction instr(o);
+    // Straight-line code over registers only
+    if (instr.is_label_defn() || instr.is_memory_dereference() || instr.is_push() || instr.is_pop() ||
+        instr.is_any_call() || instr.is_any_jump() || instr.is_any_return() || instr.is_any_loop()) {
+      continue;
+    }
+    fill_operands(instr, 0, p.defs, instrs);
+  }
+}
+
+void EnumerativeSearch::fill_operands(Instruction& instr, size_t i, const RegSet& rs, vector<Instruction>& instrs) {
+  if (i == instr.arity()) {
+    if (instr.check()) {
+      instrs.push_back(instr);
+    }
+    return;
+  }
+
+  vector<Operand> ops;
+  if (!pools_.get_all_ops(instr.get_opcode(), i, rs, instr.maybe_read(i), ops)) {
+    return;
+  }
+  for (const auto& op : ops) {
+    instr.set_operand(i, op);
+    fill_operands(instr, i+1, rs, instrs);
+  }
+}
+
+void EnumerativeSearch::keep_cheapest(vector<Program>& ps, size_t n) {
+  if (ps.size() <= n) {
+    return;
+  }
+  nth_element(ps.begin(), ps.begin() + n, ps.end(), [](const Program& a, const Program& b) {
+    return a.cost < b.cost;
+  });
+  ps.resize(n);
+}
+
+Cfg EnumerativeSearch::make_cfg(const Cfg& target, const vector<Instruction>& code) {
+  Cfg cfg = target;
+  cfg.get_function().clear();
+  cfg.get_function().push_back(target.get_code()[0]);
+  for (const auto& instr : code) {
+    cfg.get_function().push_back(instr);
+  }
+  cfg.get_function().push_back({RET});
+  cfg.recompute();
+  return cfg;
+}
+
+bool EnumerativeSearch::fingerprint(const Sandbox& sb, uint64_t& hash) {
+  hash = fnv_basis;
+  for (size_t i = 0, ie = sb.size(); i < ie; ++i) {
+    const auto& cs = *sb.get_output(i);
+    if (cs.code != ErrorCode::NORMAL) {
+      return false;
+    }
+    for (size_t r = 0, re = cs.gp.size(); r < re; ++r) {
+      mix(hash, cs.gp[r].get_fixed_quad(0));
+    }
+    for (size_t r = 0, re = cs.sse.size(); r < re; ++r) {
+      for (size_t q = 0, qe = cs.sse[r].num_fixed_bytes() / 8; q < qe; ++q) {
+        mix(hash, cs.sse[r].get_fixed_quad(q));
+      }
+    }
+    for (size_t f = 0, fe = cs.rf.size(); f < fe; ++f) {
+      if (!cs.rf.is_fixed(f)) {
+        mix(hash, cs.rf.is_set(f));
+      }
+    }
+  }
+  return true;
+}
+
+uint64_t EnumerativeSearch::live_out_fingerprint(const Sandbox& sb, const RegSet& live_outs) {
+  uint64_t hash = fnv_basis;
+  for (size_t i = 0, ie = sb.size(); i < ie; ++i) {
+    const auto& cs = *sb.get_output(i);
+    mix(hash, (uint64_t)cs.code);
+    for (auto r = live_outs.gp_begin(), re = live_outs.gp_end(); r != re; ++r) {
+      // High byte registers are left to the cost function
+      if ((*r).type() == Type::RH) {
+        continue;
+      }
+      const auto size = (*r).size();
+      const auto mask = size == 64 ? -1ull : (1ull << size) - 1;
+      mix(hash, cs.gp[*r].get_fixed_quad(0) & mask);
+    }
+    for (auto r = live_outs.any_sub_sse_begin(), re = live_outs.any_sub_sse_end(); r != re; ++r) {
+      for (size_t q = 0, qe = (*r).size() / 64; q < qe; ++q) {
+        mix(hash, cs.sse[*r].get_fixed_quad(q));
+      }
+    }
+    for (auto f : {
+           eflags_cf, eflags_pf, eflags_af, eflags_zf, eflags_of, eflags_sf
+         }) {
+      if (live_outs.contains(f)) {
+        mix(hash, cs.rf.is_set(f.index()));
+      }
+    }
+  }
+  return hash;
+}
+
+} // namespace stoke
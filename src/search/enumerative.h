@@ -0,0 +1,142 @@
+// Copyright 2013-2016 Stanford University
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef STOKE_SRC_SEARCH_ENUMERATIVE_H
+#define STOKE_SRC_SEARCH_ENUMERATIVE_H
+
+#include <chrono>
+#include <unordered_set>
+#include <vector>
+
+#include "src/cfg/cfg.h"
+#include "src/cost/cost_function.h"
+#include "src/ext/x64asm/include/x64asm.h"
+#include "src/sandbox/sandbox.h"
+#include "src/search/search_state.h"
+#include "src/transform/pools.h"
+
+namespace stoke {
+
+/** Searches for short rewrites by enumerating straight-line programs bottom-up,
+  shortest first.  Programs are built from the opcodes and the register and
+  immediate operands in a transform pool.  Each one is run on the sandbox's
+  testcases, and a program whose whole machine state matches one seen before
+  is not extended, since anything built on it would behave like something
+  already built.  The programs of each length are extended in order of cost,
+  and only the cheapest are kept when there are too many.  The enumeration
+  stops at the first length with a program that agrees with the target on its
+  live outputs, because nothing bounds the cost of longer programs; of those,
+  the one with the lowest cost is returned.
+
+  The work can be split between several processes, each of which enumerates
+  the programs that start with its share of the first instructions. */
+class EnumerativeSearch {
+public:
+  EnumerativeSearch(TransformPools& pools) : pools_(pools) {
+    set_max_length(3);
+    set_max_programs(100000);
+    set_jobs(1);
+    set_timeout_itr(0);
+    set_timeout_sec(std::chrono::duration<double>::zero());
+  }
+
+  /** Set the longest program to enumerate. */
+  EnumerativeSearch& set_max_length(size_t n) {
+    max_length_ = n;
+    return *this;
+  }
+  /** Set how many programs of each length to keep for extension; the cheapest are kept. */
+  EnumerativeSearch& set_max_programs(size_t n) {
+    max_programs_ = n;
+    return *this;
+  }
+  /** Set how many processes to split the enumeration between. */
+  EnumerativeSearch& set_jobs(size_t n) {
+    jobs_ = n == 0 ? 1 : n;
+    return *this;
+  }
+  /** Set the maximum number of programs to run before giving up, or zero for no limit. */
+  EnumerativeSearch& set_timeout_itr(size_t timeout) {
+    timeout_itr_ = timeout;
+    return *this;
+  }
+  /** Set the maximum number of seconds to run for, or zero for no limit. */
+  EnumerativeSearch& set_timeout_sec(std::chrono::duration<double> timeout) {
+    timeout_sec_ = timeout;
+    return *this;
+  }
+
+  /** Enumerates rewrites of a target, running them on sb's testcases.  On
+    success, the rewrite found becomes the state's current, best yet and best
+    correct program and state.success is set. */
+  void run(const Cfg& target, CostFunction& fxn, Sandbox& sb, SearchState& state);
+
+  /** Returns the number of programs run by the last call to run(). */
+  size_t get_iterations() const {
+    return iterations_;
+  }
+  /** Returns the time spent in the last call to run(). */
+  std::chrono::duration<double> get_elapsed() const {
+    return elapsed_;
+  }
+
+private:
+  /** Where opcodes and operands come from. */
+  TransformPools& pools_;
+
+  /** The longest program to enumerate. */
+  size_t max_length_;
+  /** How many programs of each length are kept. */
+  size_t max_programs_;
+  /** How many processes to use. */
+  size_t jobs_;
+  /** Limits on the number of programs run and the time spent. */
+  size_t timeout_itr_;
+  std::chrono::duration<double> timeout_sec_;
+
+  /** Statistics for the last run. */
+  size_t iterations_;
+  std::chrono::duration<double> elapsed_;
+
+  /** A program, the registers it leaves defined, and its cost. */
+  struct Program {
+    std::vector<x64asm::Instruction> code;
+    x64asm::RegSet defs;
+    Cost cost;
+  };
+
+  /** Enumerates programs whose first instruction is the shard-th of every
+    shards.  Returns true and sets best if a match is found. */
+  bool enumerate(const Cfg& target, CostFunction& fxn, Sandbox& sb, size_t shard, size_t shards,
+                 std::chrono::steady_clock::time_point deadline, Cfg& best);
+
+  /** Appends every instruction that can follow a program to instrs. */
+  void extensions(const Program& p, std::vector<x64asm::Instruction>& instrs);
+  /** Fills in every choice of operands for an instruction from index i on. */
+  void fill_operands(x64asm::Instruction& instr, size_t i, const x64asm::RegSet& rs,
+                     std::vector<x64asm::Instruction>& instrs);
+
+  /** Drops all but the n cheapest programs. */
+  static void keep_cheapest(std::vector<Program>& ps, size_t n);
+  /** Returns a copy of the target whose code is replaced by a program. */
+  static Cfg make_cfg(const Cfg& target, const std::vector<x64asm::Instruction>& code);
+  /** Hashes the full machine state on every testcase; returns false if any signaled. */
+  static bool fingerprint(const Sandbox& sb, uint64_t& hash);
+  /** Hashes the live outputs on every testcase. */
+  static uint64_t live_out_fingerprint(const Sandbox& sb, const x64asm::RegSet& live_outs);
+};
+
+} // namespace stoke
+
+#endif
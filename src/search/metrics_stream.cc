@@ -0,0 +1,216 @@
+// Copyright 2013-2016 Stanford University
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <chrono>
+#include <errno.h>
+#include <fcntl.h>
+#include <sstream>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "src/search/metrics_stream.h"
+#include "src/transform/weighted.h"
+
+using namespace std;
+using namespace std::chrono;
+
+namespace stoke {
+
+bool MetricsStream::open(const string& dest) {
+  close();
+  error_ = "";
+
+  const string prefix = "unix:";
+  socket_ = dest.compare(0, prefix.length(), prefix) == 0;
+  if (socket_) {
+    const auto path = dest.substr(prefix.length());
+    sockaddr_un addr;
+    if (path.length() >= sizeof(addr.sun_path)) {
+      error_ = "Socket path is too long: " + path;
+      return false;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path.c_str());
+
+    fd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd_ != -1 && connect(fd_, (sockaddr*)&addr, sizeof(addr)) == -1) {
+      ::close(fd_);
+      fd_ = -1;
+    }
+  } else {
+    fd_ = ::open(dest.c_str(), O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+  }
+
+  if (fd_ == -1) {
+    error_ = "Unable to open " + dest + ": " + strerror(errno);
+    return false;
+  }
+  return true;
+}
+
+void MetricsStream::close() {
+  if (fd_ != -1) {
+    ::close(fd_);
+    fd_ = -1;
+  }
+}
+
+void MetricsStream::write(const StatisticsCallbackData& data,
+                          const vector<pair<string, double>>& extras) {
+  if (!is_open()) {
+    return;
+  }
+
+  const auto now = duration_cast<duration<double>>(system_clock::now().time_since_epoch());
+  const auto elapsed = data.elapsed.count();
+
+  ostringstream ss;
+  ss.precision(15);
+  buffer_.clear();
+
+  buffer_ += "{\"run\": ";
+  quote(run_id_);
+  ss << ", \"time\": " << now.count()
+     << ", \"iterations\": " << data.iterations
+     << ", \"elapsed\": " << elapsed
+     << ", \"iterations_per_sec\": " << (elapsed > 0 ? data.iterations / elapsed : 0)
+     << ", \"current_cost\": " << data.current_cost
+     << ", \"best_yet_cost\": " << data.best_yet_cost
+     << ", \"best_correct_cost\": " << data.best_correct_cost
+     << ", \"phases\": {\"transform\": " << data.transform_time.count()
+     << ", \"cost\": " << data.cost_time.count()
+     << ", \"undo\": " << data.undo_time.count() << "}"
+     << ", \"moves\": [";
+  buffer_ += ss.str();
+
+  const auto transform = static_cast<const WeightedTransform*>(data.transform);
+  for (size_t i = 0, ie = transform == nullptr ? 0 : transform->size(); i < ie; ++i) {
+    const auto& ms = data.move_statistics[i];
+    buffer_ += i == 0 ? "{\"name\": " : ", {\"name\": ";
+    quote(transform->get_transform(i)->get_name());
+    ss.str("");
+    ss << ", \"proposed\": " << ms.num_proposed
+       << ", \"succeeded\": " << ms.num_succeeded
+       << ", \"accepted\": " << ms.num_accepted << "}";
+    buffer_ += ss.str();
+  }
+  buffer_ += "]";
+
+  for (const auto& e : extras) {
+    buffer_ += ", ";
+    quote(e.first);
+    ss.str("");
+    ss << ": " << e.second;
+    buffer_ += ss.str();
+  }
+  buffer_ += "}\n";
+
+  // A short write to a socket would leave a torn record; finish it.
+  for (size_t done = 0; done < buffer_.length();) {
+    const auto n = socket_ ?
+                   send(fd_, buffer_.data() + done, buffer_.length() - done, MSG_NOSIGNAL) :
+                   ::write(fd_, buffer_.data() + done, buffer_.length() - done);
+    if (n == -1 && errno == EINTR) {
+      continue;
+    } else if (n <= 0) {
+      error_ = string("Unable to write metrics: ") + strerror(errno);
+      close();
+      return;
+    }
+    done += n;
+  }
+}
+
+void MetricsStream::quote(const string& s) {
+  static const char* hex = "0123456789abcdef";
+
+  buffer_ += '"';
+  for (auto c : s) {
+    if (c == '"' || c == '\\') {
+      buffer_ += '\\';
+      buffer_ += c;
+    } else if ((unsigned char)c < 0x20) {
+      buffer_ += "\\u00";
+      buffer_ += hex[(c >> 4) & 0xf];
+      buffer_ += hex[c & 0xf];
+    } else {
+      buffer_ += c;
+    }
+  }
+  buffer_ += '"';
+}
+
+MetricsSummary& MetricsSummary::read(istream& is) {
+  string line;
+  string id;
+  while (getline(is, line)) {
+    if (!field(line, "run", id)) {
+      continue;
+    }
+
+    const auto is_new = runs_.find(id) == runs_.end();
+    auto& r = runs_[id];
+    const auto prev_best = r.best_yet_cost;
+    const auto prev_elapsed = r.elapsed;
+
+    r.time = number(line, "time");
+    r.iterations = number(line, "iterations");
+    r.elapsed = number(line, "elapsed");
+    r.iterations_per_sec = number(line, "iterations_per_sec");
+    r.current_cost = number(line, "current_cost");
+    r.best_yet_cost = number(line, "best_yet_cost");
+    r.best_correct_cost = number(line, "best_correct_cost");
+    r.verifications = number(line, "verifications");
+    r.verification_time = number(line, "verification_time");
+    r.final = number(line, "final") != 0;
+
+    // Each search cycle restarts the elapsed time
+    if (is_new || r.best_yet_cost < prev_best || r.elapsed < prev_elapsed) {
+      r.improved = r.elapsed;
+    }
+  }
+  return *this;
+}
+
+bool MetricsSummary::field(const string& line, const string& key, string& val) {
+  const auto pos = line.find("\"" + key + "\": ");
+  if (pos == string::npos) {
+    return false;
+  }
+  auto begin = pos + key.length() + 4;
+  if (begin < line.length() && line[begin] == '"') {
+    val.clear();
+    for (++begin; begin < line.length() && line[begin] != '"'; ++begin) {
+      if (line[begin] == '\\' && begin + 1 < line.length()) {
+        ++begin;
+      }
+      val += line[begin];
+    }
+    return true;
+  }
+  const auto end = line.find_first_of(",}", begin);
+  val = line.substr(begin, end == string::npos ? string::npos : end - begin);
+  return true;
+}
+
+double MetricsSummary::number(const string& line, const string& key) {
+  string val;
+  return field(line, key, val) ? strtod(val.c_str(), nullptr) : 0;
+}
+
+} // namespace stoke
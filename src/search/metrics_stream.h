@@ -0,0 +1,131 @@
+// Copyright 2013-2016 Stanford University
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef STOKE_SRC_SEARCH_METRICS_STREAM_H
+#define STOKE_SRC_SEARCH_METRICS_STREAM_H
+
+#include <iostream>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "src/search/statistics_callback.h"
+
+namespace stoke {
+
+/** Appends one JSON object per line to a file or a unix domain socket for every
+  statistics update of a search, so that many concurrent searches can be
+  monitored from one place.  Each record is written with a single call to
+  write(2); records from different processes appending to the same file don't
+  interleave.  Any error closes the stream rather than interrupting the search. */
+class MetricsStream {
+public:
+  /** Creates a closed stream. */
+  MetricsStream() : fd_(-1) { }
+  /** Streams can't share a descriptor. */
+  MetricsStream(const MetricsStream& rhs) = delete;
+  MetricsStream& operator=(const MetricsStream& rhs) = delete;
+  /** Closes the stream. */
+  ~MetricsStream() {
+    close();
+  }
+
+  /** Opens a destination; either a path to append to, or unix:<path> for a
+    listening stream socket.  Returns false on error. */
+  bool open(const std::string& dest);
+  /** Closes the stream. */
+  void close();
+  /** Is the stream open? */
+  bool is_open() const {
+    return fd_ != -1;
+  }
+
+  /** Sets the identifier that every record is tagged with. */
+  MetricsStream& set_run_id(const std::string& id) {
+    run_id_ = id;
+    return *this;
+  }
+
+  /** Writes a record; extras are appended as additional numeric fields. */
+  void write(const StatisticsCallbackData& data,
+             const std::vector<std::pair<std::string, double>>& extras = {});
+
+  /** Did the last call to open() or write() fail? */
+  bool has_error() const {
+    return !error_.empty();
+  }
+  /** Returns a description of the last error. */
+  const std::string& get_error() const {
+    return error_;
+  }
+
+private:
+  /** Where records are written, or -1. */
+  int fd_;
+  /** Are records sent to a socket? */
+  bool socket_;
+  /** Tag for every record. */
+  std::string run_id_;
+  /** Scratch space for formatting records. */
+  std::string buffer_;
+  /** The last error. */
+  std::string error_;
+
+  /** Appends a quoted json string to the buffer. */
+  void quote(const std::string& s);
+};
+
+/** Keeps the most recent record of every run in one or more streams written by
+  MetricsStream, along with when each run last improved. */
+class MetricsSummary {
+public:
+  /** What is known about a run from its most recent record. */
+  struct Run {
+    double time;
+    double iterations;
+    double elapsed;
+    double iterations_per_sec;
+    double current_cost;
+    double best_yet_cost;
+    double best_correct_cost;
+    double verifications;
+    double verification_time;
+    /** Was this the last record the run will write? */
+    bool final;
+    /** Search time at which best_yet_cost last went down. */
+    double improved;
+  };
+
+  /** Reads records until the end of a stream; lines that aren't records are skipped. */
+  MetricsSummary& read(std::istream& is);
+
+  /** Returns every run seen so far, by run id. */
+  const std::map<std::string, Run>& get_runs() const {
+    return runs_;
+  }
+
+private:
+  /** Every run seen so far. */
+  std::map<std::string, Run> runs_;
+
+  /** Finds the value of a top-level field in a record. */
+  static bool field(const std::string& line, const std::string& key, std::string& val);
+  /** Returns the value of a numeric field in a record, or zero. */
+  static double number(const std::string& line, const std::string& key);
+};
+
+} // namespace stoke
+
+#endif
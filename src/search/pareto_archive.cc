@@ -0,0 +1,181 @@
+// Copyright 2013-2016 Stanford University
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <limits>
+#include <sstream>
+
+#include "src/cfg/cfg_transforms.h"
+#include "src/search/pareto_archive.h"
+
+using namespace std;
+
+namespace {
+
+/** Quotes a string for JSON. */
+string quote(const string& s) {
+  ostringstream oss;
+  oss << "\"";
+  for (auto c : s) {
+    switch (c) {
+    case '"':
+      oss << "\\\"";
+      break;
+    case '\\':
+      oss << "\\\\";
+      break;
+    case '\n':
+      oss << "\\n";
+      break;
+    case '\t':
+      oss << "\\t";
+      break;
+    default:
+      oss << c;
+      break;
+    }
+  }
+  oss << "\"";
+  return oss.str();
+}
+
+} // namespace
+
+namespace stoke {
+
+bool ParetoArchive::insert(const Cfg& cfg) {
+  // Search offers the same rewrite many times; turn repeats away before
+  // copying the rewrite or evaluating anything
+  ostringstream seen;
+  for (const auto& instr : cfg.get_code()) {
+    if (!instr.is_nop()) {
+      seen << instr << endl;
+    }
+  }
+  if (!seen_.insert(seen.str()).second) {
+    return false;
+  }
+
+  Cfg canon = cfg;
+  canon.recompute();
+  CfgTransforms::remove_unreachable(canon);
+  CfgTransforms::remove_nop(canon);
+
+  ostringstream oss;
+  oss << canon.get_code();
+  const auto key = oss.str();
+  for (const auto& e : entries_) {
+    if (e.key == key) {
+      return false;
+    }
+  }
+
+  vector<Cost> costs;
+  for (auto fxn : fxns_) {
+    costs.push_back((*fxn)(canon).second);
+  }
+
+  // Ties go to the rewrite found first
+  for (const auto& e : entries_) {
+    if (e.costs == costs || dominates(e.costs, costs)) {
+      return false;
+    }
+  }
+  entries_.erase(remove_if(entries_.begin(), entries_.end(), [&costs](const Entry& e) {
+    return dominates(costs, e.costs);
+  }), entries_.end());
+
+  entries_.push_back({canon, costs, key});
+  if (entries_.size() <= capacity_) {
+    return true;
+  }
+  evict();
+  return entries_.back().key == key;
+}
+
+void ParetoArchive::write(ostream& os) const {
+  os << "{" << endl;
+  os << "  \"objectives\": [";
+  for (size_t i = 0; i < names_.size(); ++i) {
+    os << (i > 0 ? ", " : "") << quote(names_[i]);
+  }
+  os << "]," << endl;
+
+  os << "  \"rewrites\": [" << endl;
+  for (size_t i = 0; i < entries_.size(); ++i) {
+    const auto& e = entries_[i];
+    os << "    {" << endl;
+    os << "      \"costs\": {";
+    for (size_t j = 0; j < names_.size(); ++j) {
+      os << (j > 0 ? ", " : "") << quote(names_[j]) << ": " << e.costs[j];
+    }
+    os << "}," << endl;
+    os << "      \"code\": " << quote(e.key) << endl;
+    os << "    }" << (i + 1 < entries_.size() ? "," : "") << endl;
+  }
+  os << "  ]" << endl;
+  os << "}" << endl;
+}
+
+bool ParetoArchive::dominates(const vector<Cost>& a, const vector<Cost>& b) {
+  bool better = false;
+  for (size_t i = 0, ie = a.size(); i < ie; ++i) {
+    if (a[i] > b[i]) {
+      return false;
+    }
+    better |= a[i] < b[i];
+  }
+  return better;
+}
+
+void ParetoArchive::evict() {
+  // Crowding distance: the size of the box around each rewrite that its
+  // neighbours on every objective span, with the extremes never dropped
+  const auto inf = numeric_limits<double>::infinity();
+  vector<double> distance(entries_.size(), 0);
+  vector<size_t> order(entries_.size());
+
+  for (size_t j = 0, je = names_.size(); j < je; ++j) {
+    for (size_t i = 0; i < order.size(); ++i) {
+      order[i] = i;
+    }
+    sort(order.begin(), order.end(), [this, j](size_t a, size_t b) {
+      return entries_[a].costs[j] < entries_[b].costs[j];
+    });
+
+    const auto lo = entries_[order.front()].costs[j];
+    const auto hi = entries_[order.back()].costs[j];
+    distance[order.front()] = inf;
+    distance[order.back()] = inf;
+    if (hi == lo) {
+      continue;
+    }
+    for (size_t i = 1; i + 1 < order.size(); ++i) {
+      const auto prev = entries_[order[i-1]].costs[j];
+      const auto next = entries_[order[i+1]].costs[j];
+      distance[order[i]] += (double)(next - prev) / (hi - lo);
+    }
+  }
+
+  // Of equally crowded rewrites, the newest goes
+  size_t victim = 0;
+  for (size_t i = 1; i < distance.size(); ++i) {
+    if (distance[i] <= distance[victim]) {
+      victim = i;
+    }
+  }
+  entries_.erase(entries_.begin() + victim);
+}
+
+} // namespace stoke
@@ -0,0 +1,108 @@
+// Copyright 2013-2016 Stanford University
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef STOKE_SRC_SEARCH_PARETO_ARCHIVE_H
+#define STOKE_SRC_SEARCH_PARETO_ARCHIVE_H
+
+#include <iostream>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "src/cfg/cfg.h"
+#include "src/cost/cost.h"
+#include "src/cost/cost_function.h"
+
+namespace stoke {
+
+/** Keeps the correct rewrites that no other correct rewrite beats on every one
+  of several objectives, such as latency and size, so that a trade-off can be
+  chosen after search rather than fixed by its cost function.  Rewrites are
+  stored with unreachable code and nops removed, and rewrites that are the same
+  once these are removed are only kept once.  When more rewrites are on the
+  front than the archive holds, the ones closest to their neighbours are
+  dropped first, which keeps the extremes of every objective.  A rewrite that
+  only differs from one offered before by its nops is turned away before any
+  objective is evaluated. */
+class ParetoArchive {
+public:
+  /** A rewrite and its cost under each objective. */
+  struct Entry {
+    Cfg cfg;
+    std::vector<Cost> costs;
+    /** The rewrite's code, used to recognize duplicates. */
+    std::string key;
+  };
+
+  ParetoArchive() {
+    set_capacity(16);
+  }
+
+  /** Adds an objective to minimize.  Objectives must all be added before the
+    first rewrite is. */
+  ParetoArchive& add_objective(const std::string& name, CostFunction* fxn) {
+    names_.push_back(name);
+    fxns_.push_back(fxn);
+    return *this;
+  }
+  /** Set the most rewrites to keep. */
+  ParetoArchive& set_capacity(size_t n) {
+    capacity_ = n == 0 ? 1 : n;
+    return *this;
+  }
+
+  /** Offers a correct rewrite to the archive.  Returns true if it was kept. */
+  bool insert(const Cfg& cfg);
+  /** Removes every rewrite, and forgets the ones offered so far. */
+  void clear() {
+    entries_.clear();
+    seen_.clear();
+  }
+
+  /** Returns the names of the objectives. */
+  const std::vector<std::string>& get_objectives() const {
+    return names_;
+  }
+  /** Returns the rewrites kept, in the order they were found. */
+  const std::vector<Entry>& get_entries() const {
+    return entries_;
+  }
+  /** Returns the number of rewrites kept. */
+  size_t size() const {
+    return entries_.size();
+  }
+
+  /** Writes the rewrites and their costs as JSON. */
+  void write(std::ostream& os) const;
+
+private:
+  /** Objectives and their names. */
+  std::vector<std::string> names_;
+  std::vector<CostFunction*> fxns_;
+  /** The most rewrites to keep. */
+  size_t capacity_;
+  /** The rewrites on the front. */
+  std::vector<Entry> entries_;
+  /** The code of every rewrite offered so far, without its nops. */
+  std::unordered_set<std::string> seen_;
+
+  /** Is a no worse than b on every objective and better on one? */
+  static bool dominates(const std::vector<Cost>& a, const std::vector<Cost>& b);
+  /** Drops the most crowded rewrite. */
+  void evict();
+};
+
+} // namespace stoke
+
+#endif
@@ -38,7 +38,8 @@ void handler(int sig, siginfo_t* siginfo, void* context) {
 
 namespace stoke {
 
-Search::Search(Transform* transform) : transform_(transform) {
+Search::Search(Transform* transform) :
+  transform_(transform), current_cost_(0), best_yet_cost_(0), best_correct_cost_(0) {
   set_seed(0);
   set_timeout_itr(0);
   set_timeout_sec(steady_clock::duration::zero());
@@ -46,6 +47,11 @@ Search::Search(Transform* transform) : transform_(transform) {
   set_progress_callback(nullptr, nullptr);
   set_statistics_callback(nullptr, nullptr);
   set_statistics_interval(100000);
+  set_trace_recorder(nullptr);
+  set_phase_timing(false);
+  set_snapshot_sandbox(nullptr);
+  set_snapshot_lag(16);
+  set_pareto_archive(nullptr);
 
   static bool once = false;
   if (!once) {
@@ -65,6 +71,9 @@ void Search::run(const Cfg& target, CostFunction& fxn, Init init, SearchState& s
 
   // Configure initial state
   configure(target, fxn, state, aux_fxns);
+  if (trace_ != nullptr) {
+    trace_->begin(state.current);
+  }
 
   // Make sure target and rewrite are sound to begin with
   assert(state.best_yet.is_sound());
@@ -75,17 +84,27 @@ void Search::run(const Cfg& target, CostFunction& fxn, Init init, SearchState& s
   // statistics.
   move_statistics = vector<Statistics>(static_cast<WeightedTransform*>(transform_)->size());
   num_iterations = 0;
+  transform_time_ = cost_time_ = undo_time_ = duration<double>::zero();
+  snapshot_costs(state);
   const auto start = chrono::steady_clock::now();
+  if (snapshot_sb_ != nullptr) {
+    snapshot_sb_->take_snapshots(state.current);
+  }
 
   // Early corner case bailouts
   if (state.current_cost == 0) {
     state.success = true;
     state.best_correct = state.current;
     state.best_correct_cost = 0;
+    if (snapshot_sb_ != nullptr) {
+      snapshot_sb_->clear_snapshots();
+    }
     return;
   }
 
   TransformInfo ti;
+  size_t stale_accepts = 0;
+  size_t next_offer = 0;
 
   give_up_now = false;
   size_t iterations = 0;
@@ -94,6 +113,7 @@ void Search::run(const Cfg& target, CostFunction& fxn, Init init, SearchState& s
     if ((statistics_cb_ != nullptr) && (iterations % interval_ == 0) && iterations > 0) {
       elapsed = duration_cast<duration<double>>(steady_clock::now() - start);
       num_iterations = iterations;
+      snapshot_costs(state);
       statistics_cb_(get_statistics(), statistics_cb_arg_);
     }
 
@@ -106,9 +126,14 @@ void Search::run(const Cfg& target, CostFunction& fxn, Init init, SearchState& s
     }
 
 
+    auto mark = phase_timing_ ? steady_clock::now() : steady_clock::time_point();
     ti = (*transform_)(state.current);
+    lap(transform_time_, mark);
     move_statistics[ti.move_type].num_proposed++;
     if (!ti.success) {
+      if (trace_ != nullptr) {
+        trace_->record_failure(ti);
+      }
       continue;
     }
     move_statistics[ti.move_type].num_succeeded++;
@@ -116,16 +141,32 @@ void Search::run(const Cfg& target, CostFunction& fxn, Init init, SearchState& s
     const auto p = prob_(gen_);
     const auto max = state.current_cost - (log(p) / beta_);
 
-    const auto new_res = fxn(state.current, max + 1);
+    const Cost bound = max + 1;
+    const auto new_res = fxn(state.current, bound);
+    lap(cost_time_, mark);
     const auto is_correct = new_res.first;
     const auto new_cost = new_res.second;
 
+    if (trace_ != nullptr) {
+      trace_->record(ti, bound, new_cost, new_cost <= max);
+    }
     if (new_cost > max) {
       (*transform_).undo(state.current, ti);
+      lap(undo_time_, mark);
       continue;
     }
     move_statistics[ti.move_type].num_accepted++;
     state.current_cost = new_cost;
+    // The cost function just ran this rewrite, so the resume point is its own;
+    // proposals don't change the code's length, so it falls short of the last
+    // snapshot only if this one changed something before it
+    if (snapshot_sb_ != nullptr &&
+        (snapshot_sb_->get_resume_point() < snapshot_sb_->get_num_snapshots() ||
+         snapshot_sb_->get_num_snapshots() == 0) &&
+        ++stale_accepts >= snapshot_lag_) {
+      snapshot_sb_->take_snapshots(state.current);
+      stale_accepts = 0;
+    }
 
     const auto new_best_yet = new_cost < state.best_yet_cost;
     if (new_best_yet) {
@@ -141,6 +182,10 @@ void Search::run(const Cfg& target, CostFunction& fxn, Init init, SearchState& s
 
       new_best_correct_cb_({state}, new_best_correct_cb_arg_);
     }
+    if (pareto_ != nullptr && is_correct && (new_best_correct_yet || iterations >= next_offer)) {
+      pareto_->insert(state.current);
+      next_offer = iterations + interval_;
+    }
 
     if ((progress_cb_ != nullptr) && (new_best_yet || new_best_correct_yet)) {
       progress_cb_({state}, progress_cb_arg_);
@@ -150,10 +195,14 @@ void Search::run(const Cfg& target, CostFunction& fxn, Init init, SearchState& s
   // update values for statistics
   elapsed = duration_cast<duration<double>>(steady_clock::now() - start);
   num_iterations = iterations;
+  snapshot_costs(state);
 
   if (give_up_now) {
     state.interrupted = true;
   }
+  if (snapshot_sb_ != nullptr) {
+    snapshot_sb_->clear_snapshots();
+  }
 
   // make sure Cfg's are in a valid state (e.g. liveness information, which we
   // do not update during search)
@@ -163,7 +212,10 @@ void Search::run(const Cfg& target, CostFunction& fxn, Init init, SearchState& s
 }
 
 StatisticsCallbackData Search::get_statistics() const {
-  return {move_statistics, num_iterations, elapsed, transform_};
+  return {move_statistics, num_iterations, elapsed, transform_,
+          transform_time_, cost_time_, undo_time_,
+          current_cost_, best_yet_cost_, best_correct_cost_
+         };
 }
 
 void Search::stop() {
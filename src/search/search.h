@@ -19,12 +19,15 @@
 #include <random>
 
 #include "src/cost/cost_function.h"
+#include "src/sandbox/sandbox.h"
 #include "src/search/init.h"
 #include "src/search/progress_callback.h"
 #include "src/search/new_best_correct_callback.h"
+#include "src/search/pareto_archive.h"
 #include "src/search/search_state.h"
 #include "src/search/statistics.h"
 #include "src/search/statistics_callback.h"
+#include "src/search/trace_recorder.h"
 #include "src/transform/transform.h"
 #include "src/tunit/tunit.h"
 
@@ -73,6 +76,38 @@ public:
     statistics_cb_arg_ = arg;
     return *this;
   }
+  /** Record every proposal to a trace; nullptr disables recording. */
+  Search& set_trace_recorder(TraceRecorder* tr) {
+    trace_ = tr;
+    return *this;
+  }
+  /** Measure the time spent in each phase of the search loop for statistics updates. */
+  Search& set_phase_timing(bool pt) {
+    phase_timing_ = pt;
+    return *this;
+  }
+  /** Keep snapshots of the current rewrite in a sandbox, so that proposals only
+    rerun the instructions after the ones they leave unchanged; nullptr disables
+    snapshots. */
+  Search& set_snapshot_sandbox(Sandbox* sb) {
+    snapshot_sb_ = sb;
+    return *this;
+  }
+  /** Retake snapshots once this many accepted proposals have changed the code
+    before the last snapshot.  Accepted proposals that only change the code
+    after it leave the snapshots as good as new, and never cause a retake. */
+  Search& set_snapshot_lag(size_t n) {
+    snapshot_lag_ = n;
+    return *this;
+  }
+  /** Offer correct proposals that are accepted to an archive of trade-offs;
+    nullptr disables this.  Since the archive evaluates every objective, only
+    new best correct rewrites and at most one other per statistics interval
+    are offered. */
+  Search& set_pareto_archive(ParetoArchive* pa) {
+    pareto_ = pa;
+    return *this;
+  }
   /** Set the number of proposals to perform between statistics updates. */
   Search& set_statistics_interval(size_t si) {
     interval_ = si;
@@ -116,11 +151,42 @@ private:
   void* statistics_cb_arg_;
   /** How often are statistics printed? */
   size_t interval_;
+  /** Where proposals are recorded, if anywhere. */
+  TraceRecorder* trace_;
+  /** Is the time spent in each phase being measured? */
+  bool phase_timing_;
+  /** Where snapshots of the current rewrite are kept, if anywhere. */
+  Sandbox* snapshot_sb_;
+  /** How many stale accepts to allow before retaking snapshots. */
+  size_t snapshot_lag_;
+  /** Where correct rewrites are archived, if anywhere. */
+  ParetoArchive* pareto_;
 
   /** Statistics so far. */
   std::vector<Statistics> move_statistics;
   size_t num_iterations;
   std::chrono::duration<double> elapsed;
+  std::chrono::duration<double> transform_time_;
+  std::chrono::duration<double> cost_time_;
+  std::chrono::duration<double> undo_time_;
+  Cost current_cost_;
+  Cost best_yet_cost_;
+  Cost best_correct_cost_;
+
+  /** Adds the time since mark to a phase and resets mark, if phases are being timed. */
+  void lap(std::chrono::duration<double>& phase, std::chrono::steady_clock::time_point& mark) {
+    if (phase_timing_) {
+      const auto now = std::chrono::steady_clock::now();
+      phase += now - mark;
+      mark = now;
+    }
+  }
+  /** Remembers the costs in a search state for statistics updates. */
+  void snapshot_costs(const SearchState& state) {
+    current_cost_ = state.current_cost;
+    best_yet_cost_ = state.best_yet_cost;
+    best_correct_cost_ = state.best_correct_cost;
+  }
 
   /** Configures a search state. */
   void configure(const Cfg& target, CostFunction& fxn, SearchState& state, std::vector<stoke::TUnit>& aux_fxn) const;
@@ -18,6 +18,7 @@
 #include <chrono>
 #include <vector>
 
+#include "src/cost/cost.h"
 #include "src/search/statistics.h"
 #include "src/transform/transform.h"
 
@@ -34,6 +35,15 @@ struct StatisticsCallbackData {
     (This is used to figure out what kind of transform each
     member of the move_statistics corresponds to.) */
   const Transform* transform;
+  /** Time spent proposing moves, evaluating them, and undoing rejected ones.
+    These are zero unless the search was asked to time its phases. */
+  const std::chrono::duration<double> transform_time;
+  const std::chrono::duration<double> cost_time;
+  const std::chrono::duration<double> undo_time;
+  /** The cost of the current rewrite and of the best ones found so far. */
+  const Cost current_cost;
+  const Cost best_yet_cost;
+  const Cost best_correct_cost;
 };
 
 /** Callback signature */
@@ -0,0 +1,115 @@
+// Copyright 2013-2016 Stanford University
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstring>
+#include <sstream>
+
+#include "src/ext/cpputil/include/io/fail.h"
+#include "src/search/trace_reader.h"
+#include "src/search/trace_recorder.h"
+
+using namespace cpputil;
+using namespace std;
+using namespace x64asm;
+
+namespace stoke {
+
+TraceReader::TraceReader(istream& is) : is_(is) {
+  char magic[8];
+  is_.read(magic, 8);
+  if (is_.gcount() != 8 || memcmp(magic, TraceRecorder::magic, 8) != 0) {
+    error_ = "Input is not a search trace";
+  }
+}
+
+bool TraceReader::read_buffer(size_t len) {
+  buffer_.resize(len);
+  is_.read(&buffer_[0], len);
+  return (size_t)is_.gcount() == len;
+}
+
+bool TraceReader::next(Entry& entry) {
+  if (has_error()) {
+    return false;
+  }
+
+  char tag;
+  if (!read(tag)) {
+    return false;
+  }
+
+  if (tag == TraceRecorder::segment_tag) {
+    uint32_t len;
+    if (!read(len) || !read_buffer(len)) {
+      error_ = "Truncated segment";
+      return false;
+    }
+    istringstream ss(buffer_);
+    ss >> entry.rewrite;
+    if (failed(ss)) {
+      error_ = "Unable to parse the rewrite of a segment";
+      return false;
+    }
+    entry.is_segment = true;
+    return true;
+  } else if (tag != TraceRecorder::proposal_tag) {
+    error_ = "Unrecognized entry in trace";
+    return false;
+  }
+
+  entry.is_segment = false;
+  entry.info = TransformInfo();
+  entry.accepted = false;
+  entry.max = 0;
+  entry.cost = 0;
+
+  uint8_t move_type;
+  uint8_t flags;
+  if (!read(move_type) || !read(flags)) {
+    error_ = "Truncated proposal";
+    return false;
+  }
+  entry.info.move_type = move_type;
+  entry.info.success = flags & TraceRecorder::success_flag;
+  entry.accepted = flags & TraceRecorder::accepted_flag;
+  if (!entry.info.success) {
+    return true;
+  }
+
+  uint32_t idx0, idx1;
+  uint16_t len;
+  if (!read(idx0) || !read(idx1) || !read(len) || !read_buffer(len)) {
+    error_ = "Truncated proposal";
+    return false;
+  }
+  entry.info.undo_index[0] = idx0;
+  entry.info.undo_index[1] = idx1;
+
+  Code code;
+  istringstream ss(buffer_);
+  ss >> code;
+  if (failed(ss) || code.size() != 1) {
+    error_ = "Unable to parse instruction '" + buffer_ + "'";
+    return false;
+  }
+  entry.info.redo_instr = code[0];
+
+  if (!read(entry.max) || !read(entry.cost)) {
+    error_ = "Truncated proposal";
+    return false;
+  }
+  return true;
+}
+
+} // namespace stoke
@@ -0,0 +1,81 @@
+// Copyright 2013-2016 Stanford University
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef STOKE_SRC_SEARCH_TRACE_READER_H
+#define STOKE_SRC_SEARCH_TRACE_READER_H
+
+#include <iostream>
+#include <string>
+
+#include "src/cost/cost.h"
+#include "src/ext/x64asm/include/x64asm.h"
+#include "src/transform/info.h"
+
+namespace stoke {
+
+/** Reads back a trace written by TraceRecorder, one entry at a time. */
+class TraceReader {
+public:
+  /** One entry of a trace; either the beginning of a segment or a proposal. */
+  struct Entry {
+    /** Does this entry begin a new segment? */
+    bool is_segment;
+    /** The starting rewrite of a segment. */
+    x64asm::Code rewrite;
+    /** The proposal; undo_instr is not recorded and must be filled in before undo(). */
+    TransformInfo info;
+    /** Was the proposal accepted? */
+    bool accepted;
+    /** The bound that was passed to the cost function. */
+    Cost max;
+    /** The cost that was returned. */
+    Cost cost;
+  };
+
+  /** Creates a reader and checks that the stream holds a trace. */
+  TraceReader(std::istream& is);
+
+  /** Reads the next entry; returns false at the end of the trace or on error. */
+  bool next(Entry& entry);
+
+  /** Did reading fail? */
+  bool has_error() const {
+    return !error_.empty();
+  }
+  /** Returns a description of the error. */
+  const std::string& get_error() const {
+    return error_;
+  }
+
+private:
+  /** Where the trace is read from. */
+  std::istream& is_;
+  /** The first error encountered. */
+  std::string error_;
+  /** Scratch space for parsing instructions. */
+  std::string buffer_;
+
+  /** Reads the raw bytes of a value; returns false on a short read. */
+  template <typename T>
+  bool read(T& t) {
+    is_.read((char*)&t, sizeof(T));
+    return is_.gcount() == sizeof(T);
+  }
+  /** Reads a string of len bytes into buffer_; returns false on a short read. */
+  bool read_buffer(size_t len);
+};
+
+} // namespace stoke
+
+#endif
@@ -0,0 +1,63 @@
+// Copyright 2013-2016 Stanford University
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <sstream>
+
+#include "src/search/trace_recorder.h"
+
+using namespace std;
+using namespace x64asm;
+
+namespace stoke {
+
+constexpr const char* TraceRecorder::magic;
+constexpr char TraceRecorder::segment_tag;
+constexpr char TraceRecorder::proposal_tag;
+constexpr uint8_t TraceRecorder::success_flag;
+constexpr uint8_t TraceRecorder::accepted_flag;
+
+void TraceRecorder::begin(const Cfg& rewrite) {
+  ostringstream ss;
+  ss << rewrite.get_code();
+  buffer_ = ss.str();
+
+  write(segment_tag);
+  write((uint32_t)buffer_.length());
+  os_.write(buffer_.data(), buffer_.length());
+}
+
+void TraceRecorder::record_failure(const TransformInfo& ti) {
+  write(proposal_tag);
+  write((uint8_t)ti.move_type);
+  write((uint8_t)0);
+}
+
+void TraceRecorder::record(const TransformInfo& ti, Cost max, Cost cost, bool accepted) {
+  write(proposal_tag);
+  write((uint8_t)ti.move_type);
+  write((uint8_t)(success_flag | (accepted ? accepted_flag : 0)));
+  write((uint32_t)ti.undo_index[0]);
+  write((uint32_t)ti.undo_index[1]);
+
+  ostringstream ss;
+  ss << ti.redo_instr;
+  buffer_ = ss.str();
+  write((uint16_t)buffer_.length());
+  os_.write(buffer_.data(), buffer_.length());
+
+  write(max);
+  write(cost);
+}
+
+} // namespace stoke
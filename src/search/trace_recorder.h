@@ -0,0 +1,72 @@
+// Copyright 2013-2016 Stanford University
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef STOKE_SRC_SEARCH_TRACE_RECORDER_H
+#define STOKE_SRC_SEARCH_TRACE_RECORDER_H
+
+#include <iostream>
+#include <string>
+
+#include "src/cfg/cfg.h"
+#include "src/cost/cost.h"
+#include "src/transform/info.h"
+
+namespace stoke {
+
+/** Writes a compact binary trace of every proposal made by a search.  A trace
+  is a sequence of segments, one per call to Search::run(); each segment holds
+  the starting rewrite followed by one entry per proposal.  Successful proposals
+  record enough of their TransformInfo to be redone with Transform::redo(), the
+  bound that was passed to the cost function, the resulting cost, and whether
+  the proposal was accepted.  Read traces back with TraceReader. */
+class TraceRecorder {
+public:
+  /** The bytes every trace begins with. */
+  static constexpr const char* magic = "STOKETR1";
+  /** Tag for the beginning of a segment. */
+  static constexpr char segment_tag = 'S';
+  /** Tag for a proposal. */
+  static constexpr char proposal_tag = 'P';
+  /** Flag bits for a proposal. */
+  static constexpr uint8_t success_flag = 0x1;
+  static constexpr uint8_t accepted_flag = 0x2;
+
+  /** Creates a recorder that writes to an output stream. */
+  TraceRecorder(std::ostream& os) : os_(os) {
+    os_.write(magic, 8);
+  }
+
+  /** Starts a new segment from a rewrite. */
+  void begin(const Cfg& rewrite);
+  /** Records a proposal that the transform failed to produce. */
+  void record_failure(const TransformInfo& ti);
+  /** Records a successful proposal that was evaluated with bound max. */
+  void record(const TransformInfo& ti, Cost max, Cost cost, bool accepted);
+
+private:
+  /** Where the trace is written. */
+  std::ostream& os_;
+  /** Scratch space for formatting instructions. */
+  std::string buffer_;
+
+  /** Writes the raw bytes of a value. */
+  template <typename T>
+  void write(T t) {
+    os_.write((const char*)&t, sizeof(T));
+  }
+};
+
+} // namespace stoke
+
+#endif
@@ -0,0 +1,163 @@
+// Copyright 2013-2016 Stanford University
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <cassert>
+#include <map>
+
+#include "src/search/window_partition.h"
+
+using namespace std;
+using namespace x64asm;
+
+namespace {
+
+/** State shared with the profiling callback. */
+struct ProfileData {
+  map<size_t, size_t> line_to_window;
+  vector<stoke::Window>* windows;
+  vector<stoke::CpuStates>* states;
+  size_t max_states;
+};
+
+void profile_callback(const stoke::StateCallbackData& data, void* arg) {
+  auto pd = (ProfileData*)arg;
+  const auto w = pd->line_to_window[data.line];
+
+  (*pd->windows)[w].hits++;
+  auto& ss = (*pd->states)[w];
+  if (ss.size() < pd->max_states) {
+    ss.push_back(data.state);
+  }
+}
+
+} // namespace
+
+namespace stoke {
+
+bool WindowPartition::is_window_instr(const Instruction& instr) {
+  if (instr.is_label_defn() || instr.is_any_jump() || instr.is_any_call() ||
+      instr.is_any_return() || instr.is_any_loop()) {
+    return false;
+  }
+  // Rip-relative operands would point somewhere else once the instruction moves.
+  if (instr.is_explicit_memory_dereference() &&
+      instr.get_operand<M8>(instr.mem_index()).rip_offset()) {
+    return false;
+  }
+  return true;
+}
+
+vector<Window> WindowPartition::operator()(const Cfg& target) const {
+  vector<Window> res;
+  assert(max_size_ > 0);
+
+  for (auto b = target.get_entry() + 1, be = target.get_exit(); b < be; ++b) {
+    if (!target.is_reachable(b)) {
+      continue;
+    }
+
+    for (size_t i = 0, ie = target.num_instrs(b); i < ie;) {
+      if (!is_window_instr(target.get_code()[target.get_index({b, i})])) {
+        ++i;
+        continue;
+      }
+
+      auto j = i;
+      while (j < ie && j - i < max_size_ &&
+             is_window_instr(target.get_code()[target.get_index({b, j})])) {
+        ++j;
+      }
+
+      if (j - i >= min_size_) {
+        Window w;
+        w.begin = target.get_index({b, i});
+        w.end = target.get_index({b, j - 1}) + 1;
+        w.def_ins = target.def_ins({b, i});
+        w.live_outs = target.live_outs({b, j - 1});
+        w.hits = 0;
+        res.push_back(w);
+      }
+      i = j;
+    }
+  }
+
+  return res;
+}
+
+void WindowPartition::profile(Sandbox& sb, const Cfg& target, vector<Window>& windows,
+                              vector<CpuStates>& states, size_t max_states) {
+  ProfileData pd;
+  pd.windows = &windows;
+  pd.states = &states;
+  pd.max_states = max_states;
+
+  const auto fxn = target.get_code()[0].get_operand<Label>(0);
+  sb.insert_function(target);
+  sb.set_entrypoint(fxn);
+
+  states.assign(windows.size(), CpuStates());
+  for (size_t i = 0, ie = windows.size(); i < ie; ++i) {
+    windows[i].hits = 0;
+    pd.line_to_window[windows[i].begin] = i;
+    sb.insert_before(fxn, windows[i].begin, profile_callback, &pd);
+  }
+
+  sb.run();
+  sb.clear_callbacks();
+}
+
+Cfg WindowPartition::extract(const Cfg& target, const Window& window, const Label& label) {
+  Code code;
+  code.push_back(Instruction(LABEL_DEFN, {label}));
+  for (auto i = window.begin; i < window.end; ++i) {
+    code.push_back(target.get_code()[i]);
+  }
+  code.push_back(Instruction(RET));
+
+  return Cfg(TUnit(code), window.def_ins, window.live_outs);
+}
+
+Cfg WindowPartition::stitch(const Cfg& target, const vector<Window>& windows,
+                            const vector<Cfg>& rewrites) {
+  assert(windows.size() == rewrites.size());
+
+  // Splice from the back of the function so that earlier indices stay valid.
+  vector<size_t> order;
+  for (size_t i = 0, ie = windows.size(); i < ie; ++i) {
+    order.push_back(i);
+  }
+  sort(order.begin(), order.end(), [&windows](size_t a, size_t b) {
+    return windows[a].begin > windows[b].begin;
+  });
+
+  auto fxn = target.get_function();
+  for (auto w : order) {
+    for (auto i = windows[w].begin; i < windows[w].end; ++i) {
+      fxn.remove(windows[w].begin);
+    }
+
+    auto idx = windows[w].begin;
+    for (const auto& instr : rewrites[w].get_code()) {
+      if (instr.is_label_defn() || instr.is_any_return() || instr.is_nop()) {
+        continue;
+      }
+      fxn.insert(idx++, instr);
+    }
+  }
+
+  return Cfg(fxn, target.def_ins(), target.live_outs());
+}
+
+} // namespace stoke
@@ -0,0 +1,94 @@
+// Copyright 2013-2016 Stanford University
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef STOKE_SRC_SEARCH_WINDOW_PARTITION_H
+#define STOKE_SRC_SEARCH_WINDOW_PARTITION_H
+
+#include <vector>
+
+#include "src/ext/x64asm/include/x64asm.h"
+
+#include "src/cfg/cfg.h"
+#include "src/sandbox/sandbox.h"
+#include "src/state/cpu_states.h"
+
+namespace stoke {
+
+/** A straight-line range of target instructions that can be searched in isolation. */
+struct Window {
+  /** Index of the first instruction in the window. */
+  size_t begin;
+  /** Index one past the last instruction in the window. */
+  size_t end;
+  /** Registers that are defined on entry to the window. */
+  x64asm::RegSet def_ins;
+  /** Registers that are live on exit from the window. */
+  x64asm::RegSet live_outs;
+  /** Number of times control entered the window while profiling. */
+  size_t hits;
+
+  /** Returns the number of instructions in the window. */
+  size_t size() const {
+    return end - begin;
+  }
+};
+
+class WindowPartition {
+public:
+  /** Creates a partition helper with default window sizes. */
+  WindowPartition() {
+    set_min_size(2);
+    set_max_size(16);
+  }
+
+  /** Set the smallest window worth searching. */
+  WindowPartition& set_min_size(size_t size) {
+    min_size_ = size;
+    return *this;
+  }
+  /** Set the largest window to hand to search. */
+  WindowPartition& set_max_size(size_t size) {
+    max_size_ = size;
+    return *this;
+  }
+
+  /** Splits the reachable basic blocks of a target into windows of straight-line code. */
+  std::vector<Window> operator()(const Cfg& target) const;
+
+  /** Runs the target on every input in a sandbox.  Counts how often each window is entered and
+    records up to max_states machine states at the entry of each window. */
+  static void profile(Sandbox& sb, const Cfg& target, std::vector<Window>& windows,
+                      std::vector<CpuStates>& states, size_t max_states);
+
+  /** Returns a standalone function that executes the instructions in a window. */
+  static Cfg extract(const Cfg& target, const Window& window, const x64asm::Label& label);
+
+  /** Replaces the contents of each window in the target with the body of its rewrite.  Windows
+    must not overlap; rewrites are functions as returned by extract(). */
+  static Cfg stitch(const Cfg& target, const std::vector<Window>& windows,
+                    const std::vector<Cfg>& rewrites);
+
+private:
+  /** The smallest window worth searching. */
+  size_t min_size_;
+  /** The largest window to hand to search. */
+  size_t max_size_;
+
+  /** Can this instruction be moved into a window? */
+  static bool is_window_instr(const x64asm::Instruction& instr);
+};
+
+} // namespace stoke
+
+#endif
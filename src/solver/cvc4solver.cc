@@ -106,13 +106,13 @@ bool Cvc4Solver::get_model_bool(const std::string& var) {
 }
 
 
-std::pair<std::map<uint64_t, cpputil::BitVector>, uint8_t> Cvc4Solver::get_model_array(const std::string& var, uint16_t key_bits, uint16_t value_bits) {
+std::pair<std::map<uint64_t, cpputil::BitVector>, uint64_t> Cvc4Solver::get_model_array(const std::string& var, uint16_t key_bits, uint16_t value_bits) {
 
   // Much thanks to the CVC4 folks!
   // https://github.com/CVC4/CVC4/issues/1067
 
   map<uint64_t, cpputil::BitVector> output_map;;
-  uint8_t default_value = 0;
+  uint64_t default_value = 0;
 
   if (variables_.count(var)) {
 
@@ -126,28 +126,29 @@ std::pair<std::map<uint64_t, cpputil::BitVector>, uint8_t> Cvc4Solver::get_model
       auto index_integer = expr[1].getConst<CVC4::BitVector>().toInteger();
       uint64_t index = (uint64_t)(index_integer.extractBitRange(32, 32).toUnsignedInt()) << 32 |
                        (uint64_t)(index_integer.extractBitRange(32, 0).toUnsignedInt());
-      uint64_t value = expr[2].getConst<CVC4::BitVector>().toInteger().toUnsignedInt();
+      auto value_integer = expr[2].getConst<CVC4::BitVector>().toInteger();
+      uint64_t value = (uint64_t)(value_integer.extractBitRange(32, 32).toUnsignedInt()) << 32 |
+                       (uint64_t)(value_integer.extractBitRange(32, 0).toUnsignedInt());
       expr = expr[0];
 
-      cpputil::BitVector bv(8);
-      bv.get_fixed_byte(0) = value & 0xff;
-      output_map[index] = bv;
+      output_map[index] = model_value(value, value_bits);
       DEBUG_CVC4(cout << "[cvc4][model] adding " << index << " -> " << value << endl;)
     }
 
     if (expr.getKind() == kind::STORE_ALL) {
-      default_value = expr.getConst<ArrayStoreAll>()
-                      .getExpr()
-                      .getConst<CVC4::BitVector>()
-                      .toInteger()
-                      .toUnsignedInt();
+      auto default_integer = expr.getConst<ArrayStoreAll>()
+                             .getExpr()
+                             .getConst<CVC4::BitVector>()
+                             .toInteger();
+      default_value = (uint64_t)(default_integer.extractBitRange(32, 32).toUnsignedInt()) << 32 |
+                      (uint64_t)(default_integer.extractBitRange(32, 0).toUnsignedInt());
       DEBUG_CVC4(cout << "[cvc4][model] default value " << default_value << endl;)
     }
   } else {
     cout << "[cvc4][model] WARNING! BUG! Could not find variable " << var << endl;
   }
 
-  return pair<map<uint64_t, cpputil::BitVector>, uint8_t>(output_map, default_value);
+  return pair<map<uint64_t, cpputil::BitVector>, uint64_t>(output_map, default_value);
 }
 
 ///////  The following is for converting bit-vectors.  Very tedious.  //////////////////////////////
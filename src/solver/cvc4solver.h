@@ -58,7 +58,7 @@ public:
   /** Get the satisfying assignment for a bit from the model. */
   bool get_model_bool(const std::string& var);
 
-  std::pair<std::map<uint64_t, cpputil::BitVector>, uint8_t> get_model_array(const std::string& var, uint16_t key_bits, uint16_t value_bits);
+  std::pair<std::map<uint64_t, cpputil::BitVector>, uint64_t> get_model_array(const std::string& var, uint16_t key_bits, uint16_t value_bits);
 
   void reset() {
     variables_ = std::map<std::string, CVC4::Expr>();
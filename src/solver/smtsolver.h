@@ -57,8 +57,9 @@ public:
   virtual cpputil::BitVector get_model_bv(const std::string& var, uint16_t octs) = 0;
   /** Get the satisfying assignment for a bit from the model. */
   virtual bool get_model_bool(const std::string& var) = 0;
-  /** Get the satisfying assignment for an array */
-  virtual std::pair<std::map<uint64_t, cpputil::BitVector>,uint8_t> get_model_array(const std::string& var, uint16_t key_bits, uint16_t value_bits) = 0;
+  /** Get the satisfying assignment for an array of values up to 64 bits wide,
+      along with the value of every other index. */
+  virtual std::pair<std::map<uint64_t, cpputil::BitVector>,uint64_t> get_model_array(const std::string& var, uint16_t key_bits, uint16_t value_bits) = 0;
 
   /** Check if the last query trivvered an error. */
   virtual bool has_error() {
@@ -72,6 +73,15 @@ public:
 
 protected:
 
+  /** Packs the value of an array element into a bit vector of its width. */
+  static cpputil::BitVector model_value(uint64_t value, uint16_t value_bits) {
+    cpputil::BitVector bv(value_bits);
+    for (size_t i = 0; i < value_bits/8; ++i) {
+      bv.get_fixed_byte(i) = value >> (8*i);
+    }
+    return bv;
+  }
+
   /** Used to set the timeout before invoking solver */
   uint64_t timeout_;
   /** Current error message */
@@ -214,7 +214,7 @@ bool Z3Solver::get_model_bool(const std::string& var) {
 }
 
 
-pair<map<uint64_t, cpputil::BitVector>, uint8_t> Z3Solver::get_model_array(
+pair<map<uint64_t, cpputil::BitVector>, uint64_t> Z3Solver::get_model_array(
   const std::string& var, uint16_t key_bits, uint16_t value_bits) {
 
   map<uint64_t, cpputil::BitVector> addr_val_map;
@@ -243,10 +243,8 @@ pair<map<uint64_t, cpputil::BitVector>, uint8_t> Z3Solver::get_model_array(
     Z3_get_numeral_uint64(context_, k, (long long unsigned int*)&addr);
     Z3_get_numeral_uint64(context_, v, (long long unsigned int*)&value);
 
-    assert(value <= 0xff);
-    cpputil::BitVector bv_v(8);
-    bv_v.get_fixed_byte(0) = value;
-    addr_val_map[addr] = bv_v;
+    assert(value_bits == 64 || value < (1ull << value_bits));
+    addr_val_map[addr] = model_value(value, value_bits);
     DEBUG_Z3(cout << hex << "adding " << addr << "->" << value << endl;)
 
     e = e.arg(0);
@@ -260,9 +258,9 @@ pair<map<uint64_t, cpputil::BitVector>, uint8_t> Z3Solver::get_model_array(
     z3::expr arg = e.arg(0);
     uint64_t value;
     Z3_get_numeral_uint64(context_, arg, (long long unsigned int*)&value);
-    assert(value <= 0xff);
+    assert(value_bits == 64 || value < (1ull << value_bits));
 
-    pair<map<uint64_t, cpputil::BitVector>, uint8_t> result;
+    pair<map<uint64_t, cpputil::BitVector>, uint64_t> result;
     result.first = addr_val_map;
     result.second = value;
     return result;
@@ -285,18 +283,17 @@ pair<map<uint64_t, cpputil::BitVector>, uint8_t> Z3Solver::get_model_array(
       Z3_get_numeral_uint64(context_, k, (long long unsigned int*)&addr);
       Z3_get_numeral_uint64(context_, v, (long long unsigned int*)&value);
 
-      assert(value <= 0xff);
-
-      cpputil::BitVector bv_v(8);
-      bv_v.get_fixed_byte(0) = value;
-      addr_val_map[addr] = bv_v;
+      assert(value_bits == 64 || value < (1ull << value_bits));
+      addr_val_map[addr] = model_value(value, value_bits);
       DEBUG_Z3(cout << hex << "adding " << addr << "->" << value << endl;)
     }
 
     z3::expr default_value = fun_interp.else_value();
-    pair<map<uint64_t, cpputil::BitVector>, uint8_t> result;
+    uint64_t value = 0;
+    Z3_get_numeral_uint64(context_, default_value, (long long unsigned int*)&value);
+    pair<map<uint64_t, cpputil::BitVector>, uint64_t> result;
     result.first = addr_val_map;
-    result.second = default_value;
+    result.second = value;
     return result;
   } else if (kind == Z3_OP_ARRAY_MAP) {
     cout << "[z3] Don't know how to handle Z3_OP_ARRAY_MAP" << endl;
@@ -306,7 +303,7 @@ pair<map<uint64_t, cpputil::BitVector>, uint8_t> Z3Solver::get_model_array(
   // On the other hand, there might be no memory at all or the memory
   // does not matter
   cout << "[z3] Couldn't parse Z3's AST for array model; may have spurious CEG. " << endl;
-  pair<map<uint64_t, cpputil::BitVector>, uint8_t> result(addr_val_map, 0);
+  pair<map<uint64_t, cpputil::BitVector>, uint64_t> result(addr_val_map, 0);
   return result;
 }
 
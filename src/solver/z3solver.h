@@ -67,7 +67,7 @@ public:
   bool get_model_bool(const std::string& var);
 
   /** Get the satisfying assignment for an array (i.e. memory) */
-  std::pair<std::map<uint64_t, cpputil::BitVector>, uint8_t>  get_model_array(const std::string& var, uint16_t key_bits, uint16_t value_bits);
+  std::pair<std::map<uint64_t, cpputil::BitVector>, uint64_t>  get_model_array(const std::string& var, uint16_t key_bits, uint16_t value_bits);
 
 #ifdef DEBUG_Z3_INTERFACE_PERFORMANCE
   static void print_performance() {
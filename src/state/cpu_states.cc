@@ -13,8 +13,9 @@
 // limitations under the License.
 
 #include "src/state/cpu_states.h"
+#include "src/state/cpu_states_parser.h"
 
-#include <regex>
+#include <iterator>
 #include <string>
 
 using namespace cpputil;
@@ -37,26 +38,15 @@ ostream& CpuStates::write_text(std::ostream& os) const {
 }
 
 istream& CpuStates::read_text(std::istream& is) {
-  this->clear();
+  const string s((istreambuf_iterator<char>(is)), istreambuf_iterator<char>());
 
-  for (string s; is.good();) {
-
-    is >> ws;
-    getline(is, s);
-    if (!regex_match(s, regex("Testcase [0-9]+:"))) {
-      fail(is) << "Expected \"Testcase n\" but found \"" << s << "\"" << endl;
-      return is;
-    }
-
-    CpuState t;
-    is >> ws;
-    t.read_text(is);
-
-    this->emplace_back(t);
-  }
-  if (is.eof()) {
-    is.clear(ios::eofbit);
+  CpuStatesParser parser;
+  parser.set_num_threads(0);
+  if (!parser(s, *this)) {
+    fail(is) << parser.get_error() << endl;
+    return is;
   }
+  is.clear(ios::eofbit);
 
   return is;
 }
@@ -0,0 +1,433 @@
+// Copyright 2013-2016 Stanford University
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "src/state/cpu_states_parser.h"
+
+using namespace std;
+
+namespace {
+
+const char* gps[] = {
+  "%rax", "%rcx", "%rdx", "%rbx", "%rsp", "%rbp", "%rsi", "%rdi",
+  "%r8", "%r9", "%r10", "%r11", "%r12", "%r13", "%r14", "%r15"
+};
+
+const char* sses[] = {
+  "%ymm0", "%ymm1", "%ymm2", "%ymm3", "%ymm4", "%ymm5", "%ymm6", "%ymm7",
+  "%ymm8", "%ymm9", "%ymm10", "%ymm11", "%ymm12", "%ymm13", "%ymm14", "%ymm15"
+};
+
+const char* rflags[] = {
+  "%cf", "%1", "%pf", "%0", "%af", "%0", "%zf", "%sf", "%tf", "%if",
+  "%df", "%of", "%iopl[0]", "%iopl[1]", "%nt", "%0", "%rf", "%vm", "%ac", "%vif",
+  "%vip", "%id"
+};
+
+/** A position in the input that keeps track of line numbers for error messages. */
+class Cursor {
+public:
+  Cursor(const char* begin, const char* end, size_t line) : p_(begin), end_(end), line_(line) { }
+
+  /** Returns the first error encountered, if any. */
+  const string& error() const {
+    return error_;
+  }
+  /** Has all input been consumed? */
+  bool at_end() const {
+    return p_ == end_;
+  }
+  /** Returns the next character without consuming it. */
+  char peek() const {
+    return p_ == end_ ? '\0' : *p_;
+  }
+
+  /** Records an error at the current line; always returns false. */
+  bool fail(const string& msg) {
+    if (error_.empty()) {
+      error_ = "Line " + to_string(line_) + ": " + msg;
+    }
+    return false;
+  }
+
+  /** Skips whitespace. */
+  void skip_ws() {
+    for (; p_ != end_ && isspace(*p_); ++p_) {
+      if (*p_ == '\n') {
+        line_++;
+      }
+    }
+  }
+  /** Consumes a single character. */
+  bool get() {
+    if (p_ == end_) {
+      return fail("Unexpected end of input");
+    }
+    if (*p_++ == '\n') {
+      line_++;
+    }
+    return true;
+  }
+  /** Consumes a single, specific character. */
+  bool expect(char c) {
+    if (p_ == end_ || *p_ != c) {
+      return fail(string("Expected '") + c + "' but got '" + peek_line() + "'");
+    }
+    return get();
+  }
+  /** Skips past the next occurrence of c. */
+  bool skip_past(char c) {
+    while (p_ != end_ && *p_ != c) {
+      get();
+    }
+    return expect(c);
+  }
+
+  /** Skips whitespace and reads a whitespace-delimited token. */
+  string token() {
+    skip_ws();
+    const auto begin = p_;
+    while (p_ != end_ && !isspace(*p_)) {
+      ++p_;
+    }
+    return string(begin, p_);
+  }
+  /** Skips whitespace and checks that the next token is s. */
+  bool token_is(const char* s, const char* what) {
+    const auto t = token();
+    if (t != s) {
+      return fail(string("Expected ") + what + " '" + s + "' but got '" + t + "'");
+    }
+    return true;
+  }
+
+  /** Reads exactly n hex digits. */
+  bool hex(size_t n, uint64_t& val) {
+    val = 0;
+    for (size_t i = 0; i < n; ++i) {
+      const auto c = peek();
+      if (!isxdigit(c)) {
+        return fail("Expected a hex digit but got '" + peek_line() + "'");
+      }
+      val = (val << 4) | (isdigit(c) ? c - '0' : (tolower(c) - 'a' + 10));
+      ++p_;
+    }
+    return true;
+  }
+  /** Reads a byte written as two hex digits. */
+  bool hex8(uint8_t& val) {
+    uint64_t v = 0;
+    if (!hex(2, v)) {
+      return false;
+    }
+    val = v;
+    return true;
+  }
+  /** Reads a quad written as two groups of eight hex digits. */
+  bool hex64(uint64_t& val) {
+    uint64_t hi = 0;
+    uint64_t lo = 0;
+    if (!hex(8, hi) || !expect(' ') || !hex(8, lo)) {
+      return false;
+    }
+    val = (hi << 32) | lo;
+    return true;
+  }
+  /** Skips whitespace and reads a (possibly negative) decimal number. */
+  bool number(int64_t& val) {
+    skip_ws();
+    const auto neg = peek() == '-';
+    if (neg) {
+      ++p_;
+    }
+    if (!isdigit(peek())) {
+      return fail("Expected a number but got '" + peek_line() + "'");
+    }
+    val = 0;
+    while (isdigit(peek())) {
+      val = 10 * val + (*p_++ - '0');
+    }
+    val = neg ? -val : val;
+    return true;
+  }
+
+  /** Consumes the rest of the current line, including the newline. */
+  string rest_of_line() {
+    const auto begin = p_;
+    while (p_ != end_ && *p_ != '\n') {
+      ++p_;
+    }
+    string res(begin, p_);
+    if (p_ != end_) {
+      get();
+    }
+    return res;
+  }
+  /** Returns the rest of the current line without consuming it. */
+  string peek_line() const {
+    return string(p_, find(p_, end_, '\n'));
+  }
+
+private:
+  const char* p_;
+  const char* end_;
+  size_t line_;
+  string error_;
+};
+
+bool read_regs(Cursor& c, stoke::Regs& regs, const char** names) {
+  for (size_t i = 0, ie = regs.size(); i < ie; ++i) {
+    if (!c.token_is(names[i], "register")) {
+      return false;
+    }
+    c.skip_ws();
+
+    auto& r = regs[i];
+    for (int j = r.num_fixed_bytes() - 1; j >= 0; --j) {
+      if (!c.hex8(r.get_fixed_byte(j))) {
+        return false;
+      }
+      if (j != 0 && !c.get()) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+bool read_rflags(Cursor& c, stoke::RFlags& rf, const char** names) {
+  for (size_t i = 0, ie = rf.size(); i < ie; ++i) {
+    if (!c.token_is(names[i], "register")) {
+      return false;
+    }
+    const auto val = c.token();
+    if (val != "0" && val != "1") {
+      return c.fail("Expected 0 or 1 for '" + string(names[i]) + "' but got '" + val + "'");
+    }
+    rf.set(i, val == "1");
+  }
+  return true;
+}
+
+bool read_memory(Cursor& c, stoke::Memory& m) {
+  c.skip_ws();
+
+  uint64_t upper = 0;
+  uint64_t lower = 0;
+  if (!c.expect('[') || !c.expect(' ') || !c.hex64(upper) ||
+      !c.expect(' ') || !c.expect('-') || !c.expect(' ') || !c.hex64(lower) ||
+      !c.expect(' ') || !c.expect(']')) {
+    return false;
+  }
+  // Fail for memories that are larger than 100 KB
+  if (upper - lower > 100*1024) {
+    return c.fail("Only memories of size up to 100KB are supported (otherwise, construction a sandbox gets prohibitively expensive)");
+  }
+  m.resize(lower, upper - lower);
+
+  int64_t rows = 0;
+  c.skip_ws();
+  if (!c.skip_past('[') || !c.number(rows) || !c.skip_past(']')) {
+    return false;
+  }
+
+  for (int64_t i = 0; i < rows; ++i) {
+    c.skip_ws();
+
+    uint64_t addr = 0;
+    if (!c.hex64(addr)) {
+      return false;
+    }
+    // Watch out for rows that are outside the range given in summary
+    if (!m.in_range(addr)) {
+      return c.fail("Memory row is outside of the given range");
+    }
+    if (!c.get() || !c.get() || !c.get()) {
+      return false;
+    }
+
+    for (int j = 7; j >= 0; --j) {
+      m.set_valid(addr + j, c.token() == "v");
+    }
+    if (!c.get() || !c.get()) {
+      return false;
+    }
+    for (int j = 7; j >= 0; --j) {
+      uint8_t val = 0;
+      if (!c.get() || !c.hex8(val)) {
+        return false;
+      }
+      if (m.is_valid(addr + j)) {
+        m[addr + j] = val;
+      }
+    }
+  }
+  c.skip_ws();
+
+  return true;
+}
+
+bool read_state(Cursor& c, stoke::CpuState& cs) {
+  int64_t code = 0;
+  if (!c.token_is("SIGNAL", "keyword") || !c.number(code)) {
+    return false;
+  }
+
+  const auto s = c.rest_of_line();
+  const auto open = s.find_first_not_of(' ');
+  if (open == string::npos || s[open] != '[' || s.back() != ']' || open + 1 == s.length()) {
+    return c.fail("Expected '[" + stoke::readable_error_code(cs.code) + "]' (or similar) but got '" + s + "'");
+  }
+  cs.code = static_cast<stoke::ErrorCode>(code);
+
+  if (!read_regs(c, cs.gp, gps) || !read_regs(c, cs.sse, sses) || !read_rflags(c, cs.rf, rflags) ||
+      !read_memory(c, cs.stack) || !read_memory(c, cs.heap) || !read_memory(c, cs.data)) {
+    return false;
+  }
+
+  // Older files end here; newer ones list additional segments.
+  c.skip_ws();
+  if (isdigit(c.peek())) {
+    int64_t n = 0;
+    c.number(n);
+    const auto line = c.rest_of_line();
+    if (line != " more segment(s)") {
+      return c.fail("Expected segment count.  Got \"" + line + "\".");
+    }
+    for (int64_t i = 0; i < n; ++i) {
+      stoke::Memory m;
+      if (!read_memory(c, m)) {
+        return false;
+      }
+      cs.segments.push_back(m);
+    }
+    c.skip_ws();
+  }
+
+  return true;
+}
+
+/** Parses one "Testcase n:" chunk. */
+bool read_testcase(Cursor& c, stoke::CpuState& cs) {
+  c.skip_ws();
+  const auto header = c.peek_line();
+  const auto colon = header.length() - 1;
+  if (header.compare(0, 9, "Testcase ") != 0 || header.length() < 11 || header[colon] != ':' ||
+      !all_of(header.begin() + 9, header.begin() + colon, [](char ch) {
+      return isdigit(ch);
+    })) {
+    return c.fail("Expected \"Testcase n\" but found \"" + header + "\"");
+  }
+  c.rest_of_line();
+
+  if (!read_state(c, cs)) {
+    return false;
+  }
+
+  c.skip_ws();
+  if (!c.at_end()) {
+    return c.fail("Expected \"Testcase n\" but found \"" + c.peek_line() + "\"");
+  }
+  return true;
+}
+
+/** Does this line start a new testcase? */
+bool is_header(const char* begin, const char* end) {
+  while (begin != end && (*begin == ' ' || *begin == '\t')) {
+    ++begin;
+  }
+  return end - begin >= 8 && strncmp(begin, "Testcase", 8) == 0;
+}
+
+} // namespace
+
+namespace stoke {
+
+CpuStatesParser& CpuStatesParser::set_num_threads(size_t n) {
+  num_threads_ = n == 0 ? max(1u, thread::hardware_concurrency()) : n;
+  return *this;
+}
+
+bool CpuStatesParser::operator()(const char* begin, const char* end, CpuStates& res) {
+  res.clear();
+  error_.clear();
+
+  // Split the input into one chunk per testcase.
+  vector<const char*> starts;
+  vector<size_t> lines;
+  size_t line = 1;
+  for (auto p = begin; p < end;) {
+    const auto eol = find(p, end, '\n');
+    if (is_header(p, eol)) {
+      starts.push_back(p);
+      lines.push_back(line);
+    }
+    p = eol == end ? end : eol + 1;
+    line++;
+  }
+
+  // Anything before the first testcase must be whitespace
+  Cursor prefix(begin, starts.empty() ? end : starts[0], 1);
+  prefix.skip_ws();
+  if (starts.empty() || !prefix.at_end()) {
+    prefix.fail("Expected \"Testcase n\" but found \"" + prefix.peek_line() + "\"");
+    error_ = prefix.error();
+    return false;
+  }
+  starts.push_back(end);
+
+  const auto n = lines.size();
+  res.resize(n);
+  vector<string> errors(n);
+
+  auto work = [&](size_t first, size_t last) {
+    for (size_t i = first; i < last; ++i) {
+      Cursor c(starts[i], starts[i + 1], lines[i]);
+      if (!read_testcase(c, res[i])) {
+        errors[i] = c.error();
+        return;
+      }
+    }
+  };
+
+  const auto num_threads = min(num_threads_, n);
+  if (num_threads <= 1) {
+    work(0, n);
+  } else {
+    vector<thread> threads;
+    const auto per_thread = (n + num_threads - 1) / num_threads;
+    for (size_t i = 0; i < n; i += per_thread) {
+      threads.emplace_back(work, i, min(n, i + per_thread));
+    }
+    for (auto& t : threads) {
+      t.join();
+    }
+  }
+
+  for (const auto& e : errors) {
+    if (!e.empty()) {
+      error_ = e;
+      res.clear();
+      return false;
+    }
+  }
+  return true;
+}
+
+} // namespace stoke
@@ -0,0 +1,62 @@
+// Copyright 2013-2016 Stanford University
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef STOKE_SRC_STATE_CPU_STATES_PARSER_H
+#define STOKE_SRC_STATE_CPU_STATES_PARSER_H
+
+#include <string>
+
+#include "src/state/cpu_states.h"
+
+namespace stoke {
+
+/** A hand-written parser for the text format produced by CpuStates::write_text().
+  The input is split on "Testcase n:" lines and the pieces are parsed in parallel.
+  The result is identical to what CpuStates::read_text() would produce. */
+class CpuStatesParser {
+public:
+  /** Creates a single-threaded parser. */
+  CpuStatesParser() {
+    set_num_threads(1);
+  }
+
+  /** Set the number of threads to parse with; 0 means one per hardware thread. */
+  CpuStatesParser& set_num_threads(size_t n);
+
+  /** Parses the text in [begin, end) into res; returns false on error. */
+  bool operator()(const char* begin, const char* end, CpuStates& res);
+  /** Parses the text in s into res; returns false on error. */
+  bool operator()(const std::string& s, CpuStates& res) {
+    return (*this)(s.data(), s.data() + s.length(), res);
+  }
+
+  /** Did the last call fail? */
+  bool has_error() const {
+    return !error_.empty();
+  }
+  /** Returns a description of the first error, including its line number. */
+  const std::string& get_error() const {
+    return error_;
+  }
+
+private:
+  /** The number of threads to parse with. */
+  size_t num_threads_;
+  /** The first error encountered by the last call. */
+  std::string error_;
+};
+
+} // namespace stoke
+
+#endif
@@ -104,20 +104,16 @@ void Memory::write_text_row(ostream& os, uint64_t addr) const {
 }
 
 void Memory::write_text_contents(ostream& os) const {
-  const auto vc = valid_count();
+  const auto rows = valid_rows();
 
-  os << "[ " << vc << " valid rows shown ]";
-  if (vc != 0) {
+  os << "[ " << rows.size() << " valid rows shown ]";
+  if (!rows.empty()) {
     os << endl;
   }
 
-  //BEWARE OF OVERFLOWS; don't use upper_bound().
-  for (uint64_t i = size(); i > 0; i -= 8) {
-    if (!valid_row(lower_bound() + i - 8)) {
-      continue;
-    }
+  for (auto i = rows.rbegin(), ie = rows.rend(); i != ie; ++i) {
     os << endl;
-    write_text_row(os, lower_bound() + i - 8);
+    write_text_row(os, *i);
   }
 }
 
@@ -199,23 +195,21 @@ void Memory::read_text_contents(istream& is) {
   is >> ws;
 }
 
-bool Memory::valid_row(uint64_t addr) const {
-  assert(addr % 8 == 0);
-  for (size_t i = 0; i < 8; ++i) {
-    if (is_valid(addr + i)) {
-      return true;
-    }
-  }
-  return false;
-}
+vector<uint64_t> Memory::valid_rows() const {
+  vector<uint64_t> res;
 
-size_t Memory::valid_count() const {
-  size_t res = 0;
-  for (uint64_t i = lower_bound(); i - lower_bound() < size(); i += 8) {
-    if (valid_row(i)) {
-      res++;
+  //BEWARE OF OVERFLOWS; don't use upper_bound().
+  for_each_valid_range([this, &res](uint64_t begin, uint64_t end) {
+    // base_ is 32-byte aligned, so rows are 8-byte aligned addresses
+    auto row = begin & ~7ull;
+    if (!res.empty() && res.back() == row) {
+      row += 8;
     }
-  }
+    for (; row - base_ < size() && row - base_ < end - base_; row += 8) {
+      res.push_back(row);
+    }
+  });
+
   return res;
 }
 
@@ -16,8 +16,10 @@
 #define STOKE_SRC_STATE_MEMORY_H
 
 #include <cassert>
+#include <cstring>
 #include <iostream>
 #include <stdint.h>
+#include <vector>
 
 #include "src/ext/cpputil/include/container/bit_vector.h"
 #include "src/ext/cpputil/include/io/fail.h"
@@ -28,6 +30,12 @@ namespace stoke {
 
 class Memory {
 public:
+  /** A maximal run of valid bytes, from begin up to (but not including) end. */
+  struct Range {
+    uint64_t begin;
+    uint64_t end;
+  };
+
   /** Creates an empty memory. */
   Memory() {
     resize(0, 0);
@@ -68,6 +76,23 @@ public:
     assert(valid_.num_fixed_bytes() == rhs.valid_.num_fixed_bytes());
     valid_.copy(rhs.valid_);
   }
+  /** Copy the valid bytes and the valid mask from another memory. Bytes that
+    are invalid in rhs keep their contents, so this matches copy() whenever
+    they already agree (as they do for a memory that code has run on, since
+    code can only write valid bytes). */
+  void copy_valid(const Memory& rhs) {
+    assert(base_ == rhs.base_);
+
+    assert(valid_.num_fixed_bytes() == rhs.valid_.num_fixed_bytes());
+    valid_.copy(rhs.valid_);
+
+    assert(contents_.num_fixed_bytes() == rhs.contents_.num_fixed_bytes());
+    auto dst = (uint8_t*)contents_.data();
+    const auto src = (const uint8_t*)rhs.contents_.data();
+    rhs.for_each_valid_range([dst, src, this](uint64_t begin, uint64_t end) {
+      memcpy(dst + (begin - base_), src + (begin - base_), end - begin);
+    });
+  }
 
   /** Logical memory size; doesn't include headroom. */
   size_t size() const {
@@ -142,6 +167,54 @@ public:
     return addr_iterator(valid_.set_bit_index_end(), base_);
   }
 
+  /** Calls f(begin, end) for each maximal range of valid bytes, in increasing
+    order.  The valid mask is scanned a quad (64 bytes of memory) at a time, so
+    this costs little more than the number of ranges for sparse memories. */
+  template <typename F>
+  void for_each_valid_range(F f) const {
+    const auto bytes = valid_.num_fixed_bytes();
+    bool open = false;
+    uint64_t begin = 0;
+
+    for (size_t i = 0; i < bytes;) {
+      // Skip whole quads that don't start or end a range
+      if (i % 8 == 0 && i + 8 <= bytes) {
+        const auto q = valid_.get_fixed_quad(i / 8);
+        if ((q == 0 && !open) || (q == ~0ull && open)) {
+          i += 8;
+          continue;
+        }
+      }
+      const auto b = valid_.get_fixed_byte(i);
+      if ((b == 0 && !open) || (b == 0xff && open)) {
+        ++i;
+        continue;
+      }
+      for (size_t j = 0; j < 8; ++j) {
+        const auto v = (b >> j) & 1;
+        if (v && !open) {
+          begin = base_ + 8*i + j;
+          open = true;
+        } else if (!v && open) {
+          f(begin, base_ + 8*i + j);
+          open = false;
+        }
+      }
+      ++i;
+    }
+    if (open) {
+      f(begin, base_ + 8*bytes);
+    }
+  }
+  /** Returns the maximal ranges of valid bytes, in increasing order. */
+  std::vector<Range> valid_ranges() const {
+    std::vector<Range> res;
+    for_each_valid_range([&res](uint64_t begin, uint64_t end) {
+      res.push_back({begin, end});
+    });
+    return res;
+  }
+
   /** Bit-wise xor; ignores shadows. */
   Memory& operator^=(const Memory& rhs) {
     contents_ ^= rhs.contents_;
@@ -194,10 +267,8 @@ private:
   /** Read all text rows of memory. */
   void read_text_contents(std::istream& is);
 
-  /** Does this row contain at least one valid address? */
-  bool valid_row(uint64_t addr) const;
-  /** How many of the rows in this memory are valid? */
-  size_t valid_count() const;
+  /** Returns the addresses of the rows that contain at least one valid byte, in increasing order. */
+  std::vector<uint64_t> valid_rows() const;
 };
 
 } // namespace stoke
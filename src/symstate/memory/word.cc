@@ -0,0 +1,113 @@
+// Copyright 2013-2016 Stanford University
+//
+// Licensed under the Apache License, Version 2.0 (the License);
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an AS IS BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "src/symstate/memory/word.h"
+
+using namespace stoke;
+using namespace std;
+
+namespace {
+
+/** Word indices wrap around with addresses; there are 2^61 of them. */
+const uint64_t index_mask = (0x1ull << 61) - 1;
+
+/** The number of words spanned by an access of size bits at any alignment. */
+size_t num_words(uint16_t size) {
+  return (size + 63) / 64 + 1;
+}
+
+/** Is the address a multiple of 8? */
+SymBool is_aligned(SymBitVector address) {
+  return address[2][0] == SymBitVector::constant(3, 0);
+}
+
+} // namespace
+
+/** Updates the memory with a write. */
+SymBool WordMemory::write(SymBitVector address, SymBitVector value, uint16_t size, size_t line_no) {
+
+  // Little Endian
+  // The least significant bit of value (i.e. the lowest bits) go in the lowest addresses
+
+  const auto words = num_words(size);
+  const auto width = 64*words;
+  const auto index = address >> 3;
+  const auto old = window(index, words);
+
+  // Mask the value into the bytes it overwrites
+  const auto shift = lane_shift(address, width);
+  const auto padding = SymBitVector::constant(width - size, 0);
+  const auto mask = (padding || !SymBitVector::constant(size, 0)) << shift;
+  auto merged = (old & !mask) | ((padding || value) << shift);
+
+  // Aligned whole words can be stored as they are
+  if (size % 64 == 0) {
+    merged = is_aligned(address).ite(old[width-1][size] || value, merged);
+  }
+
+  for (size_t i = 0; i < words; ++i) {
+    const auto key = (index + SymBitVector::constant(64, i)) & SymBitVector::constant(64, index_mask);
+    heap_ = heap_.update(key, merged[64*i+63][64*i]);
+  }
+  variable_up_to_date_ = false;
+
+  // Ensure we don't bypass bounds
+  constraints_.push_back(address <= SymBitVector::constant(64, -0x3f - size/8));
+  constraints_.push_back(address >= SymBitVector::constant(64, 0x40));
+
+  add_access(address, size);
+
+  return SymBool::_false();
+}
+
+/** Reads from the memory.  Returns value and segv condition. */
+std::pair<SymBitVector,SymBool> WordMemory::read(SymBitVector address, uint16_t size, size_t line_no) {
+
+  const auto words = num_words(size);
+  const auto width = 64*words;
+  const auto old = window(address >> 3, words);
+
+  SymBitVector value = (old >> lane_shift(address, width))[size-1][0];
+  if (size % 64 == 0) {
+    value = is_aligned(address).ite(old[size-1][0], value);
+  }
+
+  add_access(address, size);
+
+  return pair<SymBitVector,SymBool>(value, SymBool::_false());
+}
+
+/** Create a formula expressing these memory cells with another set. */
+SymBool WordMemory::equality_constraint(WordMemory& other) {
+  return (heap_ == other.heap_);
+}
+
+void WordMemory::add_access(SymBitVector address, uint16_t size) {
+  auto access_var = SymBitVector::tmp_var(64);
+  constraints_.push_back(access_var == address);
+  access_list_[access_var.ptr] = size;
+}
+
+SymBitVector WordMemory::window(SymBitVector index, size_t words) const {
+  SymBitVector value = heap_[index];
+  for (size_t i = 1; i < words; ++i) {
+    const auto key = (index + SymBitVector::constant(64, i)) & SymBitVector::constant(64, index_mask);
+    value = heap_[key] || value;
+  }
+  return value;
+}
+
+SymBitVector WordMemory::lane_shift(SymBitVector address, uint16_t width) {
+  return (SymBitVector::constant(width - 3, 0) || address[2][0]) << 3;
+}
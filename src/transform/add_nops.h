@@ -39,6 +39,10 @@ public:
       originally passed to operator() */
   void undo(Cfg& cfg, const TransformInfo& transform_info) const;
 
+  /** Re-applies a move that operator() performed on an identical Cfg.  Requires
+      the 'TransformInfo' that operator() returned. */
+  void redo(Cfg& cfg, const TransformInfo& transform_info) const;
+
 protected:
 
 
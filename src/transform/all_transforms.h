@@ -22,4 +22,5 @@
 #include "src/transform/opcode_width.h"
 #include "src/transform/operand.h"
 #include "src/transform/rotate.h"
+#include "src/transform/vectorize.h"
 #include "src/transform/weighted.h"
@@ -15,13 +15,15 @@
 #ifndef STOKE_SRC_TRANSFORM_TRANSFORM_INFO_H
 #define STOKE_SRC_TRANSFORM_TRANSFORM_INFO_H
 
+#include <vector>
+
 #include "src/ext/x64asm/include/x64asm.h"
 
 namespace stoke {
 
 struct TransformInfo {
 
-  TransformInfo() : success(false), undo_instr(x64asm::NOP) { }
+  TransformInfo() : success(false), undo_instr(x64asm::NOP), redo_instr(x64asm::NOP) { }
 
   // Did the transform succeed?
   bool success;
@@ -33,6 +35,13 @@ struct TransformInfo {
   size_t undo_index[2];
   x64asm::Instruction undo_instr;
 
+  // Records the code from undo_index[0] on, for moves that rewrite more than
+  // one instruction
+  std::vector<x64asm::Instruction> undo_code;
+
+  // Records the instruction written by the transform, if any, to redo it
+  x64asm::Instruction redo_instr;
+
 };
 
 } // namespace stoke
@@ -68,6 +68,7 @@ TransformInfo InstructionTransform::operator()(Cfg& cfg) {
   // Success: Any failure beyond here will require undoing the move
   // Operands come from the global pool so this rip will need rescaling
   cfg.get_function().replace(ti.undo_index[0], instr, false, true);
+  ti.redo_instr = cfg.get_code()[ti.undo_index[0]];
   cfg.recompute_defs();
   if (!cfg.check_invariants()) {
     undo(cfg, ti);
@@ -91,6 +92,15 @@ void InstructionTransform::undo(Cfg& cfg, const TransformInfo& ti) const {
   assert(cfg.get_function().check_invariants());
 }
 
+void InstructionTransform::redo(Cfg& cfg, const TransformInfo& ti) const {
+  // redo_instr already carries any rip rescaling that operator() applied
+  cfg.get_function().replace(ti.undo_index[0], ti.redo_instr, true);
+  cfg.recompute_defs();
+
+  assert(cfg.invariant_no_undef_reads());
+  assert(cfg.get_function().check_invariants());
+}
+
 
 
 } // namespace stoke
@@ -79,6 +79,14 @@ void LocalSwapTransform::undo(Cfg& cfg, const TransformInfo& ti) const {
 
 }
 
+void LocalSwapTransform::redo(Cfg& cfg, const TransformInfo& ti) const {
+  cfg.get_function().swap(ti.undo_index[0], ti.undo_index[1]);
+  cfg.recompute_defs();
+
+  assert(cfg.invariant_no_undef_reads());
+  assert(cfg.get_function().check_invariants());
+}
+
 
 
 } // namespace stoke
@@ -50,6 +50,7 @@ TransformInfo OpcodeTransform::operator()(Cfg& cfg) {
   // Success: Any failure beyond here will require undoing the move
   // This operand hasn't changed, so the rip only needs local rescaling
   cfg.get_function().replace(ti.undo_index[0], instr, false, false);
+  ti.redo_instr = cfg.get_code()[ti.undo_index[0]];
   cfg.recompute_defs();
   if (!cfg.check_invariants()) {
     undo(cfg, ti);
@@ -74,6 +75,15 @@ void OpcodeTransform::undo(Cfg& cfg, const TransformInfo& ti) const {
 
 }
 
+void OpcodeTransform::redo(Cfg& cfg, const TransformInfo& ti) const {
+  // redo_instr already carries any rip rescaling that operator() applied
+  cfg.get_function().replace(ti.undo_index[0], ti.redo_instr, true);
+  cfg.recompute_defs();
+
+  assert(cfg.invariant_no_undef_reads());
+  assert(cfg.get_function().check_invariants());
+}
+
 
 
 } // namespace stoke
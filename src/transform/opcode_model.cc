@@ -0,0 +1,212 @@
+// Copyright 2013-2016 Stanford University
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cmath>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "src/ext/cpputil/include/io/fail.h"
+
+#include "src/transform/opcode_model.h"
+
+using namespace cpputil;
+using namespace std;
+using namespace x64asm;
+
+namespace {
+
+/** Looks up an opcode by its textual name; returns true on success. */
+bool read_opcode(const string& s, Opcode& o) {
+  static map<string, Opcode> names;
+  if (names.empty()) {
+    for (size_t i = 0; i < X64ASM_NUM_OPCODES; ++i) {
+      ostringstream oss;
+      oss << (Opcode)i;
+      names[oss.str()] = (Opcode)i;
+    }
+  }
+
+  const auto itr = names.find(s);
+  if (itr == names.end()) {
+    return false;
+  }
+  o = itr->second;
+  return true;
+}
+
+/** Returns the sum of all counts in a table. */
+size_t total(const map<Opcode, size_t>& counts) {
+  size_t res = 0;
+  for (const auto& c : counts) {
+    res += c.second;
+  }
+  return res;
+}
+
+/** Adds the normalized frequencies in counts to score, scaled by k. */
+void accumulate(const map<Opcode, size_t>& counts, double k, map<Opcode, double>& score) {
+  const auto t = total(counts);
+  if (t == 0) {
+    return;
+  }
+  for (const auto& c : counts) {
+    score[c.first] += k * c.second / t;
+  }
+}
+
+} // namespace
+
+namespace stoke {
+
+bool OpcodeModel::is_modeled(Opcode o) {
+  const Instruction instr(o);
+  return !instr.is_label_defn() && !instr.is_any_return() && !instr.is_nop();
+}
+
+OpcodeModel& OpcodeModel::add_pair(const Code& target, const Code& rewrite) {
+  set<Opcode> target_ops;
+  for (const auto& instr : target) {
+    if (is_modeled(instr.get_opcode())) {
+      target_ops.insert(instr.get_opcode());
+    }
+  }
+
+  for (const auto& instr : rewrite) {
+    const auto op = instr.get_opcode();
+    if (!is_modeled(op)) {
+      continue;
+    }
+
+    unigrams_[op]++;
+    for (auto t : target_ops) {
+      cooccurrences_[t][op]++;
+    }
+  }
+
+  num_pairs_++;
+  return *this;
+}
+
+map<Opcode, size_t> OpcodeModel::get_weights(const Code& target, size_t max_weight) const {
+  map<Opcode, size_t> res;
+  if (empty() || max_weight <= 1) {
+    return res;
+  }
+
+  set<Opcode> target_ops;
+  for (const auto& instr : target) {
+    if (is_modeled(instr.get_opcode())) {
+      target_ops.insert(instr.get_opcode());
+    }
+  }
+
+  // Unconditional frequencies always contribute.  Conditional frequencies are
+  // averaged over the target opcodes that the model knows something about.
+  map<Opcode, double> score;
+  accumulate(unigrams_, 1.0, score);
+
+  vector<const Counts*> cooc;
+  for (auto t : target_ops) {
+    const auto c = cooccurrences_.find(t);
+    if (c != cooccurrences_.end()) {
+      cooc.push_back(&c->second);
+    }
+  }
+  for (const auto c : cooc) {
+    accumulate(*c, 1.0 / cooc.size(), score);
+  }
+
+  double max_score = 0;
+  for (const auto& s : score) {
+    max_score = max(max_score, s.second);
+  }
+  if (max_score == 0) {
+    return res;
+  }
+
+  for (const auto& s : score) {
+    res[s.first] = 1 + (size_t)round((max_weight - 1) * s.second / max_score);
+  }
+  return res;
+}
+
+istream& OpcodeModel::read_text(istream& is) {
+  num_pairs_ = 0;
+  unigrams_.clear();
+  cooccurrences_.clear();
+
+  size_t line_no = 0;
+  for (string line; getline(is, line);) {
+    line_no++;
+    istringstream iss(line);
+
+    string kind;
+    if (!(iss >> kind) || kind[0] == '#') {
+      continue;
+    }
+
+    if (kind == "pairs") {
+      if (!(iss >> num_pairs_)) {
+        fail(is) << "Line " << line_no << ": expected a number of pairs" << endl;
+        return is;
+      }
+      continue;
+    }
+
+    string s1, s2;
+    auto o1 = LABEL_DEFN;
+    auto o2 = LABEL_DEFN;
+    size_t count = 0;
+
+    if (kind == "u") {
+      if (!(iss >> s1 >> count) || !read_opcode(s1, o1)) {
+        fail(is) << "Line " << line_no << ": expected \"u <opcode> <count>\"" << endl;
+        return is;
+      }
+      unigrams_[o1] += count;
+    } else if (kind == "c") {
+      if (!(iss >> s1 >> s2 >> count) || !read_opcode(s1, o1) || !read_opcode(s2, o2)) {
+        fail(is) << "Line " << line_no << ": expected \"c <opcode> <opcode> <count>\"" << endl;
+        return is;
+      }
+      cooccurrences_[o1][o2] += count;
+    } else {
+      fail(is) << "Line " << line_no << ": unrecognized record \"" << kind << "\"" << endl;
+      return is;
+    }
+  }
+  if (is.eof()) {
+    is.clear(ios::eofbit);
+  }
+
+  return is;
+}
+
+ostream& OpcodeModel::write_text(ostream& os) const {
+  os << "# STOKE opcode model" << endl;
+  os << "pairs " << num_pairs_ << endl;
+  for (const auto& u : unigrams_) {
+    os << "u " << u.first << " " << u.second << endl;
+  }
+  for (const auto& c : cooccurrences_) {
+    for (const auto& e : c.second) {
+      os << "c " << c.first << " " << e.first << " " << e.second << endl;
+    }
+  }
+  return os;
+}
+
+} // namespace stoke
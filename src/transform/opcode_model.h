@@ -0,0 +1,85 @@
+// Copyright 2013-2016 Stanford University
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef STOKE_SRC_TRANSFORM_OPCODE_MODEL_H
+#define STOKE_SRC_TRANSFORM_OPCODE_MODEL_H
+
+#include <iostream>
+#include <map>
+
+#include "src/ext/x64asm/include/x64asm.h"
+
+namespace stoke {
+
+/** Opcode statistics learned from a corpus of target/rewrite pairs.  The model
+  records how often an opcode appears in a rewrite, and how often it appears in
+  a rewrite whose target uses some other opcode.  Given a new target, these
+  counts are turned into proposal weights for TransformPools. */
+class OpcodeModel {
+public:
+  /** Creates an empty model. */
+  OpcodeModel() : num_pairs_(0) { }
+
+  /** Adds one target/rewrite pair to the model. */
+  OpcodeModel& add_pair(const x64asm::Code& target, const x64asm::Code& rewrite);
+
+  /** Returns the number of target/rewrite pairs in the model. */
+  size_t num_pairs() const {
+    return num_pairs_;
+  }
+  /** Returns true if no pairs have been added to the model. */
+  bool empty() const {
+    return num_pairs_ == 0;
+  }
+
+  /** Computes weights in [1, max_weight] for every opcode that the model has
+    seen, conditioned on the opcodes that appear in the target.  Opcodes
+    missing from the result should keep their default weight. */
+  std::map<x64asm::Opcode, size_t> get_weights(const x64asm::Code& target, size_t max_weight) const;
+
+  /** Read from istream. */
+  std::istream& read_text(std::istream& is);
+  /** Write to ostream. */
+  std::ostream& write_text(std::ostream& os) const;
+
+private:
+  /** Sparse table of counts. */
+  typedef std::map<x64asm::Opcode, size_t> Counts;
+
+  /** Number of target/rewrite pairs seen so far. */
+  size_t num_pairs_;
+  /** Number of times each opcode appears in a rewrite. */
+  Counts unigrams_;
+  /** Number of times each opcode appears in a rewrite, keyed by target opcodes. */
+  std::map<x64asm::Opcode, Counts> cooccurrences_;
+
+  /** Is this opcode interesting to the model?  (labels and returns are not) */
+  static bool is_modeled(x64asm::Opcode o);
+};
+
+} // namespace stoke
+
+namespace std {
+
+inline istream& operator>>(istream& is, stoke::OpcodeModel& m) {
+  return m.read_text(is);
+}
+
+inline ostream& operator<<(ostream& os, const stoke::OpcodeModel& m) {
+  return m.write_text(os);
+}
+
+} // namespace std
+
+#endif
@@ -73,6 +73,7 @@ TransformInfo OperandTransform::operator()(Cfg& cfg) {
 
   // Success: Any failure beyond here will require undoing the move
   cfg.get_function().replace(ti.undo_index[0], instr, false, is_rip);
+  ti.redo_instr = cfg.get_code()[ti.undo_index[0]];
   cfg.recompute_defs();
   if (!cfg.check_invariants()) {
     undo(cfg, ti);
@@ -97,6 +98,15 @@ void OperandTransform::undo(Cfg& cfg, const TransformInfo& ti) const {
 
 }
 
+void OperandTransform::redo(Cfg& cfg, const TransformInfo& ti) const {
+  // redo_instr already carries any rip rescaling that operator() applied
+  cfg.get_function().replace(ti.undo_index[0], ti.redo_instr, true);
+  cfg.recompute_defs();
+
+  assert(cfg.invariant_no_undef_reads());
+  assert(cfg.get_function().check_invariants());
+}
+
 
 
 } // namespace stoke
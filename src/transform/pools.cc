@@ -149,6 +149,28 @@ bool get(default_random_engine& gen, const vector<T>& pool, const RegSet& rs, Op
   return true;
 }
 
+/** Appends every element of a pool (in rs, if filter is set) to ops. Returns true if any were. */
+template <typename T>
+bool get_all(const vector<T>& pool, const RegSet& rs, bool filter, vector<Operand>& ops) {
+  const auto size = ops.size();
+  for (const auto& t : pool) {
+    if (!filter || rs.contains(t)) {
+      ops.push_back(t);
+    }
+  }
+  return ops.size() > size;
+}
+
+/** Appends a fixed register to ops if it's defined (for reads) or in the pool (for writes). */
+template <typename T>
+bool get_fixed(const vector<T>& pool, const T& val, const RegSet& rs, bool read, vector<Operand>& ops) {
+  if (read ? !rs.contains(val) : find(pool.begin(), pool.end(), val) == pool.end()) {
+    return false;
+  }
+  ops.push_back(val);
+  return true;
+}
+
 /** Replaces base register using an element of a reg set. Returns true on success. */
 template <class T>
 bool get_base(default_random_engine& gen, const vector<R32> r32_pool, const vector<R64>& r64_pool, const RegSet& rs, M<T>& m) {
@@ -216,6 +238,7 @@ TransformPools::TransformPools() {
   for (size_t i = 0; i < X64ASM_NUM_OPCODES; ++i) {
     opcode_weights_[i] = 0;
     opcode_weights_locked_[i] = false;
+    opcode_bias_[i] = 1;
   }
 
   init_reg_pools();
@@ -330,7 +353,7 @@ void TransformPools::recompute_pools() {
       }
     }
 
-    opcode_weights_[i] = 1;
+    opcode_weights_[i] = opcode_bias_[i];
   }
 
 
@@ -704,4 +727,117 @@ bool TransformPools::get_read_op(Opcode o, size_t idx, const RegSet& rs, Operand
   }
 }
 
+vector<Opcode> TransformPools::get_opcodes() const {
+  vector<Opcode> res;
+  vector<bool> seen(X64ASM_NUM_OPCODES, false);
+  for (auto o : opcode_pool_) {
+    if (!seen[(int)o]) {
+      seen[(int)o] = true;
+      res.push_back(o);
+    }
+  }
+  return res;
+}
+
+bool TransformPools::get_all_ops(Opcode o, size_t idx, const RegSet& rs, bool read, vector<Operand>& ops) const {
+  ops.clear();
+
+  // Immediates are truncated to the operand's width; keep distinct values only
+  uint64_t imm_mask = 0;
+  switch (type(o, idx)) {
+  case Type::IMM_8:
+    imm_mask = 0xff;
+    break;
+  case Type::IMM_16:
+    imm_mask = 0xffff;
+    break;
+  case Type::IMM_32:
+    imm_mask = 0xffffffff;
+    break;
+  case Type::IMM_64:
+    imm_mask = -1;
+    break;
+  default:
+    break;
+  }
+  if (imm_mask) {
+    vector<uint64_t> vals;
+    for (const auto& i : imm_pool_) {
+      const auto val = (uint64_t)i & imm_mask;
+      if (find(vals.begin(), vals.end(), val) != vals.end()) {
+        continue;
+      }
+      vals.push_back(val);
+      switch (type(o, idx)) {
+      case Type::IMM_8:
+        ops.push_back(Imm8(val));
+        break;
+      case Type::IMM_16:
+        ops.push_back(Imm16(val));
+        break;
+      case Type::IMM_32:
+        ops.push_back(Imm32(val));
+        break;
+      default:
+        ops.push_back(Imm64(val));
+        break;
+      }
+    }
+    return !ops.empty();
+  }
+
+  switch (type(o, idx)) {
+  case Type::ZERO:
+    ops.push_back(zero);
+    return true;
+  case Type::ONE:
+    ops.push_back(one);
+    return true;
+  case Type::THREE:
+    ops.push_back(three);
+    return true;
+  case Type::PREF_66:
+    ops.push_back(pref_66);
+    return true;
+  case Type::PREF_REX_W:
+    ops.push_back(pref_rex_w);
+    return true;
+  case Type::FAR:
+    ops.push_back(far);
+    return true;
+
+  case Type::RH:
+    return get_all<Rh>(rh_pool_, rs, read, ops);
+  case Type::R_8:
+    return get_all<R8>(r8_pool_, rs, read, ops);
+  case Type::AL:
+    return get_fixed<R8>(r8_pool_, al, rs, read, ops);
+  case Type::CL:
+    return get_fixed<R8>(r8_pool_, cl, rs, read, ops);
+  case Type::R_16:
+    return get_all<R16>(r16_pool_, rs, read, ops);
+  case Type::AX:
+    return get_fixed<R16>(r16_pool_, ax, rs, read, ops);
+  case Type::DX:
+    return get_fixed<R16>(r16_pool_, dx, rs, read, ops);
+  case Type::R_32:
+    return get_all<R32>(r32_pool_, rs, read, ops);
+  case Type::EAX:
+    return get_fixed<R32>(r32_pool_, eax, rs, read, ops);
+  case Type::R_64:
+    return get_all<R64>(r64_pool_, rs, read, ops);
+  case Type::RAX:
+    return get_fixed<R64>(r64_pool_, rax, rs, read, ops);
+  case Type::XMM:
+    return get_all<Xmm>(xmm_pool_, rs, read, ops);
+  case Type::XMM_0:
+    return get_fixed<Xmm>(xmm_pool_, xmm0, rs, read, ops);
+  case Type::YMM:
+    return get_all<Ymm>(ymm_pool_, rs, read, ops);
+
+  default:
+    return false;
+  }
+}
+
 } // namespace stoke
@@ -68,6 +68,12 @@ public:
     opcode_weights_locked_[(int)op] = true;
     return *this;
   }
+  /** Set the weight an opcode receives if it survives all other filters.
+    Unlike set_opcode_weight, this never forces an opcode into the pool. */
+  TransformPools& set_opcode_bias(const x64asm::Opcode& op, size_t n) {
+    opcode_bias_[(int)op] = n;
+    return *this;
+  }
 
   /** Sets a validator for checking opcode support. */
   TransformPools& set_validator(const stoke::Validator* validator) {
@@ -177,6 +183,25 @@ public:
                    x64asm::Operand& op);
 
 
+  /** Returns true if an opcode survived the filters and may be proposed. */
+  bool has_opcode(x64asm::Opcode o) const {
+    return opcode_weights_[(int)o] > 0;
+  }
+  /** Returns the xmm registers that moves may write. */
+  const std::vector<x64asm::Xmm>& get_xmm_pool() const {
+    return xmm_pool_;
+  }
+
+  /** Returns each opcode in the pool once, in the order they first appear. */
+  std::vector<x64asm::Opcode> get_opcodes() const;
+
+  /** Sets ops to every operand that get_read_op (if read is true) or
+    get_write_op could choose, except that only register, immediate and
+    constant operands are listed.  Returns false if the operand takes any other
+    kind, or if there are no choices. */
+  bool get_all_ops(x64asm::Opcode o, size_t idx, const x64asm::RegSet& rs, bool read,
+                   std::vector<x64asm::Operand>& ops) const;
+
   /** Get rid of mm pool. */
   TransformPools& clear_mm_pool() {
     mm_pool_.clear();
@@ -218,6 +243,8 @@ protected:
   std::array<size_t, X64ASM_NUM_OPCODES> opcode_weights_;
   /** Whether the weights have been specified by the user (thus locking them). */
   std::array<size_t, X64ASM_NUM_OPCODES> opcode_weights_locked_;
+  /** The weight given to unlocked opcodes that pass all filters (usually 1). */
+  std::array<size_t, X64ASM_NUM_OPCODES> opcode_bias_;
   /** The pool of opcodes. */
   std::vector<x64asm::Opcode> opcode_pool_;
   /** Pool with same raw memonic. */
@@ -38,6 +38,10 @@ public:
       originally passed to operator() */
   virtual void undo(Cfg& cfg, const TransformInfo& transform_info) const = 0;
 
+  /** Re-applies a move that operator() performed on an identical Cfg.  Requires
+      the 'TransformInfo' that operator() returned.  Used to replay recorded searches. */
+  virtual void redo(Cfg& cfg, const TransformInfo& transform_info) const = 0;
+
   /** Set a seed for the random number generator. */
   virtual void set_seed(std::default_random_engine::result_type seed) {
     gen_.seed(seed);
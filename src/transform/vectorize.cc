@@ -0,0 +1,283 @@
+// Copyright 2013-2016 Stanford University
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+
+#include "src/transform/vectorize.h"
+
+using namespace std;
+using namespace stoke;
+using namespace x64asm;
+
+namespace {
+
+/** A scalar instruction that can be packed, and what it packs into. */
+struct Lane {
+  Opcode scalar;
+  /** The number of bytes each instruction writes. */
+  size_t width;
+  /** The packed operation for read-modify-writes, or NOP for stores. */
+  Opcode packed;
+  /** Does the instruction store an immediate (which must be zero)? */
+  bool imm;
+};
+
+const vector<Lane> lanes_table = {
+  {MOV_M32_R32, 4, NOP, false},
+  {MOV_M64_R64, 8, NOP, false},
+  {MOV_M32_IMM32, 4, NOP, true},
+  {MOV_M64_IMM32, 8, NOP, true},
+  {ADD_M32_R32, 4, PADDD_XMM_XMM, false},
+  {ADD_M64_R64, 8, PADDQ_XMM_XMM, false},
+  {SUB_M32_R32, 4, PSUBD_XMM_XMM, false},
+  {SUB_M64_R64, 8, PSUBQ_XMM_XMM, false},
+  {AND_M32_R32, 4, PAND_XMM_XMM, false},
+  {AND_M64_R64, 8, PAND_XMM_XMM, false},
+  {OR_M32_R32, 4, POR_XMM_XMM, false},
+  {OR_M64_R64, 8, POR_XMM_XMM, false},
+  {XOR_M32_R32, 4, PXOR_XMM_XMM, false},
+  {XOR_M64_R64, 8, PXOR_XMM_XMM, false}
+};
+
+const Lane* find_lane(Opcode o) {
+  for (const auto& l : lanes_table) {
+    if (l.scalar == o) {
+      return &l;
+    }
+  }
+  return nullptr;
+}
+
+/** Is b the same instruction as a, up to the displacement of its memory operand? */
+bool same_but_disp(const Lane& lane, const Instruction& a, const Instruction& b) {
+  if (b.get_opcode() != a.get_opcode()) {
+    return false;
+  }
+  if (lane.imm) {
+    if ((int32_t)b.get_operand<Imm32>(1) != 0) {
+      return false;
+    }
+  } else if (!(b.get_operand<R64>(1) == a.get_operand<R64>(1))) {
+    return false;
+  }
+  auto m = b.get_operand<M8>(0);
+  m.set_disp(a.get_operand<M8>(0).get_disp());
+  return m == a.get_operand<M8>(0);
+}
+
+/** Finds a group of scalar instructions that starts at an index and tiles a
+  16-byte block, looking at nothing but the code.  On success, lanes holds the
+  indices of its instructions and disps their sorted displacements. */
+const Lane* find_group(const Code& fxn, size_t index, vector<size_t>& lanes, vector<int64_t>& disps) {
+  if (index >= fxn.size()) {
+    return nullptr;
+  }
+  const auto& first = fxn[index];
+  const auto lane = find_lane(first.get_opcode());
+  if (lane == nullptr) {
+    return nullptr;
+  }
+  if (lane->imm && (int32_t)first.get_operand<Imm32>(1) != 0) {
+    return nullptr;
+  }
+  if (first.get_operand<M8>(0).rip_offset()) {
+    return nullptr;
+  }
+
+  // Collect one instruction per lane, skipping nops
+  const auto count = 16 / lane->width;
+  lanes.clear();
+  lanes.push_back(index);
+  for (size_t i = index + 1, ie = fxn.size(); i < ie && lanes.size() < count; ++i) {
+    if (fxn[i].is_nop()) {
+      continue;
+    }
+    if (!same_but_disp(*lane, first, fxn[i])) {
+      return nullptr;
+    }
+    lanes.push_back(i);
+  }
+  if (lanes.size() < count) {
+    return nullptr;
+  }
+
+  // The lanes must tile a 16-byte block exactly
+  disps.clear();
+  for (auto i : lanes) {
+    disps.push_back((int32_t)fxn[i].get_operand<M8>(0).get_disp());
+  }
+  sort(disps.begin(), disps.end());
+  for (size_t i = 0; i < count; ++i) {
+    if (disps[i] != disps[0] + (int64_t)(i * lane->width)) {
+      return nullptr;
+    }
+  }
+  return lane;
+}
+
+} // namespace
+
+namespace stoke {
+
+TransformInfo VectorizeTransform::operator()(Cfg& cfg) {
+
+  TransformInfo ti;
+  ti.success = false;
+
+  if (cfg.get_code().size() < 3)
+    return ti;
+
+  ti.undo_index[0] = (gen_() % (cfg.get_code().size() - 1)) + 1;
+
+  // Nearly every attempt fails on the code alone, so check that first
+  vector<size_t> lanes;
+  vector<int64_t> disps;
+  if (find_group(cfg.get_code(), ti.undo_index[0], lanes, disps) == nullptr) {
+    return ti;
+  }
+
+  // Moves that only edit operands just recompute defs; scratch registers must
+  // be picked from up-to-date liveness
+  cfg.recompute_liveness();
+
+  vector<Instruction> code;
+  if (!plan(cfg, ti.undo_index[0], lanes, code)) {
+    return ti;
+  }
+  ti.undo_index[1] = code.size();
+  ti.undo_code.assign(cfg.get_code().begin() + ti.undo_index[0], cfg.get_code().end());
+
+  rewrite(cfg, lanes, code);
+  cfg.recompute();
+  if (!cfg.check_invariants()) {
+    undo(cfg, ti);
+    return ti;
+  }
+
+  assert(cfg.invariant_no_undef_reads());
+  assert(cfg.get_function().check_invariants());
+
+  ti.success = true;
+  return ti;
+}
+
+void VectorizeTransform::undo(Cfg& cfg, const TransformInfo& ti) const {
+  // Removing and appending at the end leaves the rip offsets of the restored
+  // code exactly as they were
+  auto& function = cfg.get_function();
+  while (function.get_code().size() > ti.undo_index[0]) {
+    function.remove(function.get_code().size() - 1);
+  }
+  for (const auto& instr : ti.undo_code) {
+    function.push_back(instr);
+  }
+  cfg.recompute();
+
+  assert(cfg.invariant_no_undef_reads());
+  assert(cfg.get_function().check_invariants());
+}
+
+void VectorizeTransform::redo(Cfg& cfg, const TransformInfo& ti) const {
+  cfg.recompute_liveness();
+
+  vector<size_t> lanes;
+  vector<Instruction> code;
+  const auto ok = plan(cfg, ti.undo_index[0], lanes, code);
+  assert(ok);
+  (void)ok;
+
+  rewrite(cfg, lanes, code);
+  cfg.recompute();
+
+  assert(cfg.invariant_no_undef_reads());
+  assert(cfg.get_function().check_invariants());
+}
+
+bool VectorizeTransform::plan(const Cfg& cfg, size_t index, vector<size_t>& lanes,
+                              vector<Instruction>& code) const {
+  const auto& fxn = cfg.get_code();
+  vector<int64_t> disps;
+  const auto lane = find_group(fxn, index, lanes, disps);
+  if (lane == nullptr || !cfg.is_reachable(cfg.get_loc(index).first)) {
+    return false;
+  }
+  const auto& first = fxn[index];
+  const auto mem = first.get_operand<M8>(0);
+
+  // The packed code leaves flags alone, so none the group writes may be live
+  const auto live = cfg.live_outs(cfg.get_loc(lanes.back()));
+  if (live.intersects(first.maybe_write_set())) {
+    return false;
+  }
+
+  // Scratch registers come from the dead xmms the pool allows us to write.
+  // Zeroing reads its register, so that one must also be defined.
+  const auto defs = cfg.def_ins(cfg.get_loc(index));
+  vector<Xmm> scratch;
+  for (const auto& x : pools_.get_xmm_pool()) {
+    if (live.contains(x) || find(scratch.begin(), scratch.end(), x) != scratch.end()) {
+      continue;
+    }
+    if (lane->imm && !defs.contains(x)) {
+      continue;
+    }
+    scratch.push_back(x);
+  }
+  const size_t needed = lane->packed == NOP ? 1 : 2;
+  if (scratch.size() < needed) {
+    return false;
+  }
+  const auto a = scratch[0];
+
+  auto block = mem;
+  block.set_disp(Imm32((int32_t)disps[0]));
+
+  code.clear();
+  if (lane->imm) {
+    code.push_back(Instruction(PXOR_XMM_XMM, {a, a}));
+  } else if (lane->width == 4) {
+    code.push_back(Instruction(MOVD_XMM_R32, {a, first.get_operand<R32>(1)}));
+    code.push_back(Instruction(PSHUFD_XMM_XMM_IMM8, {a, a, Imm8(0)}));
+  } else {
+    code.push_back(Instruction(MOVQ_XMM_R64, {a, first.get_operand<R64>(1)}));
+    code.push_back(Instruction(PUNPCKLQDQ_XMM_XMM, {a, a}));
+  }
+  if (lane->packed == NOP) {
+    code.push_back(Instruction(MOVDQU_M128_XMM, {block, a}));
+  } else {
+    const auto b = scratch[1];
+    code.push_back(Instruction(MOVDQU_XMM_M128, {b, block}));
+    code.push_back(Instruction(lane->packed, {b, a}));
+    code.push_back(Instruction(MOVDQU_M128_XMM, {block, b}));
+  }
+
+  for (const auto& instr : code) {
+    if (!pools_.has_opcode(instr.get_opcode()) || !instr.check()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void VectorizeTransform::rewrite(Cfg& cfg, const vector<size_t>& lanes, const vector<Instruction>& code) {
+  auto& function = cfg.get_function();
+  for (size_t i = lanes.size(); i > 0; --i) {
+    function.remove(lanes[i-1]);
+  }
+  for (size_t i = 0; i < code.size(); ++i) {
+    function.insert(lanes[0] + i, code[i], false);
+  }
+}
+
+} // namespace stoke
@@ -0,0 +1,73 @@
+// Copyright 2013-2016 Stanford University
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef STOKE_SRC_TRANSFORM_VECTORIZE_H
+#define STOKE_SRC_TRANSFORM_VECTORIZE_H
+
+#include <vector>
+
+#include "src/transform/pools.h"
+#include "src/transform/transform.h"
+
+namespace stoke {
+
+/** Replaces a group of scalar instructions that do the same thing to adjacent
+  lanes of one 16-byte block of memory with the packed SSE2 equivalent.  A
+  group is a run of identical stores of a register or of zero, or of identical
+  read-modify-write adds, subtracts, ands, ors or xors by a register, whose
+  memory operands differ only in displacement and together cover the block;
+  only nops may come between them.  The value is broadcast into a dead xmm
+  register with movd/movq and pshufd/punpcklqdq, and the block is read and
+  written with movdqu.  Groups that leave a flag the scalar code writes live
+  are left alone, so every move preserves the rewrite's behavior.  The move
+  is only proposed if every opcode it needs is in the pool, which keeps it to
+  opcodes the validator supports when the pool was built to respect that. */
+class VectorizeTransform : public Transform {
+
+public:
+
+  std::string get_name() const {
+    return "Vectorize";
+  }
+
+  VectorizeTransform(TransformPools& pools) : Transform(pools) { }
+
+  /** Attempt to transform the Cfg.  The 'TransformInfo'
+    will return success/failure, and also metadata to undo
+    the transformation if needed.  */
+  TransformInfo operator()(Cfg& cfg);
+
+  /** Undos a move performed on the Cfg.  Requires the 'TransformInfo'
+      originally passed to operator() */
+  void undo(Cfg& cfg, const TransformInfo& transform_info) const;
+
+  /** Re-applies a move that operator() performed on an identical Cfg.  Requires
+      the 'TransformInfo' that operator() returned. */
+  void redo(Cfg& cfg, const TransformInfo& transform_info) const;
+
+private:
+
+  /** Finds the group that starts at an index.  On success, lanes holds the
+    indices of its instructions and code the instructions that replace them. */
+  bool plan(const Cfg& cfg, size_t index, std::vector<size_t>& lanes,
+            std::vector<x64asm::Instruction>& code) const;
+  /** Replaces the instructions of a group with their packed form. */
+  static void rewrite(Cfg& cfg, const std::vector<size_t>& lanes,
+                      const std::vector<x64asm::Instruction>& code);
+
+};
+
+} // namespace stoke
+
+#endif
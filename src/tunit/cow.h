@@ -0,0 +1,118 @@
+// Copyright 2013-2016 Stanford University
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef STOKE_SRC_TUNIT_COW_H
+#define STOKE_SRC_TUNIT_COW_H
+
+#include <memory>
+
+namespace stoke {
+
+/** A copy-on-write handle. Copies share the same value until one of them asks for
+  write access, at which point it takes a private copy if the value is shared.
+  References obtained from get() remain valid (and unchanged) across a write() on
+  another handle, but not across a write() on this one. */
+template <typename T>
+class Cow {
+public:
+  /** Creates a handle to a default constructed value. */
+  Cow() : val_(std::make_shared<T>()) { }
+  /** Creates a handle to a copy of a value. */
+  Cow(const T& t) : val_(std::make_shared<T>(t)) { }
+
+  /** Copies share the value; moves are copies so that no handle is ever left empty. */
+  Cow(const Cow& rhs) = default;
+  /** Copies share the value; moves are copies so that no handle is ever left empty. */
+  Cow& operator=(const Cow& rhs) = default;
+
+  /** Replaces the value held by this handle. */
+  Cow& operator=(const T& t) {
+    if (val_.use_count() == 1) {
+      *val_ = t;
+    } else {
+      val_ = std::make_shared<T>(t);
+    }
+    return *this;
+  }
+
+  /** Returns read-only access to the value. */
+  const T& get() const {
+    return *val_;
+  }
+  /** Returns read-only access to the value. */
+  const T& operator*() const {
+    return *val_;
+  }
+  /** Returns read-only access to the value. */
+  const T* operator->() const {
+    return val_.get();
+  }
+
+  /** Returns write access to the value; takes a private copy first if it is shared. */
+  T& write() {
+    if (val_.use_count() > 1) {
+      val_ = std::make_shared<T>(*val_);
+    }
+    return *val_;
+  }
+
+  /** Returns write access to a value that is about to be rebuilt from scratch.
+    A shared value is replaced by a default constructed one rather than copied;
+    an unshared one is reused as is, capacity included. */
+  T& reset() {
+    if (val_.use_count() > 1) {
+      val_ = std::make_shared<T>();
+    }
+    return *val_;
+  }
+
+  /** Returns true if this handle shares its value with another. */
+  bool is_shared() const {
+    return val_.use_count() > 1;
+  }
+
+  /** Read-only forwarding for container values. */
+  template <typename I>
+  decltype(auto) operator[](const I& i) const {
+    return get()[i];
+  }
+  /** Read-only forwarding for container values. */
+  decltype(auto) size() const {
+    return get().size();
+  }
+  /** Read-only forwarding for container values. */
+  decltype(auto) empty() const {
+    return get().empty();
+  }
+  /** Read-only forwarding for container values. */
+  decltype(auto) begin() const {
+    return get().begin();
+  }
+  /** Read-only forwarding for container values. */
+  decltype(auto) end() const {
+    return get().end();
+  }
+  /** Read-only forwarding for container values. */
+  decltype(auto) back() const {
+    return get().back();
+  }
+
+private:
+  /** The (possibly shared) value. */
+  std::shared_ptr<T> val_;
+};
+
+} // namespace stoke
+
+#endif
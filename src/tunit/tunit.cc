@@ -45,7 +45,8 @@ namespace stoke {
 TUnit::TUnit(const Code& code, uint64_t fo, uint64_t ro, size_t c) {
   code_ = code;
   if (!invariant_first_instr_is_label()) {
-    code_.insert(code_.begin(), {LABEL_DEFN, {Label(".anonymous_function")}});
+    auto& code = code_.write();
+    code.insert(code.begin(), {LABEL_DEFN, {Label(".anonymous_function")}});
   }
 
   file_offset_ = fo;
@@ -111,7 +112,7 @@ bool TUnit::invariant_rip_offsets() const {
     }
     const auto after_instr = rip_offset_ + hex_offset(i) + hex_size(i);
     const auto target = after_instr + op.get_disp();
-    if (rip_offset_targets_.find(target) == rip_offset_targets_.end()) {
+    if (rip_offset_targets_->find(target) == rip_offset_targets_.end()) {
       return false;
     }
   }
@@ -144,22 +145,26 @@ bool TUnit::invariant_hex_offsets() const {
 void TUnit::remove(size_t index) {
   assert(index < code_.size());
 
+  auto& code = code_.write();
+  auto& offsets = hex_offsets_.write();
+  auto& sizes = hex_sizes_.write();
+
   // Some constants
   const int64_t offset_delta = 0 - hex_size(index);
 
   // Update offset and size tables
-  for (size_t i = index, ie = hex_sizes_.size()-1; i < ie; ++i) {
-    hex_offsets_[i] = hex_offsets_[i+1] + offset_delta;
-    hex_sizes_[i] = hex_sizes_[i+1];
+  for (size_t i = index, ie = sizes.size()-1; i < ie; ++i) {
+    offsets[i] = offsets[i+1] + offset_delta;
+    sizes[i] = sizes[i+1];
   }
-  hex_offsets_.resize(hex_offsets_.size()-1);
-  hex_sizes_.resize(hex_sizes_.size()-1);
+  offsets.resize(offsets.size()-1);
+  sizes.resize(sizes.size()-1);
 
   // Delete this instruction
-  code_.erase(code_.begin() + index);
+  code.erase(code.begin() + index);
 
   // Rescale any rips
-  for (size_t i = index, ie = code_.size(); i < ie; ++i) {
+  for (size_t i = index, ie = code.size(); i < ie; ++i) {
     if (is_rip(i)) {
       adjust_rip(i, -offset_delta);
     }
@@ -169,23 +174,27 @@ void TUnit::remove(size_t index) {
 void TUnit::insert(size_t index, const x64asm::Instruction& instr, bool rescale_rip) {
   assert(index <= code_.size());
 
+  auto& code = code_.write();
+  auto& offsets = hex_offsets_.write();
+  auto& sizes = hex_sizes_.write();
+
   // Some constants
   Assembler assm;
   const auto size = assm.hex_size(instr);
   const int64_t offset_delta = size;
 
   // Always update offset and size tables (they need to grow)
-  hex_offsets_.resize(hex_offsets_.size()+1);
-  hex_sizes_.resize(hex_sizes_.size()+1);
-  for (int i = hex_offsets_.size()-1, ie = index; i > ie; --i) {
-    hex_offsets_[i] = hex_offsets_[i-1] + offset_delta;
-    hex_sizes_[i] = hex_sizes_[i-1];
+  offsets.resize(offsets.size()+1);
+  sizes.resize(sizes.size()+1);
+  for (int i = offsets.size()-1, ie = index; i > ie; --i) {
+    offsets[i] = offsets[i-1] + offset_delta;
+    sizes[i] = sizes[i-1];
   }
-  hex_offsets_[index] = index == 0 ? 0 : hex_offsets_[index-1] + hex_sizes_[index-1];
-  hex_sizes_[index] = size;
+  offsets[index] = index == 0 ? 0 : offsets[index-1] + sizes[index-1];
+  sizes[index] = size;
 
   // Insert this instruction
-  code_.insert(code_.begin() + index, instr);
+  code.insert(code.begin() + index, instr);
 
   // If rescale rip is true, we have to adjust a global rip offset
   // Otherwise we'll just use the rip offsets in this instruction as they are given
@@ -195,7 +204,7 @@ void TUnit::insert(size_t index, const x64asm::Instruction& instr, bool rescale_
 
   // If this instruction has non-zero size, adjust everything that follows
   if (offset_delta != 0) {
-    for (size_t i = index+1, ie = code_.size(); i < ie; ++i) {
+    for (size_t i = index+1, ie = code.size(); i < ie; ++i) {
       if (is_rip(i)) {
         adjust_rip(i, -offset_delta);
       }
@@ -207,6 +216,10 @@ void TUnit::replace(size_t index, const x64asm::Instruction& instr, bool skip_fi
   assert(!(skip_first && rescale_rip));
   assert(index < code_.size());
 
+  auto& code = code_.write();
+  auto& offsets = hex_offsets_.write();
+  auto& sizes = hex_sizes_.write();
+
   // Some constants
   Assembler assm;
   const auto size = assm.hex_size(instr);
@@ -214,14 +227,14 @@ void TUnit::replace(size_t index, const x64asm::Instruction& instr, bool skip_fi
 
   // If this instruction has a new size, update offset and size tables
   if (offset_delta != 0) {
-    for (size_t i = index+1, ie = hex_offsets_.size(); i < ie; ++i) {
-      hex_offsets_[i] += offset_delta;
+    for (size_t i = index+1, ie = offsets.size(); i < ie; ++i) {
+      offsets[i] += offset_delta;
     }
-    hex_sizes_[index] = size;
+    sizes[index] = size;
   }
 
   // Replace the instruction
-  code_[index] = instr;
+  code[index] = instr;
 
   // If rescale rip is true, we have to adjust a potential global rip offset
   if (!skip_first && is_rip(index) && rescale_rip) {
@@ -231,7 +244,7 @@ void TUnit::replace(size_t index, const x64asm::Instruction& instr, bool skip_fi
   // If this instruction has non-zero size, adjust everything
   if (offset_delta != 0) {
     const auto begin = skip_first || rescale_rip ? index + 1 : index;
-    for (size_t i = begin, ie = code_.size(); i < ie; ++i) {
+    for (size_t i = begin, ie = code.size(); i < ie; ++i) {
       if (is_rip(i)) {
         adjust_rip(i, -offset_delta);
       }
@@ -251,6 +264,10 @@ void TUnit::swap(size_t i, size_t j) {
     std::swap(i, j);
   }
 
+  auto& code = code_.write();
+  auto& offsets = hex_offsets_.write();
+  auto& sizes = hex_sizes_.write();
+
   // Some constants
   const int64_t span = hex_offset(j) - hex_offset(i+1);
   const int64_t offset_delta_i = span + hex_size(j);
@@ -259,19 +276,19 @@ void TUnit::swap(size_t i, size_t j) {
 
   // If hex sizes have changed update offset and size tables
   if (offset_delta_inner) {
-    std::swap(hex_sizes_[i], hex_sizes_[j]);
-    std::swap(hex_offsets_[i], hex_offsets_[j]);
-    hex_offsets_[i] += offset_delta_j;
+    std::swap(sizes[i], sizes[j]);
+    std::swap(offsets[i], offsets[j]);
+    offsets[i] += offset_delta_j;
     if (offset_delta_inner != 0) {
       for (size_t idx = i+1; idx < j; ++idx) {
-        hex_offsets_[idx] += offset_delta_inner;
+        offsets[idx] += offset_delta_inner;
       }
     }
-    hex_offsets_[j] += offset_delta_i;
+    offsets[j] += offset_delta_i;
   }
 
   // Swap the instructions
-  std::swap(code_[i], code_[j]);
+  std::swap(code[i], code[j]);
 
   // Adjust rips
   if (is_rip(i)) {
@@ -299,27 +316,31 @@ void TUnit::rotate_left(size_t i, size_t j) {
     std::swap(i, j);
   }
 
+  auto& code = code_.write();
+  auto& offsets = hex_offsets_.write();
+  auto& sizes = hex_sizes_.write();
+
   // Some constants
   const int64_t span = hex_offset(j) - hex_offset(i+1);
   const int64_t offset_delta_small = 0 - hex_size(i);
   const int64_t offset_delta_large = span + hex_size(j);
 
   // Update offset and size tables
-  const auto size = hex_sizes_[i];
-  const auto offset = hex_offsets_[i];
+  const auto size = sizes[i];
+  const auto offset = offsets[i];
   for (size_t idx = i; idx < j; ++idx) {
-    hex_sizes_[idx] = hex_sizes_[idx+1];
-    hex_offsets_[idx] = hex_offsets_[idx+1] + offset_delta_small;
+    sizes[idx] = sizes[idx+1];
+    offsets[idx] = offsets[idx+1] + offset_delta_small;
   }
-  hex_sizes_[j] = size;
-  hex_offsets_[j] = offset + offset_delta_large;
+  sizes[j] = size;
+  offsets[j] = offset + offset_delta_large;
 
   // Rotate instructions
-  const auto instr = code_[i];
+  const auto instr = code[i];
   for (size_t idx = i; idx < j; ++idx) {
-    code_[idx] = code_[idx+1];
+    code[idx] = code[idx+1];
   }
-  code_[j] = instr;
+  code[j] = instr;
 
   // Adjust rips
   for (size_t idx = i; idx < j; ++idx) {
@@ -342,27 +363,31 @@ void TUnit::rotate_right(size_t i, size_t j) {
     std::swap(i, j);
   }
 
+  auto& code = code_.write();
+  auto& offsets = hex_offsets_.write();
+  auto& sizes = hex_sizes_.write();
+
   // Some constants
   const int64_t span = hex_offset(j) - hex_offset(i+1);
   const int64_t offset_delta_small = hex_size(j);
   const int64_t offset_delta_large = 0 - span - hex_size(i);
 
   // Update offset and size tables
-  const auto size = hex_sizes_[j];
-  const auto offset = hex_offsets_[j];
+  const auto size = sizes[j];
+  const auto offset = offsets[j];
   for (int idx = j; idx > (int)i; --idx) {
-    hex_sizes_[idx] = hex_sizes_[idx-1];
-    hex_offsets_[idx] = hex_offsets_[idx-1] + offset_delta_small;
+    sizes[idx] = sizes[idx-1];
+    offsets[idx] = offsets[idx-1] + offset_delta_small;
   }
-  hex_sizes_[i] = size;
-  hex_offsets_[i] = offset + offset_delta_large;
+  sizes[i] = size;
+  offsets[i] = offset + offset_delta_large;
 
   // Rotate instructions
-  const auto instr = code_[j];
+  const auto instr = code[j];
   for (int idx = j; idx > (int)i; --idx) {
-    code_[idx] = code_[idx-1];
+    code[idx] = code[idx-1];
   }
-  code_[i] = instr;
+  code[i] = instr;
 
   // Adjust rips
   for (int idx = j; idx > (int)i; --idx) {
@@ -493,22 +518,26 @@ ostream& TUnit::write_text(ostream& os) const {
 }
 
 void TUnit::recompute() {
+  auto& offsets = hex_offsets_.reset();
+  auto& sizes = hex_sizes_.reset();
+  auto& targets = rip_offset_targets_.reset();
+
   Assembler assm;
 
   // Recompute hex sizes
-  hex_sizes_.clear();
+  sizes.clear();
   for (const auto& instr : get_code()) {
-    hex_sizes_.push_back(assm.hex_size(instr));
+    sizes.push_back(assm.hex_size(instr));
   }
 
   // Recompute hex offsets
-  hex_offsets_ = {{0}};
+  offsets = {{0}};
   for (int i = 0, ie = code_.size()-1; i < ie; ++i) {
-    hex_offsets_.push_back(hex_offsets_.back() + hex_size(i));
+    offsets.push_back(offsets.back() + hex_size(i));
   }
 
   // Recomute rip offset targets
-  rip_offset_targets_.clear();
+  targets.clear();
   for (size_t i = 0, ie = get_code().size(); i < ie; ++i) {
     const auto& instr = get_code()[i];
     if (!instr.is_explicit_memory_dereference()) {
@@ -518,7 +547,7 @@ void TUnit::recompute() {
     if (op.rip_offset()) {
       const auto after_instr = rip_offset_ + hex_offset(i) + hex_size(i);
       const auto target = after_instr + op.get_disp();
-      rip_offset_targets_.insert(target);
+      targets.insert(target);
     }
   }
 }
@@ -535,7 +564,7 @@ bool TUnit::is_rip(size_t index) const {
 void TUnit::adjust_rip(size_t index, int64_t delta) {
   assert(is_rip(index));
 
-  auto& instr = code_[index];
+  auto& instr = code_.write()[index];
 
   const auto mi = instr.mem_index();
   auto op = instr.get_operand<M8>(mi);
@@ -618,7 +647,7 @@ istream& TUnit::read_formatted_text(istream& is) {
       break;
     }
   }
-  ss >> code_;
+  ss >> code_.write();
 
   if (failed(ss)) {
     fail(is) << fail_msg(ss);
@@ -635,10 +664,11 @@ istream& TUnit::read_formatted_text(istream& is) {
 }
 
 istream& TUnit::read_naked_text(istream& is) {
-  is >> code_;
+  is >> code_.write();
 
   if (!invariant_first_instr_is_label()) {
-    code_.insert(code_.begin(), {LABEL_DEFN, {Label(".anonymous_function")}});
+    auto& code = code_.write();
+    code.insert(code.begin(), {LABEL_DEFN, {Label(".anonymous_function")}});
   }
 
   file_offset_ = 0;
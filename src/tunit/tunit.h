@@ -23,6 +23,7 @@
 #include <vector>
 
 #include "src/ext/x64asm/include/x64asm.h"
+#include "src/tunit/cow.h"
 #include "src/tunit/operand_iterator.h"
 
 namespace stoke {
@@ -50,7 +51,7 @@ struct TUnit {
 
   /** Returns the underlying code sequence */
   const x64asm::Code& get_code() const {
-    return code_;
+    return code_.get();
   }
 
   /** Returns the label at the beginning of this function */
@@ -154,36 +155,36 @@ struct TUnit {
 
   /** Iterator over call targets in this function */
   call_target_iterator call_target_begin() const {
-    return call_target_iterator(&code_, true);
+    return call_target_iterator(&code_.get(), true);
   }
   /** Iterator over call targets in this function */
   call_target_iterator call_target_end() const {
-    return call_target_iterator(&code_, false);
+    return call_target_iterator(&code_.get(), false);
   }
 
   /** Iterator over immediate operands in this function */
   imm_iterator imm_begin() const {
-    return imm_iterator(&code_, true);
+    return imm_iterator(&code_.get(), true);
   }
   /** Iterator over immediate operands in this function */
   imm_iterator imm_end() const {
-    return imm_iterator(&code_, false);
+    return imm_iterator(&code_.get(), false);
   }
 
   /** Iterator over non-rip memory operands in this function */
   mem_iterator mem_begin() const {
-    return mem_iterator(&code_, true);
+    return mem_iterator(&code_.get(), true);
   }
   /** Iterator over non-rip memory operands in this function */
   mem_iterator mem_end() const {
-    return mem_iterator(&code_, false);
+    return mem_iterator(&code_.get(), false);
   }
 
   /** Removes all instructions in the underlying code sequence */
   void clear() {
-    code_.clear();
-    hex_sizes_.clear();
-    hex_offsets_.clear();
+    code_.reset().clear();
+    hex_sizes_.reset().clear();
+    hex_offsets_.reset().clear();
   }
   /** Removes this instruction from the underlying code sequence; can cause invariants to fail */
   void remove(size_t index);
@@ -209,8 +210,8 @@ struct TUnit {
   std::ostream& write_text(std::ostream& os) const;
 
 private:
-  /** The text of the code in this function. */
-  x64asm::Code code_;
+  /** The text of the code in this function; shared with copies until either is modified. */
+  Cow<x64asm::Code> code_;
 
   /** The physical address of this function in a file */
   uint64_t file_offset_;
@@ -220,11 +221,11 @@ private:
   uint64_t rip_offset_;
 
   /** Global rip-offset targets */
-  std::set<uint64_t> rip_offset_targets_;
+  Cow<std::set<uint64_t>> rip_offset_targets_;
   /** Hex offsets of every instruction relative to function begin */
-  std::vector<size_t> hex_offsets_;
+  Cow<std::vector<size_t>> hex_offsets_;
   /** Hex size of every instruction */
-  std::vector<size_t> hex_sizes_;
+  Cow<std::vector<size_t>> hex_sizes_;
 
   /** User-provided maybe read set. */
   boost::optional<x64asm::RegSet> maybe_read_set_;
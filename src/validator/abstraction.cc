@@ -0,0 +1,212 @@
+// Copyright 2013-2016 Stanford University
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cassert>
+#include <sstream>
+
+#include "src/symstate/transform_visitor.h"
+#include "src/validator/abstraction.h"
+
+using namespace std;
+using namespace stoke;
+
+namespace {
+
+typedef unsigned __int128 uint128_t;
+typedef __int128 int128_t;
+
+uint128_t mask(uint16_t width) {
+  return width == 128 ? ~(uint128_t)0 : ((uint128_t)1 << width) - 1;
+}
+
+/** Reads a model value of up to 128 bits. */
+uint128_t read(SMTSolver& solver, const string& name, uint16_t width) {
+  auto bv = solver.get_model_bv(name, width);
+  uint128_t value = 0;
+  for (size_t i = width/8; i > 0; --i) {
+    value = (value << 8) | bv.get_fixed_byte(i-1);
+  }
+  return value;
+}
+
+int128_t to_signed(uint128_t x, uint16_t width) {
+  if (width < 128 && ((x >> (width-1)) & 1)) {
+    x |= ~mask(width);
+  }
+  return (int128_t)x;
+}
+
+/** Evaluates an operation with the semantics of SMT-LIB bit-vectors, including
+  division by zero. */
+uint128_t evaluate(SymBitVector::Type type, uint128_t a, uint128_t b, uint16_t width) {
+  const auto m = mask(width);
+  const auto sa = to_signed(a, width);
+  const auto sb = to_signed(b, width);
+  const auto a_neg = sa < 0;
+
+  switch (type) {
+  case SymBitVector::MULT:
+    return (a * b) & m;
+  case SymBitVector::DIV:
+    return b == 0 ? m : a / b;
+  case SymBitVector::MOD:
+    return b == 0 ? a : a % b;
+  case SymBitVector::SIGN_DIV:
+    if (b == 0) {
+      return a_neg ? 1 : m;
+    }
+    if (sb == -1) {
+      return (0 - a) & m;
+    }
+    return (uint128_t)(sa / sb) & m;
+  case SymBitVector::SIGN_MOD:
+    if (b == 0) {
+      return a;
+    }
+    if (sb == -1) {
+      return 0;
+    }
+    return (uint128_t)(sa % sb) & m;
+  default:
+    assert(false);
+    return 0;
+  }
+}
+
+string op_name(SymBitVector::Type type) {
+  switch (type) {
+  case SymBitVector::MULT:
+    return "mult";
+  case SymBitVector::DIV:
+    return "div";
+  case SymBitVector::MOD:
+    return "mod";
+  case SymBitVector::SIGN_DIV:
+    return "sign_div";
+  case SymBitVector::SIGN_MOD:
+    return "sign_mod";
+  default:
+    assert(false);
+    return "";
+  }
+}
+
+} // namespace
+
+namespace stoke {
+
+/** Replaces the nonlinear operations that haven't been refined. */
+class NonlinearAbstracter : public SymTransformVisitor {
+
+public:
+
+  NonlinearAbstracter(NonlinearAbstraction& owner, vector<SymBool>& extra) :
+    SymTransformVisitor(), owner_(owner), extra_(extra) {}
+
+  SymBitVectorAbstract* visit(const SymBitVectorMult * const bv) {
+    return replace(bv);
+  }
+  SymBitVectorAbstract* visit(const SymBitVectorDiv * const bv) {
+    return replace(bv);
+  }
+  SymBitVectorAbstract* visit(const SymBitVectorMod * const bv) {
+    return replace(bv);
+  }
+  SymBitVectorAbstract* visit(const SymBitVectorSignDiv * const bv) {
+    return replace(bv);
+  }
+  SymBitVectorAbstract* visit(const SymBitVectorSignMod * const bv) {
+    return replace(bv);
+  }
+
+private:
+
+  SymBitVectorAbstract* replace(const SymBitVectorBinop * const bv) {
+    if (is_cached(bv)) return get_cached(bv);
+
+    // Model values are read back at most 128 bits at a time, in whole bytes
+    if (owner_.refined_.count(bv) || bv->width_ > 128 || bv->width_ % 8) {
+      return visit_binop(bv);
+    }
+
+    auto lhs = (*this)(bv->a_);
+    auto rhs = (*this)(bv->b_);
+    auto res = owner_.replace(bv, lhs, rhs, extra_);
+    return cache(bv, (SymBitVectorAbstract*)res.ptr);
+  }
+
+  NonlinearAbstraction& owner_;
+  vector<SymBool>& extra_;
+};
+
+vector<SymBool> NonlinearAbstraction::abstract(const vector<SymBool>& constraints) {
+  sites_.clear();
+
+  vector<SymBool> result;
+  NonlinearAbstracter abstracter(*this, result);
+  for (auto& c : constraints) {
+    result.push_back(SymBool(abstracter(c.ptr)));
+  }
+  return result;
+}
+
+SymBitVector NonlinearAbstraction::replace(const SymBitVectorBinop* node, const SymBitVectorAbstract* lhs,
+    const SymBitVectorAbstract* rhs, vector<SymBool>& extra) {
+
+  if (!ids_.count(node)) {
+    auto id = ids_.size();
+    ids_[node] = id;
+  }
+
+  Site site;
+  site.node = node;
+  site.type = node->type();
+  site.width = node->width_;
+  stringstream name;
+  name << "NONLINEAR_" << ids_[node];
+  site.name = name.str();
+  sites_.push_back(site);
+
+  auto w = site.width;
+  auto a = SymBitVector::var(w, site.name + "_A");
+  auto b = SymBitVector::var(w, site.name + "_B");
+  auto r = SymBitVector::var(w, site.name + "_R");
+
+  // Every operation of a type and width shares a function, so equal arguments give equal results
+  stringstream fname;
+  fname << "nonlinear_" << op_name(site.type) << "_" << w;
+  SymFunction f(fname.str(), w, {w, w});
+
+  extra.push_back(a == SymBitVector(lhs));
+  extra.push_back(b == SymBitVector(rhs));
+  extra.push_back(r == f(a, b));
+
+  return r;
+}
+
+size_t NonlinearAbstraction::refine(SMTSolver& solver) {
+  size_t count = 0;
+  for (auto& site : sites_) {
+    auto a = read(solver, site.name + "_A", site.width);
+    auto b = read(solver, site.name + "_B", site.width);
+    auto r = read(solver, site.name + "_R", site.width);
+    if (evaluate(site.type, a, b, site.width) != r) {
+      refined_.insert(site.node);
+      count++;
+    }
+  }
+  return count;
+}
+
+} // namespace stoke
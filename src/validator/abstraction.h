@@ -0,0 +1,86 @@
+// Copyright 2013-2016 Stanford University
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef STOKE_SRC_VALIDATOR_ABSTRACTION_H
+#define STOKE_SRC_VALIDATOR_ABSTRACTION_H
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "src/solver/smtsolver.h"
+#include "src/symstate/bitvector.h"
+#include "src/symstate/bool.h"
+
+namespace stoke {
+
+/** Replaces the nonlinear operations in a formula (multiplication, division
+  and remainder) with uninterpreted functions, so that the solver doesn't have
+  to bit-blast them.  Applying an operation to equal arguments still gives
+  equal results, which is enough to prove most rewrites that keep the target's
+  multiplications.  This over-approximates the formula: an unsatisfiable
+  abstraction is a proof, but a model of it may be spurious.  In that case
+  refine() finds the operations that the model got wrong, and the next call to
+  abstract() keeps their real semantics. */
+class NonlinearAbstraction {
+
+public:
+
+  /** Returns the constraints with every operation that hasn't been refined
+    replaced by a function application. */
+  std::vector<SymBool> abstract(const std::vector<SymBool>& constraints);
+
+  /** Checks the solver's model against the operations replaced by the last
+    call to abstract().  Each one it got wrong is refined.  Returns how many
+    were; if none were, the model satisfies the original constraints too. */
+  size_t refine(SMTSolver& solver);
+
+  /** The number of operations replaced by the last call to abstract(). */
+  size_t size() const {
+    return sites_.size();
+  }
+  /** The number of operations refined so far. */
+  size_t refined() const {
+    return refined_.size();
+  }
+
+private:
+
+  /** An operation replaced by a function application. */
+  struct Site {
+    const SymBitVectorAbstract* node;
+    SymBitVector::Type type;
+    uint16_t width;
+    /** Prefix of the variables holding its arguments and result. */
+    std::string name;
+  };
+
+  /** Returns the variables and constraints that replace an operation. */
+  SymBitVector replace(const SymBitVectorBinop* node, const SymBitVectorAbstract* lhs,
+                       const SymBitVectorAbstract* rhs, std::vector<SymBool>& extra);
+
+  /** Operations replaced by the last call to abstract(). */
+  std::vector<Site> sites_;
+  /** Gives each operation the same variable names every time it's replaced. */
+  std::map<const SymBitVectorAbstract*, size_t> ids_;
+  /** Operations that keep their real semantics. */
+  std::set<const SymBitVectorAbstract*> refined_;
+
+  friend class NonlinearAbstracter;
+};
+
+} // namespace stoke
+
+#endif
@@ -12,6 +12,8 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <sstream>
+
 #include "src/cfg/cfg.h"
 #include "src/cfg/paths.h"
 #include "src/symstate/memory/trivial.h"
@@ -31,6 +33,7 @@ using namespace cpputil;
 using namespace std;
 using namespace stoke;
 using namespace x64asm;
+using namespace std::chrono;
 
 
 bool BoundedValidator::verify_pair(const Cfg& target, const Cfg& rewrite, const CfgPath& P, const CfgPath& Q) {
@@ -59,7 +62,9 @@ bool BoundedValidator::verify_pair(const Cfg& target, const Cfg& rewrite, const
 
   if (checker_has_ceg()) {
     assert(!equiv);
-    counterexamples_.push_back(checker_get_target_ceg());
+    for (auto ceg : checker_get_target_cegs()) {
+      counterexamples_.push_back(ceg);
+    }
     target_final_state_ = checker_get_target_ceg_end();
     rewrite_final_state_ = checker_get_rewrite_ceg_end();
   }
@@ -69,6 +74,73 @@ bool BoundedValidator::verify_pair(const Cfg& target, const Cfg& rewrite, const
 
 
 
+string BoundedValidator::proven_key(const Cfg& target, const Cfg& rewrite) const {
+  ostringstream ss;
+  ss << target.get_code() << "|" << rewrite.get_code() << "|";
+  ss << target.def_ins() << "|" << target.live_outs() << "|";
+  ss << heap_out_ << stack_out_ << get_nacl() << get_alias_strategy();
+  return ss.str();
+}
+
+bool BoundedValidator::verify_bound(const Cfg& target, const Cfg& rewrite, size_t bound,
+                                    steady_clock::time_point deadline, bool& timed_out) {
+
+  // Step 1: get all the paths from the enumerator
+  vector<CfgPath> target_paths;
+  vector<CfgPath> rewrite_paths;
+  for (auto path : CfgPaths::enumerate_paths(target, bound)) {
+    //cout << "adding TP: " << path << endl;
+    target_paths.push_back(path);
+  }
+  //cout << "REWRITE: " << endl << rewrite.get_code() << endl;
+  for (auto path : CfgPaths::enumerate_paths(rewrite, bound)) {
+    //cout << "adding RP: " << path << endl;
+    rewrite_paths.push_back(path);
+  }
+
+  // Handle the shorter paths first, please
+  // [helps find counterexamples sooner]
+  auto by_length = [](const CfgPath& lhs, const CfgPath& rhs) {
+    return lhs.size() < rhs.size();
+  };
+  sort(target_paths.begin(), target_paths.end(), by_length);
+  sort(rewrite_paths.begin(), rewrite_paths.end(), by_length);
+
+  // Step 2: check each pair of paths
+  bool ok = true;
+  timed_out = false;
+  for (auto target_path : target_paths) {
+    for (auto rewrite_path : rewrite_paths) {
+
+      auto pair = make_pair(target_path, rewrite_path);
+      if (proven_.count(pair)) {
+        continue;
+      }
+      if (deadline != steady_clock::time_point::max() && steady_clock::now() > deadline) {
+        timed_out = true;
+        return ok;
+      }
+
+      BOUNDED_DEBUG(cout << "[bv] Checking pair: " << target_path << "; " << rewrite_path << endl;)
+
+      if (verify_pair(target, rewrite, target_path, rewrite_path)) {
+        proven_.insert(pair);
+      } else {
+        ok = false;
+      }
+
+      // Case 1: verify failed and we have enough cegs; return false
+      // Case 2: verify failed and want more counterexamples: keep going
+      // Case 3: verify worked: keep going
+
+      if (bailout_ && !ok && counterexamples_.size() >= MAX(get_max_counterexamples(), (size_t)1))
+        return ok;
+    }
+  }
+
+  return ok;
+}
+
 bool BoundedValidator::verify(const Cfg& init_target, const Cfg& init_rewrite) {
 
 
@@ -77,9 +149,7 @@ bool BoundedValidator::verify(const Cfg& init_target, const Cfg& init_rewrite) {
 #endif
   // State
   counterexamples_.clear();
-
-  vector<CfgPath> target_paths;
-  vector<CfgPath> rewrite_paths;
+  verified_bound_ = -1;
 
   has_error_ = false;
   init_mm();
@@ -92,50 +162,39 @@ bool BoundedValidator::verify(const Cfg& init_target, const Cfg& init_rewrite) {
     // Step 0: Background checks
     sanity_checks(target, rewrite);
 
-    // Step 1: get all the paths from the enumerator
-    for (auto path : CfgPaths::enumerate_paths(target, bound_)) {
-      //cout << "adding TP: " << path << endl;
-      target_paths.push_back(path);
-    }
-    //cout << "REWRITE: " << endl << rewrite.get_code() << endl;
-    for (auto path : CfgPaths::enumerate_paths(rewrite, bound_)) {
-      //cout << "adding RP: " << path << endl;
-      rewrite_paths.push_back(path);
+    // Pairs proven for a different target or rewrite don't carry over
+    auto key = proven_key(target, rewrite);
+    if (key != proven_key_) {
+      proven_.clear();
+      proven_key_ = key;
     }
 
-    // Handle the shorter paths first, please
-    // [helps find counterexamples sooner]
-    auto by_length = [](const CfgPath& lhs, const CfgPath& rhs) {
-      return lhs.size() < rhs.size();
-    };
-    sort(target_paths.begin(), target_paths.end(), by_length);
-    sort(rewrite_paths.begin(), rewrite_paths.end(), by_length);
+    auto deadline = steady_clock::time_point::max();
+    if (deepening_ && budget_ > duration<double>::zero()) {
+      deadline = steady_clock::now() + duration_cast<steady_clock::duration>(budget_);
+    }
 
-    // Step 2: check each pair of paths
     bool ok = true;
-    size_t total = target_paths.size() * rewrite_paths.size();
-    size_t count = 0;
-    for (auto target_path : target_paths) {
-      for (auto rewrite_path : rewrite_paths) {
-
-        BOUNDED_DEBUG(cout << "[bv] Checking pair: " << target_path << "; " << rewrite_path << endl;)
-
-        count++;
-        ok &= verify_pair(target, rewrite, target_path, rewrite_path);
-
-        // Case 1: verify failed and we have ceg; return false
-        // Case 2: verify failed and no counterexampe: keep going
-        // Case 3: verify worked: keep going
-
-        if (bailout_ && !ok && counterexamples_.size() > 0)
-          break;
-      }
-      if (bailout_ && !ok && counterexamples_.size() > 0)
+    bool timed_out = false;
+    for (size_t bound = deepening_ ? 0 : bound_; ok && bound <= bound_; ++bound) {
+      ok = verify_bound(target, rewrite, bound, deadline, timed_out);
+      if (timed_out) {
         break;
+      }
+      if (ok) {
+        verified_bound_ = bound;
+      }
+    }
+
+    // Running out of time proves nothing at the requested bound
+    if (ok && timed_out) {
+      has_error_ = true;
+      error_ = "Bound deepening timed out; every pair of paths was proven up to bound " +
+               std::to_string(verified_bound_) + " of " + std::to_string(bound_) + ".";
     }
 
     reset_mm();
-    return ok;
+    return ok && !timed_out;
 
   } catch (validator_error e) {
     has_error_ = true;
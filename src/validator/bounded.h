@@ -15,7 +15,9 @@
 #ifndef STOKE_SRC_VALIDATOR_BOUNDED_H
 #define STOKE_SRC_VALIDATOR_BOUNDED_H
 
+#include <chrono>
 #include <iostream>
+#include <set>
 #include <vector>
 #include <string>
 
@@ -42,6 +44,7 @@ public:
     set_alias_strategy(AliasStrategy::STRING);
     set_nacl(false);
     set_no_bailout(false);
+    set_deepening(false);
     set_sandbox(NULL);
   }
 
@@ -66,6 +69,21 @@ public:
     return *this;
   }
 
+  /** If set to true, check bounds 0, 1, ... up to the bound in turn, stopping at
+    the first bound that fails or, if the budget isn't zero, once it runs out.
+    When the budget runs out, verify() returns false and sets an error that
+    names the deepest bound completed; see also get_verified_bound(). */
+  BoundedValidator& set_deepening(bool b, std::chrono::duration<double> budget = std::chrono::duration<double>::zero()) {
+    deepening_ = b;
+    budget_ = budget;
+    return *this;
+  }
+  /** Returns the largest bound at which every pair of paths was proven in the
+    last call to verify(), or -1 if there is none. */
+  long get_verified_bound() const {
+    return verified_bound_;
+  }
+
   /** Evalue if the target and rewrite are the same */
   bool verify(const Cfg& target, const Cfg& rewrite);
 
@@ -104,7 +122,26 @@ private:
   size_t bound_;
   /** Should we bailout early? */
   bool bailout_;
-
+  /** Should bounds be checked one at a time? */
+  bool deepening_;
+  /** How long to spend deepening, or zero for no limit. */
+  std::chrono::duration<double> budget_;
+  /** The largest bound verified by the last call to verify(). */
+  long verified_bound_;
+
+  /** Describes the (inlined) target and rewrite, and the settings that proven_ holds for. */
+  std::string proven_key_;
+  /** Pairs of paths that have been proven equivalent for proven_key_.  Paths at
+    a bound include those at every smaller bound, so these never need to be
+    checked again. */
+  std::set<std::pair<CfgPath, CfgPath>> proven_;
+
+  /** Returns a key for the target, rewrite and settings that decide whether a pair holds. */
+  std::string proven_key(const Cfg& target, const Cfg& rewrite) const;
+  /** Check every pair of paths at a bound that hasn't been proven yet; stops
+    early (setting timed_out) if the deadline passes. */
+  bool verify_bound(const Cfg& target, const Cfg& rewrite, size_t bound,
+                    std::chrono::steady_clock::time_point deadline, bool& timed_out);
   /** Verify a pair of paths. */
   bool verify_pair(const Cfg& target, const Cfg& rewrite, const CfgPath& p, const CfgPath& q);
 
@@ -67,6 +67,10 @@ public:
     return std::vector<x64asm::Opcode>();
   }
 
+  /** Drop any formulas kept between calls to build_circuit().  Called when a
+    validator is over its memory budget. */
+  virtual void clear_caches() {}
+
   /** Converts from the old deprecated string format to opcodes. */
   static std::vector<x64asm::Opcode> opcodes_convert(std::vector<std::string> support) {
     std::vector<x64asm::Opcode> res;
@@ -44,6 +44,11 @@ public:
     return opcodes;
   }
 
+  virtual void clear_caches() {
+    for (auto it : handlers_)
+      it->clear_caches();
+  }
+
   /** Get the support level for a particular instruction */
   SupportLevel get_support(const x64asm::Instruction& instr);
 
@@ -58,6 +58,11 @@ public:
 
   std::vector<x64asm::Opcode> full_support_opcodes();
 
+  void clear_caches() {
+    formula_cache_.clear();
+    ch_.clear_caches();
+  }
+
 private:
 
   void init();
@@ -18,6 +18,7 @@
 #include "src/ext/x64asm/include/x64asm.h"
 #include "src/symstate/memory/cell.h"
 #include "src/symstate/memory/flat.h"
+#include "src/symstate/memory/word.h"
 #include "src/validator/invariant.h"
 
 namespace stoke {
@@ -45,6 +46,12 @@ public:
       return flat_left->equality_constraint(*static_cast<FlatMemory*>(right.memory));
     }
 
+    auto word_left = dynamic_cast<WordMemory*>(left.memory);
+    if (word_left != 0) {
+      assert(dynamic_cast<WordMemory*>(right.memory) != 0);
+      return word_left->equality_constraint(*static_cast<WordMemory*>(right.memory));
+    }
+
     auto arm_left = dynamic_cast<ArmMemory*>(left.memory);
     if (arm_left != 0) {
       assert(dynamic_cast<ArmMemory*>(right.memory) != 0);
@@ -18,6 +18,7 @@
 #include "src/cfg/paths.h"
 #include "src/symstate/memory/arm.h"
 #include "src/symstate/memory/trivial.h"
+#include "src/validator/abstraction.h"
 #include "src/validator/obligation_checker.h"
 #include "src/validator/invariants/conjunction.h"
 #include "src/validator/invariants/memory_equality.h"
@@ -116,6 +117,49 @@ bool ObligationChecker::build_testcase_flat_memory(CpuState& ceg, SymArray var,
 
 }
 
+bool ObligationChecker::build_testcase_word_memory(CpuState& ceg, SymArray var, const map<const SymBitVectorAbstract*, uint64_t>& others) const {
+  auto symvar = dynamic_cast<const SymArrayVar* const>(var.ptr);
+  assert(symvar != NULL);
+  auto str = symvar->name_;
+
+  auto map_and_default = solver_.get_model_array(str, 64, 64);
+  auto word_map = map_and_default.first;
+  auto default_value = map_and_default.second;
+
+  // Split the words that were accessed into bytes
+  unordered_map<uint64_t, BitVector> mem_map;
+  for (auto p : others) {
+    auto abs_var = p.first;
+    uint64_t size = p.second/8;
+
+    auto var = dynamic_cast<const SymBitVectorVar*>(abs_var);
+    assert(var != NULL);
+    auto var_name = var->get_name();
+    auto var_size = var->get_size();
+    assert(var_size == 64);
+    auto address_bv = solver_.get_model_bv(var_name, var_size);
+    auto addr = address_bv.get_fixed_quad(0);
+
+    for (uint64_t i = addr; i < addr + size; ++i) {
+      const auto word = word_map.find((i >> 3) & ((0x1ull << 61) - 1));
+      BitVector byte(8);
+      byte.get_fixed_byte(0) = word == word_map.end() ?
+                               default_value >> (8*(i & 0x7)) :
+                               word->second.get_fixed_byte(i & 0x7);
+      mem_map[i] = byte;
+    }
+  }
+
+  BUILD_TC_DEBUG(
+    cout << "[build tc] map:" << endl;
+  for (auto it : mem_map) {
+  cout << "  " << it.first << " -> " << (uint64_t)it.second.get_fixed_byte(0) << endl;
+  }
+  );
+
+  return ceg.memory_from_map(mem_map);
+}
+
 bool ObligationChecker::build_testcase_cell_memory(CpuState& ceg, CellMemory* target_memory, const CellMemory* rewrite_memory, const Cfg& target, const Cfg& rewrite, bool begin) const {
 
   if (!target_memory || !rewrite_memory) {
@@ -415,7 +459,8 @@ vector<pair<CellMemory*, CellMemory*>> ObligationChecker::enumerate_aliasing(con
   case AliasStrategy::STRING_NO_ALIAS:
     return enumerate_aliasing_string(target, rewrite, P, Q, assume, prove);
   case AliasStrategy::ARM:
-  case AliasStrategy::FLAT: {
+  case AliasStrategy::FLAT:
+  case AliasStrategy::WORD: {
     auto res = vector<pair<CellMemory*, CellMemory*>>();
     res.push_back(pair<CellMemory*,CellMemory*>(NULL, NULL));
     return res;
@@ -1074,6 +1119,119 @@ void ObligationChecker::delete_memories(std::vector<std::pair<CellMemory*, CellM
   }
 }
 
+bool ObligationChecker::read_counterexample(const Cfg& target, const Cfg& rewrite,
+    SymState& state_t, SymState& state_r,
+    CpuState& ceg_t, CpuState& ceg_r, CpuState& ceg_tf, CpuState& ceg_rf) const {
+
+  ceg_t = Validator::state_from_model(solver_, "_1_INIT");
+  ceg_r = Validator::state_from_model(solver_, "_2_INIT");
+  ceg_tf = Validator::state_from_model(solver_, "_1_FINAL");
+  ceg_rf = Validator::state_from_model(solver_, "_2_FINAL");
+
+  bool ok = true;
+  if (alias_strategy_ == AliasStrategy::FLAT) {
+    auto target_flat = static_cast<FlatMemory*>(state_t.memory);
+    auto rewrite_flat = static_cast<FlatMemory*>(state_r.memory);
+
+    vector<map<const SymBitVectorAbstract*, uint64_t>> other_maps;
+    other_maps.push_back(target_flat->get_access_list());
+    other_maps.push_back(rewrite_flat->get_access_list());
+    auto other_map = append_maps(other_maps);
+
+    ok &= build_testcase_flat_memory(ceg_t, target_flat->get_start_variable(), other_map);
+    ok &= build_testcase_flat_memory(ceg_r, rewrite_flat->get_start_variable(), other_map);
+    ok &= build_testcase_flat_memory(ceg_tf, target_flat->get_variable(), other_map);
+    ok &= build_testcase_flat_memory(ceg_rf, rewrite_flat->get_variable(), other_map);
+  } else if (alias_strategy_ == AliasStrategy::ARM) {
+    auto target_arm = static_cast<ArmMemory*>(state_t.memory);
+    auto rewrite_arm = static_cast<ArmMemory*>(state_r.memory);
+
+    vector<map<const SymBitVectorAbstract*, uint64_t>> other_maps;
+    other_maps.push_back(target_arm->get_access_list());
+    other_maps.push_back(rewrite_arm->get_access_list());
+    auto other_map = append_maps(other_maps);
+
+    ok &= build_testcase_flat_memory(ceg_t, target_arm->get_start_variable(), other_map);
+    ok &= build_testcase_flat_memory(ceg_r, rewrite_arm->get_start_variable(), other_map);
+    ok &= build_testcase_flat_memory(ceg_tf, target_arm->get_variable(), other_map);
+    ok &= build_testcase_flat_memory(ceg_rf, rewrite_arm->get_variable(), other_map);
+
+  } else if (alias_strategy_ == AliasStrategy::WORD) {
+    auto target_word = static_cast<WordMemory*>(state_t.memory);
+    auto rewrite_word = static_cast<WordMemory*>(state_r.memory);
+
+    vector<map<const SymBitVectorAbstract*, uint64_t>> other_maps;
+    other_maps.push_back(target_word->get_access_list());
+    other_maps.push_back(rewrite_word->get_access_list());
+    auto other_map = append_maps(other_maps);
+
+    ok &= build_testcase_word_memory(ceg_t, target_word->get_start_variable(), other_map);
+    ok &= build_testcase_word_memory(ceg_r, rewrite_word->get_start_variable(), other_map);
+    ok &= build_testcase_word_memory(ceg_tf, target_word->get_variable(), other_map);
+    ok &= build_testcase_word_memory(ceg_rf, rewrite_word->get_variable(), other_map);
+
+  } else {
+    auto tcell = dynamic_cast<CellMemory*>(state_t.memory);
+    auto rcell = dynamic_cast<CellMemory*>(state_r.memory);
+    ok &= build_testcase_cell_memory(ceg_t, tcell, rcell, target, rewrite, true);
+    ok &= build_testcase_cell_memory(ceg_r, tcell, rcell, target, rewrite, true);
+    ok &= build_testcase_cell_memory(ceg_tf, tcell, rcell, target, rewrite, false);
+    ok &= build_testcase_cell_memory(ceg_rf, tcell, rcell, target, rewrite, false);
+  }
+
+  if (!ok) {
+    // We don't have memory accurate in our counterexample.
+    CEG_DEBUG(cout << "(  Counterexample does not have accurate memory)" << endl;)
+  }
+
+  CEG_DEBUG(cout << "  (Got counterexample)" << endl;)
+  CEG_DEBUG(cout << "TARGET START STATE" << endl;)
+  CEG_DEBUG(cout << ceg_t << endl;)
+  CEG_DEBUG(cout << "REWRITE START STATE" << endl;)
+  CEG_DEBUG(cout << ceg_r << endl;)
+  CEG_DEBUG(cout << "TARGET (expected) END STATE" << endl;)
+  CEG_DEBUG(cout << ceg_tf << endl;)
+  CEG_DEBUG(cout << "REWRITE (expected) END STATE" << endl;)
+  CEG_DEBUG(cout << ceg_rf << endl;)
+
+  return ok;
+}
+
+void ObligationChecker::add_counterexample(const CpuState& ceg_t, const CpuState& ceg_r,
+    const CpuState& ceg_tf, const CpuState& ceg_rf) {
+  if (!have_ceg_) {
+    ceg_t_ = ceg_t;
+    ceg_r_ = ceg_r;
+    ceg_tf_ = ceg_tf;
+    ceg_rf_ = ceg_rf;
+    have_ceg_ = true;
+  }
+  target_cegs_.push_back(ceg_t);
+}
+
+SymBool ObligationChecker::new_inputs(const RegSet& def_ins, const CpuState& ceg) {
+  SymState init("1_INIT");
+
+  auto differs = SymBool::_false();
+  for (auto it = def_ins.gp_begin(); it != def_ins.gp_end(); ++it) {
+    auto value = SymBitVector::constant(64, ceg.gp[*it].get_fixed_quad(0));
+    differs = differs | (init.lookup(*it) != value[(*it).size()-1][0]);
+  }
+  for (auto it = def_ins.sse_begin(); it != def_ins.sse_end(); ++it) {
+    auto value = SymBitVector::constant(64, ceg.sse[*it].get_fixed_quad(0));
+    for (size_t i = 1; i < (*it).size()/64; ++i) {
+      value = SymBitVector::constant(64, ceg.sse[*it].get_fixed_quad(i)) || value;
+    }
+    differs = differs | (init.lookup(*it) != value);
+  }
+  for (auto it = def_ins.flags_begin(); it != def_ins.flags_end(); ++it) {
+    if (ceg.rf.is_status((*it).index())) {
+      differs = differs | (init[*it] != SymBool::constant(ceg.rf.is_set((*it).index())));
+    }
+  }
+  return differs;
+}
+
 bool ObligationChecker::check(const Cfg& target, const Cfg& rewrite, Cfg::id_type target_block, Cfg::id_type rewrite_block, const CfgPath& P, const CfgPath& Q, const Invariant& assume, const Invariant& prove) {
 
 #ifdef DEBUG_CHECKER_PERFORMANCE
@@ -1089,13 +1247,16 @@ bool ObligationChecker::check(const Cfg& target, const Cfg& rewrite, Cfg::id_typ
   OBLIG_DEBUG(cout << "----" << endl;)
   init_mm();
   have_ceg_ = false;
+  target_cegs_.clear();
 
   // Get a list of all aliasing cases.
   auto memory_list =  enumerate_aliasing(target, rewrite, P, Q, assume, prove);
   bool flat_model = alias_strategy_ == AliasStrategy::FLAT;
   bool arm_model = alias_strategy_ == AliasStrategy::ARM;
+  bool word_model = alias_strategy_ == AliasStrategy::WORD;
 
   OBLIG_DEBUG(cout << memory_list.size() << " Aliasing cases.  Yay." << endl;);
+  bool failed = false;
 
 #ifdef DEBUG_CHECKER_PERFORMANCE
   microseconds perf_alias = duration_cast<microseconds>(system_clock::now().time_since_epoch());
@@ -1144,6 +1305,9 @@ bool ObligationChecker::check(const Cfg& target, const Cfg& rewrite, Cfg::id_typ
     } else if (arm_model) {
       state_t.memory = new ArmMemory(solver_);
       state_r.memory = new ArmMemory(solver_);
+    } else if (word_model) {
+      state_t.memory = new WordMemory();
+      state_r.memory = new WordMemory();
     }
 
     // Add given assumptions
@@ -1216,6 +1380,20 @@ bool ObligationChecker::check(const Cfg& target, const Cfg& rewrite, Cfg::id_typ
       constraints.insert(constraints.begin(),
                          rewrite_con.begin(),
                          rewrite_con.end());
+    } else if (word_model) {
+      auto target_word = static_cast<WordMemory*>(state_t.memory);
+      auto rewrite_word = static_cast<WordMemory*>(state_r.memory);
+      // Name the final heaps now so that counterexamples can read them back
+      target_word->get_variable();
+      rewrite_word->get_variable();
+      auto target_con = target_word->get_constraints();
+      auto rewrite_con = rewrite_word->get_constraints();
+      constraints.insert(constraints.begin(),
+                         target_con.begin(),
+                         target_con.end());
+      constraints.insert(constraints.begin(),
+                         rewrite_con.begin(),
+                         rewrite_con.end());
     } else if (arm_model) {
       auto target_arm = static_cast<ArmMemory*>(state_t.memory);
       auto rewrite_arm = static_cast<ArmMemory*>(state_r.memory);
@@ -1241,7 +1419,30 @@ bool ObligationChecker::check(const Cfg& target, const Cfg& rewrite, Cfg::id_typ
 #endif
 
 
-    bool is_sat = solver_.is_sat(constraints);
+    bool is_sat = false;
+    if (abstract_nonlinear_) {
+      // Prove the abstraction, and refine it only as far as spurious models force us to
+      NonlinearAbstraction abstraction;
+      auto abstract_constraints = abstraction.abstract(constraints);
+      is_sat = solver_.is_sat(abstract_constraints);
+      while (is_sat && !solver_.has_error() && abstraction.size() > 0) {
+        CpuState ceg_t, ceg_r, ceg_tf, ceg_rf;
+        read_counterexample(target, rewrite, state_t, state_r, ceg_t, ceg_r, ceg_tf, ceg_rf);
+        if (check_counterexample(target, rewrite, P, Q, assume, prove, ceg_t, ceg_r)) {
+          break;
+        }
+        if (abstraction.refine(solver_) == 0) {
+          // The model is consistent with the real semantics; refining won't get rid of it
+          break;
+        }
+        CEG_DEBUG(cout << "  (Refined " << abstraction.refined() << " nonlinear operations)" << endl;)
+        abstract_constraints = abstraction.abstract(constraints);
+        is_sat = solver_.is_sat(abstract_constraints);
+      }
+      constraints = abstract_constraints;
+    } else {
+      is_sat = solver_.is_sat(constraints);
+    }
     if (solver_.has_error()) {
       throw VALIDATOR_ERROR("solver: " + solver_.get_error());
     }
@@ -1252,91 +1453,52 @@ bool ObligationChecker::check(const Cfg& target, const Cfg& rewrite, Cfg::id_typ
 #endif
 
     if (is_sat) {
-      ceg_t_ = Validator::state_from_model(solver_, "_1_INIT");
-      ceg_r_ = Validator::state_from_model(solver_, "_2_INIT");
-      ceg_tf_ = Validator::state_from_model(solver_, "_1_FINAL");
-      ceg_rf_ = Validator::state_from_model(solver_, "_2_FINAL");
-
-      bool ok = true;
-      if (flat_model) {
-        auto target_flat = static_cast<FlatMemory*>(state_t.memory);
-        auto rewrite_flat = static_cast<FlatMemory*>(state_r.memory);
-
-        vector<map<const SymBitVectorAbstract*, uint64_t>> other_maps;
-        other_maps.push_back(target_flat->get_access_list());
-        other_maps.push_back(rewrite_flat->get_access_list());
-        auto other_map = append_maps(other_maps);
-
-        ok &= build_testcase_flat_memory(ceg_t_, target_flat->get_start_variable(), other_map);
-        ok &= build_testcase_flat_memory(ceg_r_, rewrite_flat->get_start_variable(), other_map);
-        ok &= build_testcase_flat_memory(ceg_tf_, target_flat->get_variable(), other_map);
-        ok &= build_testcase_flat_memory(ceg_rf_, rewrite_flat->get_variable(), other_map);
-      } else if (arm_model) {
-        auto target_arm = static_cast<ArmMemory*>(state_t.memory);
-        auto rewrite_arm = static_cast<ArmMemory*>(state_r.memory);
-
-        vector<map<const SymBitVectorAbstract*, uint64_t>> other_maps;
-        other_maps.push_back(target_arm->get_access_list());
-        other_maps.push_back(rewrite_arm->get_access_list());
-        auto other_map = append_maps(other_maps);
-
-        ok &= build_testcase_flat_memory(ceg_t_, target_arm->get_start_variable(), other_map);
-        ok &= build_testcase_flat_memory(ceg_r_, rewrite_arm->get_start_variable(), other_map);
-        ok &= build_testcase_flat_memory(ceg_tf_, target_arm->get_variable(), other_map);
-        ok &= build_testcase_flat_memory(ceg_rf_, rewrite_arm->get_variable(), other_map);
-
-      } else {
-        auto tcell = dynamic_cast<CellMemory*>(state_t.memory);
-        auto rcell = dynamic_cast<CellMemory*>(state_r.memory);
-        ok &= build_testcase_cell_memory(ceg_t_, tcell, rcell, target, rewrite, true);
-        ok &= build_testcase_cell_memory(ceg_r_, tcell, rcell, target, rewrite, true);
-        ok &= build_testcase_cell_memory(ceg_tf_, tcell, rcell, target, rewrite, false);
-        ok &= build_testcase_cell_memory(ceg_rf_, tcell, rcell, target, rewrite, false);
-      }
-
-      if (!ok) {
-        // We don't have memory accurate in our counterexample.  Just leave.
-        have_ceg_ = false;
-        CEG_DEBUG(cout << "(  Counterexample does not have accurate memory)" << endl;)
-      }
-
-      CEG_DEBUG(cout << "  (Got counterexample)" << endl;)
-      CEG_DEBUG(cout << "TARGET START STATE" << endl;)
-      CEG_DEBUG(cout << ceg_t_ << endl;)
-      CEG_DEBUG(cout << "REWRITE START STATE" << endl;)
-      CEG_DEBUG(cout << ceg_r_ << endl;)
-      CEG_DEBUG(cout << "TARGET (expected) END STATE" << endl;)
-      CEG_DEBUG(cout << ceg_tf_ << endl;)
-      CEG_DEBUG(cout << "REWRITE (expected) END STATE" << endl;)
-      CEG_DEBUG(cout << ceg_rf_ << endl;)
-
-
-      if (check_counterexample(target, rewrite, P, Q, assume, prove, ceg_t_, ceg_r_)) {
-        have_ceg_ = true;
+      CpuState ceg_t, ceg_r, ceg_tf, ceg_rf;
+      read_counterexample(target, rewrite, state_t, state_r, ceg_t, ceg_r, ceg_tf, ceg_rf);
+      if (check_counterexample(target, rewrite, P, Q, assume, prove, ceg_t, ceg_r)) {
         CEG_DEBUG(cout << "  (Counterexample verified in sandbox)" << endl;)
+        add_counterexample(ceg_t, ceg_r, ceg_tf, ceg_rf);
       } else {
         CEG_DEBUG(cout << "  (Spurious counterexample detected)" << endl;)
       }
 
-      if (flat_model) {
+      // Ask for more by ruling out the inputs we've already seen
+      for (size_t i = 1; i < max_counterexamples_ && target_cegs_.size() < max_counterexamples_; ++i) {
+        constraints.push_back(new_inputs(target.def_ins(), ceg_t));
+        if (!solver_.is_sat(constraints) || solver_.has_error()) {
+          break;
+        }
+        read_counterexample(target, rewrite, state_t, state_r, ceg_t, ceg_r, ceg_tf, ceg_rf);
+        if (check_counterexample(target, rewrite, P, Q, assume, prove, ceg_t, ceg_r)) {
+          CEG_DEBUG(cout << "  (Additional counterexample verified in sandbox)" << endl;)
+          add_counterexample(ceg_t, ceg_r, ceg_tf, ceg_rf);
+        }
+      }
+
+      if (flat_model || word_model) {
         delete state_t.memory;
         delete state_r.memory;
       }
 
-      delete_memories(memory_list);
-      stop_mm();
-
 #ifdef DEBUG_CHECKER_PERFORMANCE
       microseconds perf_ceg = duration_cast<microseconds>(system_clock::now().time_since_epoch());
       ceg_time_ += (perf_ceg - perf_solve).count();
       print_performance();
 #endif
 
+      // Other aliasing cases may fail on different inputs; look there if we want more
+      failed = true;
+      if (target_cegs_.size() < max_counterexamples_ && max_counterexamples_ > 1) {
+        continue;
+      }
 
+      delete_memories(memory_list);
+      stop_mm();
+      enforce_memory_budget();
       return false;
     } else {
 
-      if (flat_model) {
+      if (flat_model || word_model) {
         delete state_t.memory;
         delete state_r.memory;
       }
@@ -1357,7 +1519,8 @@ bool ObligationChecker::check(const Cfg& target, const Cfg& rewrite, Cfg::id_typ
 
   delete_memories(memory_list);
   stop_mm();
-  return true;
+  enforce_memory_budget();
+  return !failed;
 
 }
 
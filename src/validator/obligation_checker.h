@@ -28,6 +28,7 @@
 #include "src/symstate/memory/cell.h"
 #include "src/symstate/memory/flat.h"
 #include "src/symstate/memory/arm.h"
+#include "src/symstate/memory/word.h"
 #include "src/validator/invariant.h"
 #include "src/validator/validator.h"
 #include "src/validator/filters/default.h"
@@ -60,12 +61,15 @@ public:
     FLAT,              // model memory as an array in the SMT solver (SOUND)
     STRING,            // look for continugous memory accesses and combine them (SOUND)
     STRING_NO_ALIAS,   // assume strings don't overlap (UNSOUND)
-    ARM
+    ARM,
+    WORD               // model memory as an array of 64-bit words in the SMT solver (SOUND)
   };
 
   ObligationChecker(SMTSolver& solver) : Validator(solver) {
     set_alias_strategy(AliasStrategy::STRING);
     set_nacl(false);
+    set_max_counterexamples(1);
+    set_abstract_nonlinear(false);
     filter_ = new DefaultFilter(handler_);
   }
 
@@ -79,6 +83,10 @@ public:
     alias_strategy_ = as;
     return *this;
   }
+  /** Get strategy for aliasing */
+  AliasStrategy get_alias_strategy() const {
+    return alias_strategy_;
+  }
 
   ObligationChecker& set_filter(Filter* filter) {
     if (filter_)
@@ -99,6 +107,32 @@ public:
     nacl_ = b;
     return *this;
   }
+  bool get_nacl() const {
+    return nacl_;
+  }
+
+  /** Set the number of counterexamples to look for when a check fails.  After
+    the first, each one found is ruled out by requiring the target's inputs to
+    differ, and the remaining aliasing cases are tried as well. */
+  ObligationChecker& set_max_counterexamples(size_t n) {
+    max_counterexamples_ = n;
+    return *this;
+  }
+  size_t get_max_counterexamples() const {
+    return max_counterexamples_;
+  }
+
+  /** If set to true, multiplication, division and remainder are first treated
+    as uninterpreted functions.  A spurious counterexample from the solver
+    brings back the real semantics of just the operations it got wrong, and
+    the query is tried again; see NonlinearAbstraction. */
+  ObligationChecker& set_abstract_nonlinear(bool b) {
+    abstract_nonlinear_ = b;
+    return *this;
+  }
+  bool get_abstract_nonlinear() const {
+    return abstract_nonlinear_;
+  }
 
   enum JumpType {
     NONE, // jump target is the fallthrough
@@ -134,6 +168,11 @@ public:
   CpuState checker_get_rewrite_ceg_end() {
     return ceg_rf_;
   }
+  /** Every target counterexample verified in the last check, starting with
+    checker_get_target_ceg(). */
+  std::vector<CpuState> checker_get_target_cegs() {
+    return target_cegs_;
+  }
 
 
 
@@ -198,6 +237,9 @@ private:
 
   bool build_testcase_flat_memory(CpuState&, SymArray variable,
                                   const std::map<const SymBitVectorAbstract*, uint64_t>& others) const;
+  /** Populate a testcase with the bytes accessed in a word-granular memory. */
+  bool build_testcase_word_memory(CpuState&, SymArray variable,
+                                  const std::map<const SymBitVectorAbstract*, uint64_t>& others) const;
 
   /** Go through lists of pairs of pointers and free all the memory. */
   void delete_memories(std::vector<std::pair<CellMemory*, CellMemory*>>& memories);
@@ -243,6 +285,17 @@ private:
                             const CfgPath& Q, const Invariant& assume,
                             const Invariant& prove, const CpuState& ceg, const CpuState& ceg2);
 
+  /** Read the current model into target/rewrite start and end states.  Returns
+    false if the memory in them isn't accurate. */
+  bool read_counterexample(const Cfg& target, const Cfg& rewrite,
+                           SymState& state_t, SymState& state_r,
+                           CpuState& ceg_t, CpuState& ceg_r, CpuState& ceg_tf, CpuState& ceg_rf) const;
+  /** Record a counterexample that has been verified in the sandbox. */
+  void add_counterexample(const CpuState& ceg_t, const CpuState& ceg_r,
+                          const CpuState& ceg_tf, const CpuState& ceg_rf);
+  /** Returns a constraint that the target's inputs differ from a counterexample's. */
+  static SymBool new_inputs(const x64asm::RegSet& def_ins, const CpuState& ceg);
+
   /** Run the sandbox on a state, cfg along a path.  Used for checking counterexamples. */
   CpuState run_sandbox_on_path(const Cfg& cfg, const CfgPath& P, const CpuState& state);
 
@@ -265,6 +318,12 @@ private:
   CpuState ceg_rf_;
   /** Do we have a counterexample? */
   bool have_ceg_;
+  /** Every target counterexample found in the last check. */
+  std::vector<CpuState> target_cegs_;
+  /** How many counterexamples to look for. */
+  size_t max_counterexamples_;
+  /** Abstract nonlinear operations before bit-blasting them? */
+  bool abstract_nonlinear_;
 
 
 
@@ -12,7 +12,10 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <malloc.h>
+
 #include <string>
+#include <fstream>
 #include <iostream>
 #include <sstream>
 #include <vector>
@@ -32,6 +35,26 @@ using namespace x64asm;
 
 #define DEBUG_MAP_TC(X) {}
 
+namespace {
+
+/** Reads a field of /proc/self/status that is given in kB, returning bytes. */
+size_t read_status_bytes(const string& field) {
+  ifstream ifs("/proc/self/status");
+  string line;
+  while (getline(ifs, line)) {
+    if (line.compare(0, field.length(), field) != 0 || line[field.length()] != ':') {
+      continue;
+    }
+    istringstream iss(line.substr(field.length() + 1));
+    size_t kb = 0;
+    iss >> kb;
+    return kb * 1024;
+  }
+  return 0;
+}
+
+} // namespace
+
 
 bool Validator::is_supported(Instruction& i) const {
 
@@ -184,9 +207,21 @@ Cfg Validator::inline_functions(const Cfg& cfg) const {
 
 }
 
+size_t Validator::current_rss() {
+  return read_status_bytes("VmRSS");
+}
 
+size_t Validator::peak_rss() {
+  return read_status_bytes("VmHWM");
+}
 
+void Validator::enforce_memory_budget() {
+  if (memory_budget_ == 0 || current_rss() <= memory_budget_) {
+    return;
+  }
 
-
-
-
+  handler_.clear_caches();
+  // Symbolic nodes are many small allocations; the allocator keeps their pages otherwise
+  malloc_trim(0);
+  collections_++;
+}
@@ -36,11 +36,13 @@ public:
   Validator(SMTSolver& solver) : solver_(solver),
     handler_(*(new ComboHandler())), free_handler_(true) {
     has_error_ = false;
+    set_memory_budget(0);
     setup_support_table();
   }
 
   Validator(SMTSolver& solver, Handler& h) : solver_(solver), handler_(h), free_handler_(false) {
     has_error_ = false;
+    set_memory_budget(0);
     setup_support_table();
   }
 
@@ -73,6 +75,30 @@ public:
    * what you're doing.  Ignores memory. */
   static CpuState state_from_model(SMTSolver& smt, const std::string& name_suffix);
 
+  /** Set a limit, in bytes, on the resident memory of this process.  Whenever
+    an obligation finishes with the process over the limit, the handler's
+    caches are dropped and freed memory is handed back to the system.  Zero
+    means no limit. */
+  Validator& set_memory_budget(size_t bytes) {
+    memory_budget_ = bytes;
+    collections_ = 0;
+    return *this;
+  }
+  size_t get_memory_budget() const {
+    return memory_budget_;
+  }
+  /** Returns how many times the memory budget forced a collection. */
+  size_t get_collections() const {
+    return collections_;
+  }
+
+  /** Returns the resident set size of this process in bytes, or zero if it
+    can't be read. */
+  static size_t current_rss();
+  /** Returns the largest resident set size this process has had in bytes, or
+    zero if it can't be read. */
+  static size_t peak_rss();
+
 protected:
 
   /** Check that def-ins, live-outs match, and that non-control flow
@@ -113,6 +139,10 @@ protected:
     while (memory_manager_.size())
       stop_mm();
   }
+  /** Call between obligations, after their memory manager has been popped.  If
+    the process is over its memory budget, drops the handler's caches and
+    returns freed memory to the system. */
+  void enforce_memory_budget();
   /** The memory manager */
   std::stack<SymMemoryManager*> memory_manager_;
 
@@ -129,6 +159,11 @@ protected:
   /** Code to setup the table to find support levels */
   void setup_support_table();
 
+  /** Resident memory limit in bytes, or zero for none. */
+  size_t memory_budget_;
+  /** Collections forced by the memory budget. */
+  size_t collections_;
+
   /** File where error occurred */
   std::string error_file_;
   /** Line where error occurred */
@@ -223,5 +223,79 @@ TEST(CfgTest, Issue856) {
   EXPECT_TRUE(cfg.check_invariants());
 }
 
+TEST(CfgTest, CopiesAreIndependent) {
+
+  std::stringstream ss;
+  ss << ".foo:" << std::endl;
+  ss << "movq %rdi, %rax" << std::endl;
+  ss << "cmpq $0x0, %rax" << std::endl;
+  ss << "je .L1" << std::endl;
+  ss << "addq $0x1, %rax" << std::endl;
+  ss << ".L1:" << std::endl;
+  ss << "retq" << std::endl;
+
+  x64asm::Code code;
+  ss >> code;
+
+  x64asm::RegSet di = x64asm::RegSet::empty() + x64asm::rdi;
+  x64asm::RegSet lo = x64asm::RegSet::empty() + x64asm::rax;
+  Cfg original(code, di, lo);
+  const auto num_blocks = original.num_blocks();
+  const auto hex_size = original.get_function().hex_size();
+
+  // Removing the conditional jump in a copy merges two blocks; the original must not notice
+  Cfg copy = original;
+  copy.get_function().remove(3);
+  copy.recompute();
+
+  EXPECT_EQ(code.size(), original.get_code().size());
+  EXPECT_EQ(num_blocks, original.num_blocks());
+  EXPECT_EQ(hex_size, original.get_function().hex_size());
+  EXPECT_TRUE(original.check_invariants());
+
+  EXPECT_EQ(code.size() - 1, copy.get_code().size());
+  EXPECT_EQ(num_blocks - 1, copy.num_blocks());
+  EXPECT_TRUE(copy.check_invariants());
+
+  // And the other way around
+  original.get_function().replace(4, x64asm::Instruction(x64asm::NOP));
+  original.recompute();
+  EXPECT_EQ(code[4].get_opcode(), copy.get_code()[3].get_opcode());
+}
+
+TEST(CfgTest, RecomputingASharedCopyRebuildsItsTables) {
+
+  std::stringstream ss;
+  ss << ".foo:" << std::endl;
+  ss << "movq %rdi, %rax" << std::endl;
+  ss << "cmpq $0x0, %rax" << std::endl;
+  ss << "je .L1" << std::endl;
+  ss << "addq $0x1, %rax" << std::endl;
+  ss << ".L1:" << std::endl;
+  ss << "retq" << std::endl;
+
+  x64asm::Code code;
+  ss >> code;
+
+  x64asm::RegSet di = x64asm::RegSet::empty() + x64asm::rdi;
+  x64asm::RegSet lo = x64asm::RegSet::empty() + x64asm::rax;
+  Cfg original(code, di, lo);
+
+  // Tables rebuilt without copying the shared ones must come out the same
+  Cfg copy = original;
+  copy.recompute();
+
+  ASSERT_EQ(original.num_blocks(), copy.num_blocks());
+  EXPECT_EQ(original.get_function().hex_size(), copy.get_function().hex_size());
+  for (size_t i = 0, ie = code.size(); i < ie; ++i) {
+    const auto loc = original.get_loc(i);
+    EXPECT_EQ(original.def_ins(loc), copy.def_ins(loc));
+    EXPECT_EQ(original.live_outs(loc), copy.live_outs(loc));
+    EXPECT_EQ(original.get_function().hex_offset(i), copy.get_function().hex_offset(i));
+  }
+  EXPECT_TRUE(original.check_invariants());
+  EXPECT_TRUE(copy.check_invariants());
+}
+
 } //namespace stoke
 #endif
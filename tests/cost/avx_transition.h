@@ -0,0 +1,74 @@
+// Copyright 2013-2016 Stanford University
+//
+// Licensed under the Apache License, Version 2.0 (the License);
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an AS IS BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <sstream>
+
+#include "src/cfg/cfg.h"
+#include "src/cost/avx_transition.h"
+
+namespace stoke {
+
+class AvxTransitionCostTest : public ::testing::Test {
+
+protected:
+
+  AvxTransitionCost fxn_;
+
+  Cost transitions(std::string s) {
+    x64asm::Code c;
+
+    std::stringstream str;
+    str << ".dummy:" << std::endl;
+    str << s << std::endl;
+    str << "retq" << std::endl;
+    str >> c;
+
+    Cfg cfg(c, x64asm::RegSet::universe(), x64asm::RegSet::empty());
+    return fxn_(cfg).second;
+  }
+
+};
+
+TEST_F(AvxTransitionCostTest, NoMixing) {
+  EXPECT_EQ(0ul, transitions("addps %xmm0, %xmm1"));
+  EXPECT_EQ(0ul, transitions("vaddps %xmm0, %xmm1, %xmm2\naddps %xmm0, %xmm1"));
+}
+
+TEST_F(AvxTransitionCostTest, DirtyUpperBeforeSse) {
+  EXPECT_EQ(1ul, transitions("vaddps %ymm0, %ymm1, %ymm2\naddps %xmm0, %xmm1"));
+}
+
+TEST_F(AvxTransitionCostTest, VzeroupperCleans) {
+  EXPECT_EQ(0ul, transitions("vaddps %ymm0, %ymm1, %ymm2\nvzeroupper\naddps %xmm0, %xmm1"));
+}
+
+TEST_F(AvxTransitionCostTest, DirtyUpperOnReturn) {
+  EXPECT_EQ(1ul, transitions("vaddps %ymm0, %ymm1, %ymm2"));
+}
+
+TEST_F(AvxTransitionCostTest, LoopPenalty) {
+  std::stringstream ss;
+  ss << ".L0:" << std::endl;
+  ss << "vaddps %ymm0, %ymm1, %ymm2" << std::endl;
+  ss << "addps %xmm0, %xmm1" << std::endl;
+  ss << "decq %rcx" << std::endl;
+  ss << "jne .L0" << std::endl;
+  ss << "vzeroupper";
+
+  // Both transitions happen on every iteration after the first
+  fxn_.set_loop_penalty(5);
+  EXPECT_EQ(10ul, transitions(ss.str()));
+}
+
+} //namespace stoke
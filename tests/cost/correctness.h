@@ -14,9 +14,12 @@
 
 
 #include <sstream>
+#include <stdlib.h>
+#include <unistd.h>
 
 #include "src/cfg/cfg.h"
 #include "src/cost/correctness.h"
+#include "src/cost/reference_cache.h"
 #include "src/ext/cpputil/include/bits/bit_manip.h"
 #include "src/ext/x64asm/include/x64asm.h"
 #include "src/sandbox/sandbox.h"
@@ -346,4 +349,202 @@ TEST_F(CorrectnessCostTest, SignalPenalty) {
 
 }
 
+TEST_F(CorrectnessCostTest, MinibatchConfirmsCorrectRewrites) {
+
+  // Add 10 testcases
+  add_testcases(10);
+
+  std::stringstream ss;
+  x64asm::Code target, rewrite;
+
+  ss.clear();
+  ss << ".foo:" << std::endl;
+  ss << "addq %rdi, %rax" << std::endl;
+  ss << "retq" << std::endl;
+  ss >> target;
+
+  ss.clear();
+  ss << ".foo:" << std::endl;
+  ss << "leaq (%rax,%rdi,1), %rax" << std::endl;
+  ss << "retq" << std::endl;
+  ss >> rewrite;
+
+  auto cfg_t = make_cfg(target, x64asm::RegSet::empty() + x64asm::rax + x64asm::rdi);
+  auto cfg_r = make_cfg(rewrite, x64asm::RegSet::empty() + x64asm::rax + x64asm::rdi);
+
+  fxn_.set_target(cfg_t, false, false);
+  fxn_.set_minibatch(3, 1.0).set_seed(1);
+
+  for (size_t i = 0; i < 10; ++i) {
+    auto cost = fxn_(cfg_r);
+    EXPECT_TRUE(cost.first);
+    EXPECT_EQ(0ull, cost.second);
+  }
+}
+
+TEST_F(CorrectnessCostTest, MinibatchNeverAcceptsPartiallyCorrectRewrites) {
+
+  // Only the last two testcases can tell these apart
+  for (uint64_t i = 0; i < 10; ++i) {
+    auto cs = get_state();
+    cs.gp[x64asm::rdi].get_fixed_quad(0) = i;
+    sb_.insert_input(cs);
+  }
+
+  std::stringstream ss;
+  x64asm::Code target, rewrite;
+
+  ss.clear();
+  ss << ".foo:" << std::endl;
+  ss << "movq %rdi, %rax" << std::endl;
+  ss << "retq" << std::endl;
+  ss >> target;
+
+  ss.clear();
+  ss << ".foo:" << std::endl;
+  ss << "movq %rdi, %rax" << std::endl;
+  ss << "andq $0x7, %rax" << std::endl;
+  ss << "retq" << std::endl;
+  ss >> rewrite;
+
+  auto cfg_t = make_cfg(target, x64asm::RegSet::empty() + x64asm::rax + x64asm::rdi);
+  auto cfg_r = make_cfg(rewrite, x64asm::RegSet::empty() + x64asm::rax + x64asm::rdi);
+
+  fxn_.set_target(cfg_t, false, false);
+  fxn_.set_minibatch(2, 0.0).set_seed(1);
+
+  for (size_t i = 0; i < 20; ++i) {
+    auto cost = fxn_(cfg_r);
+    EXPECT_FALSE(cost.first);
+    EXPECT_GT(cost.second, 0ull);
+  }
+  EXPECT_GE(fxn_.get_counter_example().gp[x64asm::rdi].get_fixed_quad(0), 8ull);
+}
+
+TEST_F(CorrectnessCostTest, CutpointsGradeIncorrectLoops) {
+
+  for (uint64_t i = 1; i <= 5; ++i) {
+    auto cs = get_state();
+    cs.gp[x64asm::rdi].get_fixed_quad(0) = i;
+    sb_.insert_input(cs);
+  }
+
+  std::stringstream ss;
+  x64asm::Code target, correct, rewrite;
+
+  ss.clear();
+  ss << ".foo:" << std::endl;
+  ss << "xorq %rax, %rax" << std::endl;
+  ss << ".L1:" << std::endl;
+  ss << "addq %rdi, %rax" << std::endl;
+  ss << "decq %rdi" << std::endl;
+  ss << "jne .L1" << std::endl;
+  ss << "retq" << std::endl;
+  ss >> target;
+
+  ss.clear();
+  ss << ".foo:" << std::endl;
+  ss << "movl $0x0, %eax" << std::endl;
+  ss << ".L1:" << std::endl;
+  ss << "addq %rdi, %rax" << std::endl;
+  ss << "subq $0x1, %rdi" << std::endl;
+  ss << "jne .L1" << std::endl;
+  ss << "retq" << std::endl;
+  ss >> correct;
+
+  ss.clear();
+  ss << ".foo:" << std::endl;
+  ss << "xorq %rax, %rax" << std::endl;
+  ss << ".L1:" << std::endl;
+  ss << "leaq 0x1(%rax,%rdi,1), %rax" << std::endl;
+  ss << "decq %rdi" << std::endl;
+  ss << "jne .L1" << std::endl;
+  ss << "retq" << std::endl;
+  ss >> rewrite;
+
+  const auto rs = x64asm::RegSet::empty() + x64asm::rax + x64asm::rdi;
+  auto cfg_t = make_cfg(target, rs);
+  auto cfg_c = make_cfg(correct, rs);
+  auto cfg_r = make_cfg(rewrite, rs);
+
+  fxn_.set_target(cfg_t, false, false);
+  const auto final_only = fxn_(cfg_r);
+
+  fxn_.set_cutpoints(true).set_target(cfg_t, false, false);
+  const auto cost = fxn_(cfg_c);
+  EXPECT_TRUE(cost.first);
+  EXPECT_EQ(0ull, cost.second);
+
+  const auto graded = fxn_(cfg_r);
+  EXPECT_FALSE(graded.first);
+  EXPECT_GT(graded.second, final_only.second);
+}
+
+TEST_F(CorrectnessCostTest, ReferenceCacheSharesOutputs) {
+
+  add_testcases(8);
+
+  std::stringstream ss;
+  x64asm::Code target, rewrite;
+
+  ss.clear();
+  ss << ".foo:" << std::endl;
+  ss << "movq %rdi, %rax" << std::endl;
+  ss << "addq %rsi, %rax" << std::endl;
+  ss << "retq" << std::endl;
+  ss >> target;
+
+  ss.clear();
+  ss << ".foo:" << std::endl;
+  ss << "leaq (%rdi,%rsi,1), %rax" << std::endl;
+  ss << "retq" << std::endl;
+  ss >> rewrite;
+
+  const auto rs = x64asm::RegSet::empty() + x64asm::rax + x64asm::rdi + x64asm::rsi;
+  auto cfg_t = make_cfg(target, rs);
+  auto cfg_r = make_cfg(rewrite, rs);
+
+  // Keys depend on the target and the inputs, but not on which sandbox holds them
+  Sandbox copy(sb_);
+  const auto key = ReferenceCache::key(cfg_t, sb_);
+  EXPECT_EQ(key, ReferenceCache::key(cfg_t, copy));
+  EXPECT_NE(key, ReferenceCache::key(cfg_r, sb_));
+  copy.insert_input(get_state());
+  EXPECT_NE(key, ReferenceCache::key(cfg_t, copy));
+
+  char dir[] = "/tmp/stoke_reference_cache_XXXXXX";
+  ASSERT_NE(nullptr, mkdtemp(dir));
+
+  ReferenceCache::clear();
+  fxn_.set_reference_cache(true, dir).set_target(cfg_t, false, false);
+
+  // A fresh process would only find the file
+  ReferenceCache::clear();
+  std::vector<CpuState> outs;
+  ASSERT_TRUE(ReferenceCache::lookup(key, dir, sb_.size(), outs));
+  ASSERT_EQ(sb_.size(), outs.size());
+  for (size_t i = 0; i < outs.size(); ++i) {
+    EXPECT_EQ(*(sb_.get_result(i)), outs[i]);
+  }
+  EXPECT_TRUE(fxn_(cfg_r).first);
+
+  Sandbox other(sb_);
+  CorrectnessCost fxn(&other);
+  fxn.set_reference_cache(true, dir).set_target(cfg_t, false, false);
+  const auto cost = fxn(cfg_r);
+  EXPECT_TRUE(cost.first);
+  EXPECT_EQ(0ull, cost.second);
+
+  // Entries of the wrong size and truncated files are misses
+  const auto file = std::string(dir) + "/" + key + ".ref";
+  ReferenceCache::clear();
+  EXPECT_FALSE(ReferenceCache::lookup(key, dir, sb_.size() + 1, outs));
+  ASSERT_EQ(0, truncate(file.c_str(), 32));
+  EXPECT_FALSE(ReferenceCache::lookup(key, dir, sb_.size(), outs));
+
+  unlink(file.c_str());
+  rmdir(dir);
+  ReferenceCache::clear();
+}
+
 } //namespace
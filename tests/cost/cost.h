@@ -12,7 +12,9 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include "tests/cost/avx_transition.h"
 #include "tests/cost/binsize.h"
 #include "tests/cost/correctness.h"
+#include "tests/cost/frontend.h"
 #include "tests/cost/latency.h"
 #include "tests/cost/parser.h"
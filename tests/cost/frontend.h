@@ -0,0 +1,62 @@
+// Copyright 2013-2016 Stanford University
+//
+// Licensed under the Apache License, Version 2.0 (the License);
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an AS IS BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <sstream>
+
+#include "src/cfg/cfg.h"
+#include "src/cost/frontend.h"
+
+namespace stoke {
+
+class FrontEndCostTest : public ::testing::Test {
+
+protected:
+
+  FrontEndCost fxn_;
+
+  Cost cost(std::string s) {
+    x64asm::Code c;
+
+    std::stringstream str;
+    str << ".dummy:" << std::endl;
+    str << s << std::endl;
+    str << "retq" << std::endl;
+    str >> c;
+
+    Cfg cfg(c, x64asm::RegSet::universe(), x64asm::RegSet::empty());
+    return fxn_(cfg).second;
+  }
+
+};
+
+TEST_F(FrontEndCostTest, ShortStraightLine) {
+  EXPECT_EQ(0ul, cost("movq %rax, %rdx"));
+}
+
+TEST_F(FrontEndCostTest, NopsAreIgnored) {
+  EXPECT_EQ(cost("movq %rax, %rdx\nmovq %rdx, %rcx"),
+            cost("movq %rax, %rdx\nnop\nnop\nnop\nmovq %rdx, %rcx"));
+}
+
+TEST_F(FrontEndCostTest, LoopFootprint) {
+  fxn_.set_loop_penalty(5);
+  EXPECT_EQ(5ul, cost(".L0:\ndecq %rcx\njne .L0"));
+}
+
+TEST_F(FrontEndCostTest, UnalignedLoopHead) {
+  fxn_.set_loop_penalty(5);
+  EXPECT_EQ(10ul, cost("movq %rax, %rdx\n.L0:\ndecq %rcx\njne .L0"));
+}
+
+} //namespace stoke
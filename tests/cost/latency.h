@@ -18,6 +18,10 @@
 #include "src/cfg/cfg.h"
 #include "src/cost/cost_function.h"
 #include "src/cost/latency.h"
+#include "src/cost/measured.h"
+#include "src/sandbox/sandbox.h"
+#include "src/state/cpu_state.h"
+#include "src/stategen/stategen.h"
 
 namespace stoke {
 
@@ -101,5 +105,122 @@ TEST_F(LatencyCostTest, NestingDepth0) {
   EXPECT_EQ(2*xorpd, fxn_(cfg).second);
 }
 
+TEST_F(LatencyCostTest, ProfileIgnoresColdBlocks) {
+  x64asm::Code c;
+
+  std::stringstream str;
+  str << ".dummy:" << std::endl;
+  str << "cmpq $0x0, %rdi" << std::endl;
+  str << "je .L1" << std::endl;
+  str << "xorpd %xmm1, %xmm2" << std::endl;
+  str << "xorpd %xmm1, %xmm2" << std::endl;
+  str << "xorpd %xmm1, %xmm2" << std::endl;
+  str << ".L1:" << std::endl;
+  str << "xorpd %xmm1, %xmm2" << std::endl;
+  str << "retq" << std::endl;
+  str >> c;
+
+  Cfg cfg(c, x64asm::RegSet::universe(), x64asm::RegSet::empty());
+
+  // Every testcase takes the branch, so the middle block never runs
+  Sandbox sb;
+  for (size_t i = 0; i < 4; ++i) {
+    CpuState tc;
+    StateGen sg(&sb);
+    sg.get(tc);
+    tc.gp[x64asm::rdi].get_fixed_quad(0) = 0;
+    sb.insert_input(tc);
+  }
+
+  LatencyCost profiled;
+  profiled.set_profile(true).setup_perf_sandbox(&sb);
+
+  const auto xorpd = x64asm::Instruction(x64asm::XORPD_XMM_XMM).haswell_latency();
+  EXPECT_EQ(fxn_(cfg).second - 3*xorpd, profiled(cfg).second);
+}
+
+TEST_F(LatencyCostTest, ProfileFollowsChangedComparisons) {
+  x64asm::Code c;
+
+  std::stringstream str;
+  str << ".dummy:" << std::endl;
+  str << "cmpq $0x0, %rdi" << std::endl;
+  str << "je .L1" << std::endl;
+  str << "xorpd %xmm1, %xmm2" << std::endl;
+  str << ".L1:" << std::endl;
+  str << "xorpd %xmm1, %xmm2" << std::endl;
+  str << "retq" << std::endl;
+  str >> c;
+
+  Cfg cfg(c, x64asm::RegSet::universe(), x64asm::RegSet::empty());
+
+  Sandbox sb;
+  for (size_t i = 0; i < 4; ++i) {
+    CpuState tc;
+    StateGen sg(&sb);
+    sg.get(tc);
+    tc.gp[x64asm::rdi].get_fixed_quad(0) = 0;
+    sb.insert_input(tc);
+  }
+
+  LatencyCost profiled;
+  profiled.set_profile(true).setup_perf_sandbox(&sb);
+
+  // Every testcase takes the branch at first, and none does once the comparison changes
+  const auto xorpd = x64asm::Instruction(x64asm::XORPD_XMM_XMM).haswell_latency();
+  EXPECT_EQ(fxn_(cfg).second - xorpd, profiled(cfg).second);
+
+  std::stringstream cmp;
+  cmp << "cmpq $0x1, %rdi" << std::endl;
+  x64asm::Code replacement;
+  cmp >> replacement;
+  ASSERT_EQ(1ul, replacement.size());
+  cfg.get_function().replace(1, replacement[0], false);
+  cfg.recompute();
+  EXPECT_EQ(fxn_(cfg).second, profiled(cfg).second);
+}
+
+TEST_F(LatencyCostTest, ProfileDoesNotFireMeasuredCallbacks) {
+  x64asm::Code c;
+
+  std::stringstream str;
+  str << ".dummy:" << std::endl;
+  str << "cmpq $0x0, %rdi" << std::endl;
+  str << "je .L1" << std::endl;
+  str << "xorpd %xmm1, %xmm2" << std::endl;
+  str << ".L1:" << std::endl;
+  str << "xorpd %xmm1, %xmm2" << std::endl;
+  str << "retq" << std::endl;
+  str >> c;
+
+  Cfg cfg(c, x64asm::RegSet::universe(), x64asm::RegSet::empty());
+
+  Sandbox sb;
+  for (size_t i = 0; i < 4; ++i) {
+    CpuState tc;
+    StateGen sg(&sb);
+    sg.get(tc);
+    tc.gp[x64asm::rdi].get_fixed_quad(0) = i % 2;
+    sb.insert_input(tc);
+  }
+
+  // As in "latency + measured", both share one performance sandbox
+  LatencyCost profiled;
+  profiled.set_profile(true).setup_perf_sandbox(&sb);
+  MeasuredCost measured;
+  measured.setup_perf_sandbox(&sb);
+
+  sb.insert_function(cfg);
+  sb.set_entrypoint(cfg.get_code()[0].get_operand<x64asm::Label>(0));
+  sb.run();
+  const auto once = measured(cfg).second;
+
+  // Profiling a new control flow must not count as another run
+  sb.run();
+  profiled(cfg);
+  EXPECT_EQ(once, measured(cfg).second);
+  sb.run();
+  EXPECT_EQ(once, measured(cfg).second);
+}
 
 } //namespace stoke
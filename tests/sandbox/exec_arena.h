@@ -0,0 +1,72 @@
+// Copyright 2013-2016 Stanford University
+//
+// Licensed under the Apache License, Version 2.0 (the License);
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an AS IS BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <sstream>
+#include <vector>
+
+#include "src/ext/x64asm/include/x64asm.h"
+#include "src/sandbox/exec_arena.h"
+
+namespace stoke {
+
+TEST(ExecArenaTest, CopiedCodeRuns) {
+  std::stringstream ss;
+  ss << "movl $0x2a, %eax" << std::endl;
+  ss << "retq" << std::endl;
+
+  x64asm::Code c;
+  ss >> c;
+  ASSERT_FALSE(cpputil::failed(ss)) << cpputil::fail_msg(ss);
+
+  x64asm::Assembler assm;
+  const auto fxn = assm.assemble(c).second;
+
+  ExecArena arena;
+  auto entry = arena.insert(fxn);
+  ASSERT_NE(nullptr, entry);
+
+  EXPECT_EQ(42ull, ((uint64_t(*)())entry)());
+}
+
+TEST(ExecArenaTest, PacksFunctionsContiguously) {
+  std::stringstream ss;
+  ss << "retq" << std::endl;
+
+  x64asm::Code c;
+  ss >> c;
+  ASSERT_FALSE(cpputil::failed(ss)) << cpputil::fail_msg(ss);
+
+  x64asm::Assembler assm;
+  const auto fxn = assm.assemble(c).second;
+
+  ExecArena arena;
+  std::vector<uint8_t*> entries;
+  for (size_t i = 0; i < 1000; ++i) {
+    entries.push_back((uint8_t*)arena.insert(fxn));
+  }
+
+  // Each function starts on the next 16-byte boundary
+  for (size_t i = 1; i < entries.size(); ++i) {
+    EXPECT_EQ(entries[i-1] + 16, entries[i]);
+  }
+  EXPECT_EQ(1ul, arena.num_chunks());
+  EXPECT_EQ(999ul * 16 + 1, arena.size());
+
+  // Clearing keeps the first chunk and starts over at its beginning
+  arena.clear();
+  EXPECT_EQ(0ul, arena.size());
+  EXPECT_EQ(entries[0], arena.insert(fxn));
+}
+
+} // namespace stoke
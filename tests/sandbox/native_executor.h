@@ -0,0 +1,250 @@
+// Copyright 2013-2016 Stanford University
+//
+// Licensed under the Apache License, Version 2.0 (the License);
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an AS IS BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <sstream>
+
+#include "src/cfg/cfg.h"
+#include "src/sandbox/sandbox.h"
+#include "src/state/cpu_state.h"
+
+namespace stoke {
+
+class NativeExecutorTest : public ::testing::Test {
+protected:
+  /** Returns a testcase with a fully valid stack and heap at typical addresses. */
+  CpuState make_testcase() {
+    CpuState tc;
+    tc.stack.resize(0x7ffe00001000, 0x1000);
+    for (uint64_t i = 0x7ffe00001000; i < 0x7ffe00002000; ++i) {
+      tc.stack.set_valid(i, true);
+      tc.stack[i] = i & 0xff;
+    }
+    tc.heap.resize(0x10000000, 0x40);
+    for (uint64_t i = 0x10000000; i < 0x10000040; ++i) {
+      tc.heap.set_valid(i, true);
+      tc.heap[i] = 0x10;
+    }
+    tc.gp[x64asm::rsp].get_fixed_quad(0) = 0x7ffe00001800;
+    tc.gp[x64asm::rdi].get_fixed_quad(0) = 0x10000000;
+    return tc;
+  }
+
+  Cfg make_cfg(const std::string& s) {
+    std::stringstream ss(s);
+    x64asm::Code c;
+    ss >> c;
+    EXPECT_FALSE(cpputil::failed(ss)) << cpputil::fail_msg(ss);
+    return Cfg(TUnit(c));
+  }
+};
+
+TEST_F(NativeExecutorTest, MatchesSandbox) {
+  const auto cfg = make_cfg(
+                     ".foo:\n"
+                     "movq (%rdi), %rax\n"
+                     "addq $0x1, %rax\n"
+                     "movq %rax, -0x8(%rsp)\n"
+                     "pushq %rax\n"
+                     "popq %rcx\n"
+                     "movq %rcx, 0x8(%rdi)\n"
+                     "retq\n");
+  const auto tc = make_testcase();
+
+  Sandbox expected;
+  expected.insert_input(tc);
+  expected.run(cfg);
+
+  Sandbox actual;
+  actual.set_native(true);
+  actual.insert_input(tc);
+  actual.run(cfg);
+
+  ASSERT_EQ(ErrorCode::NORMAL, expected.get_output(0)->code);
+  EXPECT_EQ(*expected.get_output(0), *actual.get_output(0));
+  EXPECT_EQ(1u, actual.get_native()->get_runs());
+}
+
+TEST_F(NativeExecutorTest, InvalidPageFaults) {
+  const auto cfg = make_cfg(
+                     ".foo:\n"
+                     "movq (%rdi), %rax\n"
+                     "retq\n");
+  auto tc = make_testcase();
+  tc.data.resize(0x20000000, 0x2000);
+  for (uint64_t i = 0x20000000; i < 0x20001000; ++i) {
+    tc.data.set_valid(i, true);
+  }
+  tc.gp[x64asm::rdi].get_fixed_quad(0) = 0x20001800;
+
+  Sandbox sb;
+  sb.set_native(true);
+  sb.insert_input(tc);
+  sb.run(cfg);
+
+  EXPECT_EQ(ErrorCode::SIGSEGV_, sb.get_output(0)->code);
+  EXPECT_EQ(1u, sb.get_native()->get_runs());
+}
+
+TEST_F(NativeExecutorTest, InvalidWriteFaults) {
+  const auto cfg = make_cfg(
+                     ".foo:\n"
+                     "movq $0x1, 0x8(%rdi)\n"
+                     "retq\n");
+  auto tc = make_testcase();
+  for (uint64_t i = 0x10000008; i < 0x10000010; ++i) {
+    tc.heap.set_valid(i, false);
+  }
+
+  Sandbox sb;
+  sb.set_native(true);
+  sb.insert_input(tc);
+  sb.run(cfg);
+
+  EXPECT_EQ(ErrorCode::SIGSEGV_, sb.get_output(0)->code);
+  EXPECT_EQ(1u, sb.get_native()->get_runs());
+}
+
+TEST_F(NativeExecutorTest, DivideByZeroFails) {
+  const auto cfg = make_cfg(
+                     ".foo:\n"
+                     "xorq %rcx, %rcx\n"
+                     "divq %rcx\n"
+                     "retq\n");
+
+  Sandbox sb;
+  sb.set_native(true);
+  sb.insert_input(make_testcase());
+  sb.run(cfg);
+
+  EXPECT_EQ(ErrorCode::SIGFPE_, sb.get_output(0)->code);
+  EXPECT_EQ(1u, sb.get_native()->get_runs());
+}
+
+TEST_F(NativeExecutorTest, HelperIsReused) {
+  const auto cfg = make_cfg(
+                     ".foo:\n"
+                     "movq (%rdi), %rax\n"
+                     "retq\n");
+
+  Sandbox sb;
+  sb.set_native(true);
+  sb.insert_input(make_testcase());
+  sb.insert_input(make_testcase());
+  for (size_t i = 0; i < 10; ++i) {
+    sb.run(cfg);
+  }
+
+  EXPECT_EQ(20u, sb.get_native()->get_runs());
+  EXPECT_EQ(1u, sb.get_native()->get_helper_starts());
+}
+
+TEST_F(NativeExecutorTest, StrayWriteToHelperFaults) {
+  const auto cfg = make_cfg(
+                     ".foo:\n"
+                     "movq $0x1, (%rsi)\n"
+                     "retq\n");
+  // The helper is forked from this process, so this address is writable there too
+  auto target = new uint64_t(0);
+  auto tc = make_testcase();
+  tc.gp[x64asm::rsi].get_fixed_quad(0) = (uint64_t)target;
+
+  Sandbox sb;
+  sb.set_native(true);
+  sb.insert_input(tc);
+  sb.run(cfg);
+
+  EXPECT_EQ(ErrorCode::SIGSEGV_, sb.get_output(0)->code);
+  EXPECT_EQ(1u, sb.get_native()->get_runs());
+  delete target;
+}
+
+TEST_F(NativeExecutorTest, LoopingCodeMatchesSandbox) {
+  const auto cfg = make_cfg(
+                     ".foo:\n"
+                     "movq $0x100000, %rcx\n"
+                     ".L1:\n"
+                     "decq %rcx\n"
+                     "jne .L1\n"
+                     "retq\n");
+  const auto tc = make_testcase();
+
+  Sandbox expected;
+  expected.set_max_jumps(16);
+  expected.insert_input(tc);
+  expected.run(cfg);
+
+  Sandbox actual;
+  actual.set_max_jumps(16);
+  actual.set_native(true);
+  actual.insert_input(tc);
+  actual.run(cfg);
+
+  ASSERT_EQ(ErrorCode::SIGCUSTOM_EXCEEDED_MAX_JUMPS, expected.get_output(0)->code);
+  EXPECT_EQ(*expected.get_output(0), *actual.get_output(0));
+  EXPECT_EQ(0u, actual.get_native()->get_runs());
+}
+
+TEST_F(NativeExecutorTest, ForwardJumpsRunNatively) {
+  const auto cfg = make_cfg(
+                     ".foo:\n"
+                     "movq (%rdi), %rax\n"
+                     "testq %rax, %rax\n"
+                     "je .L1\n"
+                     "addq $0x1, %rax\n"
+                     ".L1:\n"
+                     "retq\n");
+  const auto tc = make_testcase();
+
+  Sandbox expected;
+  expected.insert_input(tc);
+  expected.run(cfg);
+
+  Sandbox actual;
+  actual.set_native(true);
+  actual.insert_input(tc);
+  actual.run(cfg);
+
+  ASSERT_EQ(ErrorCode::NORMAL, expected.get_output(0)->code);
+  EXPECT_EQ(*expected.get_output(0), *actual.get_output(0));
+  EXPECT_EQ(1u, actual.get_native()->get_jumps());
+  EXPECT_EQ(1u, actual.get_native()->get_runs());
+}
+
+TEST_F(NativeExecutorTest, TooManyJumpsMatchesSandbox) {
+  const auto cfg = make_cfg(
+                     ".foo:\n"
+                     "jmpq .L1\n"
+                     ".L1:\n"
+                     "jmpq .L2\n"
+                     ".L2:\n"
+                     "retq\n");
+  const auto tc = make_testcase();
+
+  Sandbox expected;
+  expected.set_max_jumps(2);
+  expected.insert_input(tc);
+  expected.run(cfg);
+
+  Sandbox actual;
+  actual.set_max_jumps(2);
+  actual.set_native(true);
+  actual.insert_input(tc);
+  actual.run(cfg);
+
+  EXPECT_EQ(*expected.get_output(0), *actual.get_output(0));
+  EXPECT_EQ(0u, actual.get_native()->get_runs());
+}
+
+} // namespace stoke
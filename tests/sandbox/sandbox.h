@@ -303,6 +303,82 @@ TEST(SandboxTest, DivideByZeroFails) {
   ASSERT_EQ(ErrorCode::SIGFPE_, sb.result_begin()->code);
 }
 
+TEST(SandboxTest, RunContinuesAfterDivideByZero) {
+
+  x64asm::Code c;
+  std::stringstream ss;
+
+  // Here's the input program
+  ss << ".foo:" << std::endl;
+  ss << "divq %rcx" << std::endl;
+  ss << "addq $0x8, %rdx" << std::endl;
+  ss << "retq" << std::endl;
+
+  ss >> c;
+
+  // Every other input divides by zero
+  Sandbox sb;
+  for (size_t i = 0; i < 5; ++i) {
+    CpuState tc;
+    tc.gp[x64asm::rcx].get_fixed_quad(0) = (i % 2 == 0) ? 1 : 0;
+    sb.insert_input(tc);
+  }
+
+  sb.run(Cfg(TUnit(c)));
+
+  for (size_t i = 0; i < 5; ++i) {
+    if (i % 2 == 0) {
+      EXPECT_EQ(ErrorCode::NORMAL, sb.get_result(i)->code);
+      EXPECT_EQ(8ull, sb.get_result(i)->gp[x64asm::rdx].get_fixed_quad(0));
+    } else {
+      EXPECT_EQ(ErrorCode::SIGFPE_, sb.get_result(i)->code);
+    }
+  }
+}
+
+bool stop_after_second_input(size_t index, void* arg) {
+  (*(std::vector<size_t>*)arg).push_back(index);
+  return index == 1;
+}
+
+TEST(SandboxTest, StopCallbackEndsRunEarly) {
+
+  x64asm::Code c;
+  std::stringstream ss;
+
+  // Here's the input program
+  ss << ".foo:" << std::endl;
+  ss << "incq %rcx" << std::endl;
+  ss << "retq" << std::endl;
+
+  ss >> c;
+
+  Sandbox sb;
+  for (size_t i = 0; i < 5; ++i) {
+    sb.insert_input(CpuState());
+  }
+
+  std::vector<size_t> seen;
+  sb.insert_function(Cfg(TUnit(c)));
+  sb.set_stop_callback(stop_after_second_input, &seen);
+  sb.run();
+
+  ASSERT_EQ(2ul, seen.size());
+  EXPECT_EQ(0ul, seen[0]);
+  EXPECT_EQ(1ul, seen[1]);
+  EXPECT_EQ(1ull, sb.get_result(1)->gp[x64asm::rcx].get_fixed_quad(0));
+
+  // Without the callback everything runs again
+  seen.clear();
+  sb.set_stop_callback(nullptr, nullptr);
+  sb.run();
+
+  EXPECT_TRUE(seen.empty());
+  for (size_t i = 0; i < 5; ++i) {
+    EXPECT_EQ(1ull, sb.get_result(i)->gp[x64asm::rcx].get_fixed_quad(0));
+  }
+}
+
 TEST(SandboxTest, InfiniteLoopFails) {
 
   x64asm::Code c;
@@ -1128,4 +1204,62 @@ TEST(SandboxTest, DivideBySpl1) {
 
 }
 
+TEST(SandboxTest, SnapshotsResumeWhereCodeChanges) {
+  std::stringstream ss;
+  ss << ".foo:" << std::endl;
+  ss << "movq %rdi, %rax" << std::endl;
+  ss << "addq %rsi, %rax" << std::endl;
+  ss << "movq %rax, -8(%rsp)" << std::endl;
+  ss << "imulq %rdi, %rax" << std::endl;
+  ss << "xorq -8(%rsp), %rax" << std::endl;
+  ss << "incq %rax" << std::endl;
+  ss << "retq" << std::endl;
+
+  Code c;
+  ss >> c;
+  Cfg accepted(TUnit(c), RegSet::universe(), RegSet::universe());
+
+  // The same up to the last instruction before the return
+  c[6] = Instruction(DEC_R64, {rax});
+  Cfg late(TUnit(c), RegSet::universe(), RegSet::universe());
+  // Different from the start
+  c[1] = Instruction(MOV_R64_R64, {rax, rsi});
+  Cfg early(TUnit(c), RegSet::universe(), RegSet::universe());
+
+  Sandbox sb;
+  sb.set_snapshot_interval(2);
+  Sandbox reference;
+  StateGen sg(&sb);
+  for (size_t i = 0; i < 8; ++i) {
+    CpuState tc;
+    ASSERT_TRUE(sg.get(tc)) << sg.get_error();
+    sb.insert_input(tc);
+    reference.insert_input(tc);
+  }
+
+  sb.take_snapshots(accepted);
+  EXPECT_EQ(3ul, sb.get_num_snapshots());
+  for (const auto& cfg : {
+         late, early, accepted
+       }) {
+    sb.run(cfg);
+    reference.run(cfg);
+    for (size_t i = 0; i < sb.size(); ++i) {
+      EXPECT_EQ(*reference.get_output(i), *sb.get_output(i));
+    }
+  }
+
+  sb.insert_function(late);
+  EXPECT_EQ(3ul, sb.get_resume_point());
+  sb.insert_function(early);
+  EXPECT_EQ(0ul, sb.get_resume_point());
+
+  // New inputs don't have snapshots
+  CpuState tc;
+  ASSERT_TRUE(sg.get(tc)) << sg.get_error();
+  sb.insert_input(tc);
+  sb.insert_function(late);
+  EXPECT_EQ(0ul, sb.get_resume_point());
+}
+
 } //namespace
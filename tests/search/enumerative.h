@@ -0,0 +1,151 @@
+// Copyright 2013-2016 Stanford University
+//
+// Licensed under the Apache License, Version 2.0 (the License);
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an AS IS BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef _STOKE_TEST_SEARCH_ENUMERATIVE_H
+#define _STOKE_TEST_SEARCH_ENUMERATIVE_H
+
+#include "src/cost/correctness.h"
+#include "src/search/enumerative.h"
+#include "src/stategen/stategen.h"
+#include "src/transform/pools.h"
+
+namespace stoke {
+
+TEST(EnumerativeSearchTest, FindsShortestRewrite) {
+
+  std::stringstream ss;
+  ss << ".foo:" << std::endl;
+  ss << "movq %rdi, %rax" << std::endl;
+  ss << "addq %rax, %rax" << std::endl;
+  ss << "addq %rdi, %rax" << std::endl;
+  ss << "subq %rdi, %rax" << std::endl;
+  ss << "retq" << std::endl;
+
+  TUnit fxn;
+  ss >> fxn;
+  Cfg target(fxn, x64asm::RegSet::empty() + x64asm::rdi, x64asm::RegSet::empty() + x64asm::rax);
+
+  Sandbox sb;
+  StateGen sg(&sb);
+  for (size_t i = 0; i < 8; ++i) {
+    CpuState cs;
+    sg.get(cs);
+    sb.insert_input(cs);
+  }
+
+  CorrectnessCost fxn_cost(&sb);
+  fxn_cost.set_target(target, false, false);
+
+  TransformPools pools;
+  pools.insert_opcode(x64asm::MOV_R64_R64)
+  .insert_opcode(x64asm::ADD_R64_R64)
+  .insert_opcode(x64asm::SHL_R64_IMM8);
+  pools.recompute_pools();
+
+  EnumerativeSearch search(pools);
+  search.set_max_length(2);
+
+  SearchState state(target, target, Init::EMPTY, 0);
+  search.run(target, fxn_cost, sb, state);
+
+  ASSERT_TRUE(state.success);
+  EXPECT_EQ(0ul, state.best_correct_cost);
+  // Two instructions, plus the label and the return
+  EXPECT_EQ(4ul, state.best_correct.get_code().size()) << state.best_correct.get_code();
+  EXPECT_GT(search.get_iterations(), 0ul);
+}
+
+TEST(EnumerativeSearchTest, GivesUpPastMaxLength) {
+
+  std::stringstream ss;
+  ss << ".foo:" << std::endl;
+  ss << "movq %rdi, %rax" << std::endl;
+  ss << "shlq $0x3, %rax" << std::endl;
+  ss << "retq" << std::endl;
+
+  TUnit fxn;
+  ss >> fxn;
+  Cfg target(fxn, x64asm::RegSet::empty() + x64asm::rdi, x64asm::RegSet::empty() + x64asm::rax);
+
+  Sandbox sb;
+  StateGen sg(&sb);
+  for (size_t i = 0; i < 8; ++i) {
+    CpuState cs;
+    sg.get(cs);
+    sb.insert_input(cs);
+  }
+
+  CorrectnessCost fxn_cost(&sb);
+  fxn_cost.set_target(target, false, false);
+
+  // Without a shift this takes four instructions
+  TransformPools pools;
+  pools.insert_opcode(x64asm::MOV_R64_R64)
+  .insert_opcode(x64asm::ADD_R64_R64);
+  pools.recompute_pools();
+
+  EnumerativeSearch search(pools);
+  search.set_max_length(2);
+
+  SearchState state(target, target, Init::EMPTY, 0);
+  search.run(target, fxn_cost, sb, state);
+
+  EXPECT_FALSE(state.success);
+}
+
+TEST(EnumerativeSearchTest, ExtendsCheapestPrograms) {
+
+  std::stringstream ss;
+  ss << ".foo:" << std::endl;
+  ss << "movq %rdi, %rax" << std::endl;
+  ss << "shlq $0x1, %rax" << std::endl;
+  ss << "retq" << std::endl;
+
+  TUnit fxn;
+  ss >> fxn;
+  Cfg target(fxn, x64asm::RegSet::empty() + x64asm::rdi, x64asm::RegSet::empty() + x64asm::rax);
+
+  Sandbox sb;
+  StateGen sg(&sb);
+  for (size_t i = 0; i < 8; ++i) {
+    CpuState cs;
+    sg.get(cs);
+    sb.insert_input(cs);
+  }
+
+  CorrectnessCost fxn_cost(&sb);
+  fxn_cost.set_target(target, false, false);
+
+  TransformPools pools;
+  pools.insert_opcode(x64asm::MOV_R64_R64)
+  .insert_opcode(x64asm::ADD_R64_R64);
+  pools.recompute_pools();
+
+  // Only the single cheapest program of length one survives to be extended
+  EnumerativeSearch search(pools);
+  search.set_max_length(2);
+  search.set_max_programs(1);
+
+  SearchState state(target, target, Init::EMPTY, 0);
+  search.run(target, fxn_cost, sb, state);
+
+  ASSERT_TRUE(state.success);
+  EXPECT_EQ(0ul, state.best_correct_cost);
+  EXPECT_EQ(4ul, state.best_correct.get_code().size()) << state.best_correct.get_code();
+}
+
+} //namespace stoke
+
+#endif
@@ -0,0 +1,138 @@
+// Copyright 2013-2016 Stanford University
+//
+// Licensed under the Apache License, Version 2.0 (the License);
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an AS IS BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef _STOKE_TEST_SEARCH_METRICS_STREAM_H
+#define _STOKE_TEST_SEARCH_METRICS_STREAM_H
+
+#include <fstream>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "src/search/metrics_stream.h"
+
+namespace stoke {
+
+class MetricsStreamTest : public ::testing::Test {
+
+protected:
+
+  void SetUp() {
+    char path[] = "/tmp/stoke_metrics_XXXXXX";
+    const auto fd = mkstemp(path);
+    ASSERT_NE(-1, fd);
+    close(fd);
+    path_ = path;
+  }
+
+  void TearDown() {
+    unlink(path_.c_str());
+  }
+
+  /** Writes a record with these statistics. */
+  void write(MetricsStream& ms, size_t iterations, double elapsed, Cost best,
+             const std::vector<std::pair<std::string, double>>& extras = {}) {
+    const StatisticsCallbackData data {
+      move_statistics_, iterations, std::chrono::duration<double>(elapsed), nullptr,
+      std::chrono::duration<double>(0), std::chrono::duration<double>(0), std::chrono::duration<double>(0),
+      best + 1, best, best + 2
+    };
+    ms.write(data, extras);
+    EXPECT_FALSE(ms.has_error()) << ms.get_error();
+  }
+
+  std::string path_;
+  std::vector<Statistics> move_statistics_;
+};
+
+TEST_F(MetricsStreamTest, SummarizesInterleavedRuns) {
+  MetricsStream a;
+  MetricsStream b;
+  ASSERT_TRUE(a.open(path_)) << a.get_error();
+  ASSERT_TRUE(b.open(path_)) << b.get_error();
+  a.set_run_id("a");
+  b.set_run_id("b \"quoted\"");
+
+  write(a, 10, 1.0, 50);
+  write(b, 20, 2.0, 40);
+  write(a, 30, 3.0, 50);
+  // A new search cycle restarts the elapsed time
+  write(b, 5, 0.5, 40);
+  write(a, 40, 4.0, 20, {{"verifications", 3}, {"final", 1}});
+  a.close();
+  b.close();
+
+  std::ifstream ifs(path_);
+  std::string line;
+  size_t lines = 0;
+  while (std::getline(ifs, line)) {
+    ++lines;
+  }
+  EXPECT_EQ(5u, lines);
+
+  ifs.clear();
+  ifs.seekg(0);
+  MetricsSummary summary;
+  summary.read(ifs);
+  const auto& runs = summary.get_runs();
+  ASSERT_EQ(2u, runs.size());
+
+  const auto& ra = runs.at("a");
+  EXPECT_EQ(40, ra.iterations);
+  EXPECT_EQ(4.0, ra.elapsed);
+  EXPECT_EQ(10, ra.iterations_per_sec);
+  EXPECT_EQ(21, ra.current_cost);
+  EXPECT_EQ(20, ra.best_yet_cost);
+  EXPECT_EQ(22, ra.best_correct_cost);
+  EXPECT_EQ(3, ra.verifications);
+  EXPECT_EQ(4.0, ra.improved);
+  EXPECT_TRUE(ra.final);
+
+  const auto& rb = runs.at("b \"quoted\"");
+  EXPECT_EQ(5, rb.iterations);
+  EXPECT_EQ(40, rb.best_yet_cost);
+  EXPECT_EQ(0.5, rb.improved);
+  EXPECT_FALSE(rb.final);
+}
+
+TEST_F(MetricsStreamTest, ImprovementIsTrackedUntilFinal) {
+  MetricsStream ms;
+  ASSERT_TRUE(ms.open(path_)) << ms.get_error();
+  ms.set_run_id("run");
+
+  write(ms, 10, 1.0, 50);
+  write(ms, 20, 2.0, 30);
+  write(ms, 30, 3.0, 30);
+
+  MetricsSummary summary;
+  std::ifstream ifs(path_);
+  summary.read(ifs);
+  const auto& r = summary.get_runs().at("run");
+  EXPECT_EQ(2.0, r.improved);
+  EXPECT_EQ(3.0, r.elapsed);
+  EXPECT_FALSE(r.final);
+
+  // Records appended after the ones already read update the same run
+  write(ms, 40, 4.0, 30, {{"final", 1}});
+  ms.close();
+  ifs.clear();
+  summary.read(ifs);
+  EXPECT_EQ(1u, summary.get_runs().size());
+  EXPECT_TRUE(summary.get_runs().at("run").final);
+  EXPECT_EQ(2.0, summary.get_runs().at("run").improved);
+}
+
+} // namespace stoke
+
+#endif
@@ -0,0 +1,135 @@
+// Copyright 2013-2016 Stanford University
+//
+// Licensed under the Apache License, Version 2.0 (the License);
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an AS IS BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef _STOKE_TEST_SEARCH_PARETO_ARCHIVE_H
+#define _STOKE_TEST_SEARCH_PARETO_ARCHIVE_H
+
+#include "src/cost/cost_function.h"
+#include "src/cost/size.h"
+#include "src/search/pareto_archive.h"
+
+namespace stoke {
+
+class ParetoArchiveTest : public ::testing::Test {
+
+protected:
+
+  /** Counts multiplications, standing in for a cost that disagrees with size. */
+  class MultiplyCost : public CostFunction {
+  public:
+    result_type operator()(const Cfg& cfg, Cost max = max_cost) {
+      Cost count = 0;
+      for (const auto& instr : cfg.get_code()) {
+        count += instr.get_opcode() == x64asm::IMUL_R64_R64_IMM32;
+      }
+      return result_type(true, count);
+    }
+  };
+
+  void SetUp() {
+    archive.add_objective("size", &size).add_objective("multiplies", &multiplies);
+  }
+
+  /** Builds a function computing rax from rdi. */
+  Cfg make_cfg(const std::string& body) {
+    std::stringstream ss;
+    ss << ".foo:" << std::endl << body << "retq" << std::endl;
+    TUnit fxn;
+    ss >> fxn;
+    return Cfg(fxn, x64asm::RegSet::empty() + x64asm::rdi, x64asm::RegSet::empty() + x64asm::rax);
+  }
+
+  SizeCost size;
+  MultiplyCost multiplies;
+  ParetoArchive archive;
+
+  const std::string imul = "imulq $0x3, %rdi, %rax\n";
+  const std::string adds = "movq %rdi, %rax\naddq %rax, %rax\naddq %rdi, %rax\n";
+  const std::string lea = "leaq (%rdi,%rdi,2), %rax\n";
+};
+
+TEST_F(ParetoArchiveTest, KeepsTradeOffs) {
+  EXPECT_TRUE(archive.insert(make_cfg(imul)));
+  EXPECT_TRUE(archive.insert(make_cfg(adds)));
+  ASSERT_EQ(2ul, archive.size());
+
+  EXPECT_EQ(std::vector<Cost>({1, 1}), archive.get_entries()[0].costs);
+  EXPECT_EQ(std::vector<Cost>({3, 0}), archive.get_entries()[1].costs);
+}
+
+TEST_F(ParetoArchiveTest, RejectsDuplicatesAndDominated) {
+  EXPECT_TRUE(archive.insert(make_cfg(imul)));
+  EXPECT_TRUE(archive.insert(make_cfg(adds)));
+
+  // The same code once nops are removed
+  EXPECT_FALSE(archive.insert(make_cfg(adds + "nop\nnop\n")));
+  // Worse than the multiplication on both counts
+  EXPECT_FALSE(archive.insert(make_cfg(imul + "movq %rax, %rax\n")));
+  EXPECT_EQ(2ul, archive.size());
+
+  // Better than both
+  EXPECT_TRUE(archive.insert(make_cfg(lea)));
+  ASSERT_EQ(1ul, archive.size());
+  EXPECT_EQ(std::vector<Cost>({1, 0}), archive.get_entries()[0].costs);
+}
+
+TEST_F(ParetoArchiveTest, EvaluatesRepeatsOnce) {
+  size_t calls = 0;
+  class CountingCost : public CostFunction {
+  public:
+    CountingCost(size_t* calls) : calls_(calls) {}
+    result_type operator()(const Cfg& cfg, Cost max = max_cost) {
+      ++*calls_;
+      return result_type(true, 0);
+    }
+  private:
+    size_t* calls_;
+  } counting(&calls);
+
+  ParetoArchive archive;
+  archive.add_objective("counting", &counting);
+  EXPECT_TRUE(archive.insert(make_cfg(imul)));
+  // Ties with the first, so it isn't kept; repeats of either aren't evaluated again
+  EXPECT_FALSE(archive.insert(make_cfg(adds)));
+  EXPECT_FALSE(archive.insert(make_cfg("nop\n" + adds)));
+  EXPECT_FALSE(archive.insert(make_cfg(imul + "nop\n")));
+  EXPECT_EQ(2ul, calls);
+
+  archive.clear();
+  EXPECT_TRUE(archive.insert(make_cfg(adds)));
+  EXPECT_EQ(3ul, calls);
+}
+
+TEST_F(ParetoArchiveTest, StaysWithinCapacity) {
+  archive.set_capacity(1);
+  EXPECT_TRUE(archive.insert(make_cfg(imul)));
+  EXPECT_FALSE(archive.insert(make_cfg(adds)));
+  ASSERT_EQ(1ul, archive.size());
+  EXPECT_EQ(std::vector<Cost>({1, 1}), archive.get_entries()[0].costs);
+}
+
+TEST_F(ParetoArchiveTest, WritesCosts) {
+  archive.insert(make_cfg(imul));
+
+  std::stringstream ss;
+  archive.write(ss);
+  EXPECT_NE(std::string::npos, ss.str().find("\"objectives\": [\"size\", \"multiplies\"]"));
+  EXPECT_NE(std::string::npos, ss.str().find("\"costs\": {\"size\": 1, \"multiplies\": 1}"));
+  EXPECT_NE(std::string::npos, ss.str().find("imulq"));
+}
+
+} // namespace stoke
+
+#endif
@@ -0,0 +1,91 @@
+// Copyright 2013-2016 Stanford University
+//
+// Licensed under the Apache License, Version 2.0 (the License);
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an AS IS BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <sstream>
+
+#include "src/search/window_partition.h"
+
+namespace stoke {
+
+class WindowPartitionTest : public ::testing::Test {
+protected:
+  Cfg make_cfg() {
+    std::stringstream ss;
+    ss << ".foo:" << std::endl;
+    ss << "movq %rdi, %rax" << std::endl;
+    ss << "addq %rsi, %rax" << std::endl;
+    ss << "shlq $0x1, %rax" << std::endl;
+    ss << "cmpq $0x0, %rax" << std::endl;
+    ss << "je .L1" << std::endl;
+    ss << "incq %rax" << std::endl;
+    ss << ".L1:" << std::endl;
+    ss << "retq" << std::endl;
+
+    x64asm::Code code;
+    ss >> code;
+
+    const auto def_ins = x64asm::RegSet::empty() + x64asm::rdi + x64asm::rsi;
+    const auto live_outs = x64asm::RegSet::empty() + x64asm::rax;
+    return Cfg(TUnit(code), def_ins, live_outs);
+  }
+};
+
+TEST_F(WindowPartitionTest, SplitsOnControlFlow) {
+  const auto cfg = make_cfg();
+  const auto windows = WindowPartition()(cfg);
+
+  // The lone incq is shorter than the minimum window size.
+  ASSERT_EQ(1ul, windows.size());
+  EXPECT_EQ(1ul, windows[0].begin);
+  EXPECT_EQ(5ul, windows[0].end);
+  EXPECT_TRUE(windows[0].live_outs.contains(x64asm::rax));
+}
+
+TEST_F(WindowPartitionTest, RespectsMaxSize) {
+  const auto cfg = make_cfg();
+  const auto windows = WindowPartition().set_max_size(2)(cfg);
+
+  ASSERT_EQ(2ul, windows.size());
+  EXPECT_EQ(1ul, windows[0].begin);
+  EXPECT_EQ(3ul, windows[0].end);
+  EXPECT_EQ(3ul, windows[1].begin);
+  EXPECT_EQ(5ul, windows[1].end);
+}
+
+TEST_F(WindowPartitionTest, ExtractAndStitch) {
+  const auto cfg = make_cfg();
+  const auto windows = WindowPartition().set_max_size(2)(cfg);
+  ASSERT_EQ(2ul, windows.size());
+
+  const auto extracted = WindowPartition::extract(cfg, windows[0], x64asm::Label(".w"));
+  ASSERT_EQ(4ul, extracted.get_code().size());
+  EXPECT_TRUE(extracted.get_code()[0].is_label_defn());
+  EXPECT_TRUE(extracted.get_code()[3].is_any_return());
+
+  std::stringstream ss;
+  ss << ".w:" << std::endl;
+  ss << "leaq (%rdi,%rsi,1), %rax" << std::endl;
+  ss << "nop" << std::endl;
+  ss << "retq" << std::endl;
+  x64asm::Code code;
+  ss >> code;
+  const Cfg rewrite(TUnit(code), windows[0].def_ins, windows[0].live_outs);
+
+  const auto res = WindowPartition::stitch(cfg, {windows[0]}, {rewrite});
+  ASSERT_EQ(cfg.get_code().size() - 1, res.get_code().size());
+  EXPECT_EQ(code[1], res.get_code()[1]);
+  EXPECT_EQ(cfg.get_code()[3], res.get_code()[2]);
+}
+
+} // namespace stoke
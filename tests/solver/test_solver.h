@@ -111,13 +111,13 @@ public:
     return cpputil::BitVector(n);
   }
 
-  std::pair<std::map<uint64_t,cpputil::BitVector>, uint8_t> get_model_array(const std::string& s, uint16_t n, uint16_t m) {
+  std::pair<std::map<uint64_t,cpputil::BitVector>, uint64_t> get_model_array(const std::string& s, uint16_t n, uint16_t m) {
     for (auto it : solvers_) {
       if (it->has_model() && !it->has_error()) {
         return it->get_model_array(s, n, m);
       }
     }
-    return std::pair<std::map<uint64_t,cpputil::BitVector>, uint8_t>();
+    return std::pair<std::map<uint64_t,cpputil::BitVector>, uint64_t>();
   }
 
 
@@ -0,0 +1,106 @@
+// Copyright 2013-2016 Stanford University
+//
+// Licensed under the Apache License, Version 2.0 (the License);
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an AS IS BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <sstream>
+
+#include "src/ext/x64asm/include/x64asm.h"
+#include "src/cfg/cfg.h"
+#include "src/sandbox/sandbox.h"
+#include "src/state/cpu_states_parser.h"
+#include "src/stategen/stategen.h"
+
+namespace stoke {
+
+class CpuStatesParserTest : public ::testing::Test {
+protected:
+  void SetUp() {
+    Sandbox sb;
+
+    x64asm::Code code{{x64asm::LABEL_DEFN, {x64asm::Label{".foo"}}}, {x64asm::RET, {}}};
+    x64asm::RegSet rs = x64asm::RegSet::empty();
+    Cfg cfg(code, rs, rs);
+
+    StateGen sg(&sb);
+    for (size_t i = 0; i < 8; ++i) {
+      CpuState cs;
+      sg.get(cs, cfg);
+      states_.push_back(cs);
+    }
+
+    std::stringstream ss;
+    states_.write_text(ss);
+    text_ = ss.str();
+  }
+
+  CpuStates states_;
+  std::string text_;
+};
+
+TEST_F(CpuStatesParserTest, MatchesWriteText) {
+  CpuStates result;
+  CpuStatesParser parser;
+  parser.set_num_threads(4);
+  ASSERT_TRUE(parser(text_, result)) << parser.get_error();
+
+  ASSERT_EQ(states_.size(), result.size());
+  for (size_t i = 0, ie = states_.size(); i < ie; ++i) {
+    std::stringstream expected;
+    std::stringstream actual;
+    states_[i].write_bin(expected);
+    result[i].write_bin(actual);
+    EXPECT_EQ(expected.str(), actual.str()) << "testcase " << i;
+  }
+}
+
+TEST_F(CpuStatesParserTest, MatchesSingleStateReader) {
+  CpuStates result;
+  ASSERT_TRUE(CpuStatesParser()(text_, result));
+
+  std::stringstream ss;
+  states_[0].write_text(ss);
+  CpuState cs;
+  cs.read_text(ss);
+
+  std::stringstream expected;
+  std::stringstream actual;
+  cs.write_bin(expected);
+  result[0].write_bin(actual);
+  EXPECT_EQ(expected.str(), actual.str());
+}
+
+TEST_F(CpuStatesParserTest, ReportsLineNumbers) {
+  // Break the name of %rcx in the second testcase
+  const auto header = text_.find("Testcase 1:");
+  const auto pos = text_.find("%rcx", header);
+  ASSERT_NE(std::string::npos, pos);
+  text_.replace(pos, 4, "%rzx");
+  const auto line = std::count(text_.begin(), text_.begin() + pos, '\n') + 1;
+
+  CpuStates result;
+  CpuStatesParser parser;
+  parser.set_num_threads(4);
+  EXPECT_FALSE(parser(text_, result));
+  ASSERT_TRUE(parser.has_error());
+  EXPECT_EQ(0ul, parser.get_error().find("Line " + std::to_string(line) + ":")) << parser.get_error();
+}
+
+TEST_F(CpuStatesParserTest, RejectsGarbage) {
+  CpuStates result;
+  CpuStatesParser parser;
+  EXPECT_FALSE(parser("hello\n" + text_, result));
+  EXPECT_EQ(0ul, parser.get_error().find("Line 1:"));
+}
+
+} // namespace stoke
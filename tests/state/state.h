@@ -84,4 +84,44 @@ TEST_F(StateRandomTest, GetAddrExplicit) {
   EXPECT_EQ(sb_output, state_.get_addr(mem));
 }
 
+TEST(MemoryTest, ValidRanges) {
+  Memory m;
+  m.resize(0x1000, 0x400);
+
+  for (uint64_t i = 0x1003; i < 0x1008; ++i) {
+    m.set_valid(i, true);
+    m[i] = i & 0xff;
+  }
+  for (uint64_t i = 0x1040; i < 0x1080; ++i) {
+    m.set_valid(i, true);
+    m[i] = i & 0xff;
+  }
+  m.set_valid(0x13ff, true);
+  m[0x13ff] = 0x5a;
+
+  const auto ranges = m.valid_ranges();
+  ASSERT_EQ(3ul, ranges.size());
+  EXPECT_EQ(0x1003ul, ranges[0].begin);
+  EXPECT_EQ(0x1008ul, ranges[0].end);
+  EXPECT_EQ(0x1040ul, ranges[1].begin);
+  EXPECT_EQ(0x1080ul, ranges[1].end);
+  EXPECT_EQ(0x13fful, ranges[2].begin);
+  EXPECT_EQ(0x1400ul, ranges[2].end);
+
+  // Only the rows holding valid bytes are written
+  std::stringstream ss;
+  m.write_text(ss);
+  EXPECT_NE(std::string::npos, ss.str().find("[ 10 valid rows shown ]"));
+
+  Memory text;
+  text.read_text(ss);
+  EXPECT_EQ(m, text);
+
+  Memory copy;
+  copy.resize(0x1000, 0x400);
+  copy.copy_valid(m);
+  EXPECT_EQ(m, copy);
+  EXPECT_EQ(3ul, copy.valid_ranges().size());
+}
+
 } //namespace stoke
@@ -39,8 +39,14 @@ using namespace x64asm;
 
 // very fast tests (much less 1 sec per test)
 #include "tests/trivial.h"
+#include "tests/sandbox/exec_arena.h"
+#include "tests/sandbox/native_executor.h"
 #include "tests/sandbox/sandbox.h"
+#include "tests/search/enumerative.h"
+#include "tests/search/metrics_stream.h"
+#include "tests/search/pareto_archive.h"
 #include "tests/search/search.h"
+#include "tests/search/window_partition.h"
 #include "tests/x64asm/r.h"
 #include "tests/x64asm/reg_set.h"
 #include "tests/x64asm/opc_set.h"
@@ -53,8 +59,11 @@ using namespace x64asm;
 #include "tests/disassembler/disassembler.h"
 #include "tests/solver/solver.h"
 #include "tests/state/state.h"
+#include "tests/state/cpu_states_parser.h"
 #include "tests/stategen/stategen.h"
 #include "tests/symstate/bitvector.h"
+#include "tests/transform/opcode_model.h"
+#include "tests/transform/vectorize.h"
 #include "tests/tunit/tunit.h"
 #include "tests/validator/invariants.h"
 #include "tests/verifier/verifier.h"
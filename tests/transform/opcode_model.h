@@ -0,0 +1,101 @@
+// Copyright 2013-2016 Stanford University
+//
+// Licensed under the Apache License, Version 2.0 (the License);
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an AS IS BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <sstream>
+
+#include "src/ext/cpputil/include/io/fail.h"
+#include "src/transform/opcode_model.h"
+
+namespace stoke {
+
+TEST(OpcodeModelTest, EmptyModelHasNoWeights) {
+  OpcodeModel model;
+
+  std::stringstream ss;
+  ss << "addq %rax, %rbx" << std::endl;
+  ss << "retq" << std::endl;
+  x64asm::Code target;
+  ss >> target;
+
+  EXPECT_TRUE(model.get_weights(target, 16).empty());
+}
+
+TEST(OpcodeModelTest, WeightsFavorObservedOpcodes) {
+  std::stringstream ss;
+  ss << "imulq $0x2, %rax, %rax" << std::endl;
+  ss << "retq" << std::endl;
+  x64asm::Code target;
+  ss >> target;
+
+  std::stringstream ss2;
+  ss2 << "addq %rax, %rax" << std::endl;
+  ss2 << "addq %rax, %rax" << std::endl;
+  ss2 << "subq %rbx, %rax" << std::endl;
+  ss2 << "retq" << std::endl;
+  x64asm::Code rewrite;
+  ss2 >> rewrite;
+
+  OpcodeModel model;
+  model.add_pair(target, rewrite);
+  EXPECT_EQ(1ul, model.num_pairs());
+
+  const auto weights = model.get_weights(target, 16);
+  ASSERT_EQ(2ul, weights.size());
+  const auto add = rewrite[0].get_opcode();
+  const auto sub = rewrite[2].get_opcode();
+  EXPECT_EQ(16ul, weights.at(add));
+  EXPECT_LT(weights.at(sub), 16ul);
+  EXPECT_LE(1ul, weights.at(sub));
+}
+
+TEST(OpcodeModelTest, ReadWriteRoundTrip) {
+  std::stringstream ss;
+  ss << "movq %rdi, %rax" << std::endl;
+  ss << "addq %rsi, %rax" << std::endl;
+  ss << "retq" << std::endl;
+  x64asm::Code target;
+  ss >> target;
+
+  std::stringstream ss2;
+  ss2 << "leaq (%rdi,%rsi,1), %rax" << std::endl;
+  ss2 << "retq" << std::endl;
+  x64asm::Code rewrite;
+  ss2 >> rewrite;
+
+  OpcodeModel model;
+  model.add_pair(target, rewrite);
+
+  std::stringstream text;
+  text << model;
+
+  OpcodeModel copy;
+  text >> copy;
+  ASSERT_FALSE(cpputil::failed(text)) << cpputil::fail_msg(text);
+
+  EXPECT_EQ(model.num_pairs(), copy.num_pairs());
+  EXPECT_EQ(model.get_weights(target, 8), copy.get_weights(target, 8));
+}
+
+TEST(OpcodeModelTest, ReportsBadLines) {
+  std::stringstream ss;
+  ss << "pairs 1" << std::endl;
+  ss << "u not_an_opcode 3" << std::endl;
+
+  OpcodeModel model;
+  ss >> model;
+  ASSERT_TRUE(cpputil::failed(ss));
+  EXPECT_NE(std::string::npos, cpputil::fail_msg(ss).find("Line 2"));
+}
+
+} //namespace stoke
@@ -18,6 +18,8 @@
 #include "src/cost/latency.h"
 #include "src/cost/correctness.h"
 #include "src/cost/size.h"
+#include "src/search/trace_reader.h"
+#include "src/search/trace_recorder.h"
 #include "src/stategen/stategen.h"
 #include "src/transform/pools.h"
 
@@ -84,6 +86,52 @@ protected:
     }
   }
 
+  void check_move_replayable(Transform& transform) {
+
+    x64asm::Code original(code_);
+    transform.set_seed(seed_);
+
+    if (!cfg_->check_invariants()) {
+      std::cout << "[----------] Invariants failed at beginning; can't check this one." << std::endl;
+      return;
+    }
+
+    for (size_t i = 0; i < iterations_; ++i) {
+
+      auto ti = transform(*cfg_);
+      if (!ti.success) {
+        continue;
+      }
+      const x64asm::Code modified(cfg_->get_code());
+      transform.undo(*cfg_, ti);
+
+      // Send the move through a trace and redo it from what comes back
+      std::stringstream ss;
+      TraceRecorder recorder(ss);
+      recorder.record(ti, 10, 5, false);
+      TraceReader reader(ss);
+      TraceReader::Entry entry;
+      ASSERT_TRUE(reader.next(entry)) << reader.get_error();
+      ASSERT_FALSE(entry.is_segment);
+      ASSERT_TRUE(entry.info.success);
+      ASSERT_FALSE(entry.accepted);
+      ASSERT_EQ(10ul, entry.max);
+      ASSERT_EQ(5ul, entry.cost);
+
+      if (entry.info.undo_index[0] < cfg_->get_code().size()) {
+        entry.info.undo_instr = cfg_->get_code()[entry.info.undo_index[0]];
+        entry.info.undo_code.assign(cfg_->get_code().begin() + entry.info.undo_index[0], cfg_->get_code().end());
+      }
+      transform.redo(*cfg_, entry.info);
+      ASSERT_TRUE(check_cfg());
+      ASSERT_EQ(modified, cfg_->get_code()) << "and the seed was: " << seed_ << std::endl;
+
+      transform.undo(*cfg_, entry.info);
+      ASSERT_TRUE(check_cfg());
+      ASSERT_EQ(original, cfg_->get_code()) << "and the seed was: " << seed_ << std::endl;
+    }
+  }
+
   void check_print_parse() {
     stringstream ss;
     ss << cfg_->get_function();
@@ -148,6 +196,11 @@ TEST_P(TransformsTest, RotateMoveIsReversible) {
   check_move_reversible(transform);
 }
 
+TEST_P(TransformsTest, VectorizeMoveIsReversible) {
+  auto transform = VectorizeTransform(tp_);
+  check_move_reversible(transform);
+}
+
 TEST_P(TransformsTest, LocalSwapMoveIsReversible) {
   auto transform = LocalSwapTransform(tp_);
   check_move_reversible(transform);
@@ -171,6 +224,7 @@ TEST_P(TransformsTest, WeightedIsReversible) {
   transforms.push_back(new LocalSwapTransform(tp_));
   transforms.push_back(new GlobalSwapTransform(tp_));
   transforms.push_back(new RotateTransform(tp_));
+  transforms.push_back(new VectorizeTransform(tp_));
 
   for (auto t : transforms)
     transform.insert_transform(t);
@@ -182,6 +236,31 @@ TEST_P(TransformsTest, WeightedIsReversible) {
   }
 }
 
+TEST_P(TransformsTest, WeightedIsReplayable) {
+  auto transform = WeightedTransform(tp_);
+
+  std::vector<Transform*> transforms;
+  transforms.push_back(new AddNopsTransform(tp_));
+  transforms.push_back(new DeleteTransform(tp_));
+  transforms.push_back(new InstructionTransform(tp_));
+  transforms.push_back(new OpcodeTransform(tp_));
+  transforms.push_back(new OpcodeWidthTransform(tp_));
+  transforms.push_back(new OperandTransform(tp_));
+  transforms.push_back(new LocalSwapTransform(tp_));
+  transforms.push_back(new GlobalSwapTransform(tp_));
+  transforms.push_back(new RotateTransform(tp_));
+  transforms.push_back(new VectorizeTransform(tp_));
+
+  for (auto t : transforms)
+    transform.insert_transform(t);
+
+  check_move_replayable(transform);
+
+  for (auto t : transforms) {
+    delete t;
+  }
+}
+
 TEST_P(TransformsTest, CostInvariantAfterUndo) {
 
   // Setup weighted transform
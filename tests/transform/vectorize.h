@@ -0,0 +1,194 @@
+// Copyright 2013-2016 Stanford University
+//
+// Licensed under the Apache License, Version 2.0 (the License);
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an AS IS BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <sstream>
+
+#include "src/cfg/cfg.h"
+#include "src/transform/vectorize.h"
+#include "tests/fuzzer.h"
+
+namespace stoke {
+
+class VectorizeTransformTest : public ::testing::Test {
+
+protected:
+
+  /** Proposes moves until one succeeds or we give up. */
+  bool propose(VectorizeTransform& transform, Cfg& cfg, TransformInfo& ti) {
+    for (size_t i = 0; i < 1000; ++i) {
+      ti = transform(cfg);
+      if (ti.success) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  Cfg make_cfg(const std::string& text, const x64asm::RegSet& live_outs) {
+    std::stringstream ss;
+    ss << text;
+    x64asm::Code c;
+    ss >> c;
+    return Cfg(TUnit(c), x64asm::RegSet::universe(), live_outs);
+  }
+
+};
+
+TEST_F(VectorizeTransformTest, PacksAdjacentStores) {
+  auto cfg = make_cfg(
+               ".foo:\n"
+               "movl %edi, 0x8(%rsi)\n"
+               "movl %edi, (%rsi)\n"
+               "nop\n"
+               "movl %edi, 0xc(%rsi)\n"
+               "movl %edi, 0x4(%rsi)\n"
+               "retq\n", x64asm::RegSet::empty());
+  const auto original = cfg.get_code();
+
+  auto pools = default_fuzzer_pool();
+  VectorizeTransform transform(pools);
+  TransformInfo ti;
+  ASSERT_TRUE(propose(transform, cfg, ti));
+
+  std::stringstream expected;
+  expected << ".foo:" << std::endl;
+  expected << "movd %edi, %xmm0" << std::endl;
+  expected << "pshufd $0x0, %xmm0, %xmm0" << std::endl;
+  expected << "movdqu %xmm0, (%rsi)" << std::endl;
+  expected << "nop" << std::endl;
+  expected << "retq" << std::endl;
+  x64asm::Code packed;
+  expected >> packed;
+  EXPECT_EQ(packed, cfg.get_code());
+
+  transform.undo(cfg, ti);
+  EXPECT_EQ(original, cfg.get_code());
+
+  transform.redo(cfg, ti);
+  EXPECT_EQ(packed, cfg.get_code());
+}
+
+TEST_F(VectorizeTransformTest, PacksReadModifyWrites) {
+  auto cfg = make_cfg(
+               ".foo:\n"
+               "addq %rdx, -0x10(%rdi,%rcx,8)\n"
+               "addq %rdx, -0x8(%rdi,%rcx,8)\n"
+               "retq\n", x64asm::RegSet::empty());
+  const auto original = cfg.get_code();
+
+  auto pools = default_fuzzer_pool();
+  VectorizeTransform transform(pools);
+  TransformInfo ti;
+  ASSERT_TRUE(propose(transform, cfg, ti));
+
+  std::stringstream expected;
+  expected << ".foo:" << std::endl;
+  expected << "movq %rdx, %xmm0" << std::endl;
+  expected << "punpcklqdq %xmm0, %xmm0" << std::endl;
+  expected << "movdqu -0x10(%rdi,%rcx,8), %xmm1" << std::endl;
+  expected << "paddq %xmm0, %xmm1" << std::endl;
+  expected << "movdqu %xmm1, -0x10(%rdi,%rcx,8)" << std::endl;
+  expected << "retq" << std::endl;
+  x64asm::Code packed;
+  expected >> packed;
+  EXPECT_EQ(packed, cfg.get_code());
+
+  transform.undo(cfg, ti);
+  EXPECT_EQ(original, cfg.get_code());
+}
+
+TEST_F(VectorizeTransformTest, ScratchAvoidsRegistersMadeLiveByEarlierMoves) {
+  auto cfg = make_cfg(
+               ".foo:\n"
+               "movl %edi, (%rsi)\n"
+               "movl %edi, 0x4(%rsi)\n"
+               "movl %edi, 0x8(%rsi)\n"
+               "movl %edi, 0xc(%rsi)\n"
+               "movq %rcx, %rax\n"
+               "retq\n", x64asm::RegSet::empty() + x64asm::rax);
+
+  // An operand move that only recomputes defs leaves liveness stale
+  std::stringstream ss;
+  ss << "movq %xmm0, %rax" << std::endl;
+  x64asm::Code c;
+  ss >> c;
+  ASSERT_EQ(1ul, c.size());
+  cfg.get_function().replace(5, c[0], false);
+  cfg.recompute_defs();
+
+  auto pools = default_fuzzer_pool();
+  VectorizeTransform transform(pools);
+  TransformInfo ti;
+  ASSERT_TRUE(propose(transform, cfg, ti));
+
+  std::stringstream expected;
+  expected << ".foo:" << std::endl;
+  expected << "movd %edi, %xmm1" << std::endl;
+  expected << "pshufd $0x0, %xmm1, %xmm1" << std::endl;
+  expected << "movdqu %xmm1, (%rsi)" << std::endl;
+  expected << "movq %xmm0, %rax" << std::endl;
+  expected << "retq" << std::endl;
+  x64asm::Code packed;
+  expected >> packed;
+  EXPECT_EQ(packed, cfg.get_code());
+}
+
+TEST_F(VectorizeTransformTest, LeavesGapsAndLiveFlagsAlone) {
+  auto pools = default_fuzzer_pool();
+  VectorizeTransform transform(pools);
+  TransformInfo ti;
+
+  // Lanes 0x0 and 0x8 don't cover a block
+  auto gap = make_cfg(
+               ".foo:\n"
+               "movl %edi, (%rsi)\n"
+               "movl %edi, 0x4(%rsi)\n"
+               "movl %edi, 0x8(%rsi)\n"
+               "movl %edi, 0x8(%rsi)\n"
+               "retq\n", x64asm::RegSet::empty());
+  EXPECT_FALSE(propose(transform, gap, ti));
+
+  // paddd wouldn't set the flags that addl does
+  auto flags = make_cfg(
+                 ".foo:\n"
+                 "addl %edi, (%rsi)\n"
+                 "addl %edi, 0x4(%rsi)\n"
+                 "addl %edi, 0x8(%rsi)\n"
+                 "addl %edi, 0xc(%rsi)\n"
+                 "retq\n", x64asm::RegSet::empty() + x64asm::eflags_zf);
+  EXPECT_FALSE(propose(transform, flags, ti));
+}
+
+TEST_F(VectorizeTransformTest, OnlyUsesOpcodesInThePool) {
+  auto cfg = make_cfg(
+               ".foo:\n"
+               "movq $0x0, (%rsi)\n"
+               "movq $0x0, 0x8(%rsi)\n"
+               "retq\n", x64asm::RegSet::empty());
+
+  auto pools = default_fuzzer_pool();
+  pools.remove_opcode(x64asm::PXOR_XMM_XMM);
+  pools.recompute_pools();
+  VectorizeTransform transform(pools);
+  TransformInfo ti;
+  EXPECT_FALSE(propose(transform, cfg, ti));
+
+  pools.insert_opcode(x64asm::PXOR_XMM_XMM);
+  pools.recompute_pools();
+  ASSERT_TRUE(propose(transform, cfg, ti));
+  EXPECT_EQ(x64asm::PXOR_XMM_XMM, cfg.get_code()[1].get_opcode());
+  EXPECT_EQ(x64asm::MOVDQU_M128_XMM, cfg.get_code()[2].get_opcode());
+}
+
+} // namespace stoke
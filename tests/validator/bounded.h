@@ -203,6 +203,34 @@ TEST_P(BoundedValidatorBaseTest, NoLoopsFails) {
 
 }
 
+TEST_P(BoundedValidatorBaseTest, PassesOverMemoryBudget) {
+
+  auto live_outs = all();
+
+  std::stringstream sst;
+  sst << ".foo:" << std::endl;
+  sst << "incq %rax" << std::endl;
+  sst << "cmpq $0x10, %rax" << std::endl;
+  sst << "retq" << std::endl;
+  auto target = make_cfg(sst, live_outs, live_outs);
+
+  std::stringstream ssr;
+  ssr << ".foo:" << std::endl;
+  ssr << "addq $0x1, %rax" << std::endl;
+  ssr << "cmpq $0x10, %rax" << std::endl;
+  ssr << "retq" << std::endl;
+  auto rewrite = make_cfg(ssr, live_outs, live_outs);
+
+  // Every obligation ends over a one-byte budget
+  validator->set_memory_budget(1);
+  EXPECT_TRUE(validator->verify(target, rewrite));
+  EXPECT_FALSE(validator->has_error()) << validator->error();
+  EXPECT_LE(1ul, validator->get_collections());
+
+  EXPECT_LT(0ul, Validator::current_rss());
+  EXPECT_LE(Validator::current_rss(), Validator::peak_rss());
+}
+
 TEST_P(BoundedValidatorBaseTest, UnsupportedInstruction) {
 
   auto live_outs = all();
@@ -491,6 +519,158 @@ TEST_P(BoundedValidatorBaseTest, PopcntWrongBeyondBound) {
 
 }
 
+TEST_P(BoundedValidatorBaseTest, PopcntDeepeningStopsAtFirstFailure) {
+
+  auto live_outs = x64asm::RegSet::empty() + x64asm::rax;
+
+  std::stringstream sst;
+  sst << ".popcnt:" << std::endl;
+  sst << "xorl %eax, %eax" << std::endl;
+  sst << "testq %rdi, %rdi" << std::endl;
+  sst << "je .end" << std::endl;
+  sst << ".loop:" << std::endl;
+  sst << "movl %edi, %edx" << std::endl;
+  sst << "andl $0x1, %edx" << std::endl;
+  sst << "addl %edx, %eax" << std::endl;
+  sst << "shrq $0x1, %rdi" << std::endl;
+  sst << "jne .loop" << std::endl;
+  sst << ".end:" << std::endl;
+  sst << "retq" << std::endl;
+  auto target = make_cfg(sst, all(), live_outs);
+
+  std::stringstream ssr;
+  ssr << ".popcnt:" << std::endl;
+  ssr << "cmpl $0x42, %edi" << std::endl;
+  ssr << "je .gotcha" << std::endl;
+  ssr << "popcntq %rdi, %rax" << std::endl;
+  ssr << ".gotcha:" << std::endl;
+  ssr << "retq" << std::endl;
+  auto rewrite = make_cfg(ssr, all(), live_outs);
+
+  validator->set_bound(2);
+  validator->set_deepening(true);
+  EXPECT_TRUE(validator->verify(target, rewrite));
+  EXPECT_FALSE(validator->has_error()) << validator->error();
+  EXPECT_EQ(2, validator->get_verified_bound());
+
+  // Pairs proven up to bound 2 are reused; the failure is beyond them
+  validator->set_bound(8);
+  EXPECT_FALSE(validator->verify(target, rewrite));
+  EXPECT_FALSE(validator->has_error()) << validator->error();
+  EXPECT_LE(2, validator->get_verified_bound());
+  EXPECT_GT(8, validator->get_verified_bound());
+
+  EXPECT_LE(1ul, validator->counter_examples_available());
+  for (auto it : validator->get_counter_examples())
+    check_ceg(it, target, rewrite);
+
+}
+
+TEST_P(BoundedValidatorBaseTest, ManyCounterexamplesAreDistinct) {
+
+  auto regs = x64asm::RegSet::empty() + x64asm::rax;
+
+  std::stringstream sst;
+  sst << ".foo:" << std::endl;
+  sst << "addq $0x1, %rax" << std::endl;
+  sst << "retq" << std::endl;
+  auto target = make_cfg(sst, regs, regs);
+
+  std::stringstream ssr;
+  ssr << ".foo:" << std::endl;
+  ssr << "addq $0x2, %rax" << std::endl;
+  ssr << "retq" << std::endl;
+  auto rewrite = make_cfg(ssr, regs, regs);
+
+  validator->set_max_counterexamples(4);
+  EXPECT_FALSE(validator->verify(target, rewrite));
+  EXPECT_FALSE(validator->has_error()) << validator->error();
+
+  EXPECT_EQ(4ul, validator->counter_examples_available());
+  std::set<uint64_t> inputs;
+  for (auto it : validator->get_counter_examples()) {
+    check_ceg(it, target, rewrite);
+    inputs.insert(it.gp[x64asm::rax].get_fixed_quad(0));
+  }
+  EXPECT_EQ(4ul, inputs.size());
+
+}
+
+TEST_P(BoundedValidatorBaseTest, NonlinearAbstractionRefines) {
+
+  auto def_ins = x64asm::RegSet::empty() + x64asm::rdi + x64asm::rsi;
+  auto live_outs = x64asm::RegSet::empty() + x64asm::rax;
+
+  std::stringstream sst;
+  sst << ".foo:" << std::endl;
+  sst << "movq %rdi, %rax" << std::endl;
+  sst << "imulq %rsi, %rax" << std::endl;
+  sst << "retq" << std::endl;
+  auto target = make_cfg(sst, def_ins, live_outs);
+
+  // Proving this needs commutativity, which the abstraction doesn't know
+  std::stringstream ssr;
+  ssr << ".foo:" << std::endl;
+  ssr << "movq %rsi, %rax" << std::endl;
+  ssr << "imulq %rdi, %rax" << std::endl;
+  ssr << "retq" << std::endl;
+  auto rewrite = make_cfg(ssr, def_ins, live_outs);
+
+  validator->set_abstract_nonlinear(true);
+  EXPECT_TRUE(validator->verify(target, rewrite));
+  EXPECT_FALSE(validator->has_error()) << validator->error();
+
+  std::stringstream ssw;
+  ssw << ".foo:" << std::endl;
+  ssw << "movq %rsi, %rax" << std::endl;
+  ssw << "incq %rax" << std::endl;
+  ssw << "imulq %rdi, %rax" << std::endl;
+  ssw << "retq" << std::endl;
+  auto wrong = make_cfg(ssw, def_ins, live_outs);
+
+  EXPECT_FALSE(validator->verify(target, wrong));
+  EXPECT_FALSE(validator->has_error()) << validator->error();
+
+  EXPECT_LE(1ul, validator->counter_examples_available());
+  for (auto it : validator->get_counter_examples())
+    check_ceg(it, target, wrong);
+
+}
+
+TEST_P(BoundedValidatorBaseTest, PopcntDeepeningTimeoutIsAnError) {
+
+  auto live_outs = x64asm::RegSet::empty() + x64asm::rax;
+
+  std::stringstream sst;
+  sst << ".popcnt:" << std::endl;
+  sst << "xorl %eax, %eax" << std::endl;
+  sst << "testq %rdi, %rdi" << std::endl;
+  sst << "je .end" << std::endl;
+  sst << ".loop:" << std::endl;
+  sst << "movl %edi, %edx" << std::endl;
+  sst << "andl $0x1, %edx" << std::endl;
+  sst << "addl %edx, %eax" << std::endl;
+  sst << "shrq $0x1, %rdi" << std::endl;
+  sst << "jne .loop" << std::endl;
+  sst << ".end:" << std::endl;
+  sst << "retq" << std::endl;
+  auto target = make_cfg(sst, all(), live_outs);
+
+  std::stringstream ssr;
+  ssr << ".popcnt:" << std::endl;
+  ssr << "popcntq %rdi, %rax" << std::endl;
+  ssr << "retq" << std::endl;
+  auto rewrite = make_cfg(ssr, all(), live_outs);
+
+  // A budget too small to finish the requested bound
+  validator->set_bound(8);
+  validator->set_deepening(true, std::chrono::duration<double>(1e-9));
+  EXPECT_FALSE(validator->verify(target, rewrite));
+  EXPECT_TRUE(validator->has_error());
+  EXPECT_GT(8, validator->get_verified_bound());
+
+}
+
 TEST_P(BoundedValidatorBaseTest, EasyMemory) {
 
   auto live_outs = x64asm::RegSet::empty() + x64asm::rax;
@@ -1952,7 +2132,7 @@ TEST_P(BoundedValidatorBaseTest, NoSpuriousCeg) {
 
 INSTANTIATE_TEST_CASE_P(AllSolversAliasing, BoundedValidatorBaseTest,
                         ::testing::Combine(
-                          ::testing::Values(ObligationChecker::AliasStrategy::FLAT, ObligationChecker::AliasStrategy::ARM),
+                          ::testing::Values(ObligationChecker::AliasStrategy::FLAT, ObligationChecker::AliasStrategy::ARM, ObligationChecker::AliasStrategy::WORD),
                           ::testing::Values(Solver::Z3, Solver::CVC4)
                         )
                        );
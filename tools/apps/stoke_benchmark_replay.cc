@@ -0,0 +1,181 @@
+// Copyright 2013-2016 Stanford University
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+
+#include "src/ext/cpputil/include/command_line/command_line.h"
+#include "src/ext/cpputil/include/io/console.h"
+#include "src/ext/cpputil/include/signal/debug_handler.h"
+
+#include "src/search/trace_reader.h"
+#include "tools/args/trace.inc"
+#include "tools/gadgets/cost_function.h"
+#include "tools/gadgets/functions.h"
+#include "tools/gadgets/sandbox.h"
+#include "tools/gadgets/seed.h"
+#include "tools/gadgets/target.h"
+#include "tools/gadgets/testcases.h"
+#include "tools/gadgets/transform_pools.h"
+#include "tools/gadgets/weighted_transform.h"
+
+using namespace cpputil;
+using namespace std;
+using namespace std::chrono;
+using namespace stoke;
+
+void run_sandbox(Sandbox& sb, const Cfg& cfg) {
+  sb.insert_function(cfg);
+  sb.set_entrypoint(cfg.get_code()[0].get_operand<x64asm::Label>(0));
+  sb.run();
+}
+
+int main(int argc, char** argv) {
+  CommandLineConfig::strict_with_convenience(argc, argv);
+  DebugHandler::install_sigsegv();
+  DebugHandler::install_sigill();
+
+  SeedGadget seed;
+  FunctionsGadget aux_fxns;
+  TargetGadget target(aux_fxns, false);
+
+  TrainingSetGadget training_set(seed);
+  SandboxGadget training_sb(training_set, aux_fxns);
+  PerformanceSetGadget perf_set(seed);
+  SandboxGadget perf_sb(perf_set, aux_fxns);
+  CostFunctionGadget fxn(target, &training_sb, &perf_sb);
+
+  TransformPoolsGadget transform_pools(target, aux_fxns, seed);
+  WeightedTransformGadget transform(transform_pools, seed);
+
+  // The cost function runs the sandboxes up front; run them here instead so they can be timed
+  const auto need_test = fxn.need_test_sandbox();
+  const auto need_perf = fxn.need_perf_sandbox();
+  fxn.set_run_sandboxes(false, false);
+
+  ifstream ifs(trace_arg.value(), ios::in | ios::binary);
+  if (!ifs.is_open()) {
+    Console::error(1) << "Unable to open trace file " << trace_arg.value() << endl;
+  }
+  TraceReader reader(ifs);
+
+  Cfg current = target;
+  TraceReader::Entry entry;
+
+  size_t segments = 0;
+  size_t proposals = 0;
+  size_t failed = 0;
+  size_t accepted = 0;
+  size_t diverged = 0;
+  duration<double> transform_time(0);
+  duration<double> sandbox_time(0);
+  duration<double> cost_time(0);
+
+  Console::msg() << "Replaying " << trace_arg.value() << "..." << endl;
+
+  const auto start = steady_clock::now();
+  while (reader.next(entry)) {
+    if (entry.is_segment) {
+      current = Cfg(TUnit(entry.rewrite), target.def_ins(), target.live_outs());
+      for (const auto& aux : aux_fxns) {
+        const auto& code = aux.get_code();
+        TUnit::MayMustSets mms = {
+          code.must_read_set(),
+          code.must_write_set(),
+          code.must_undef_set(),
+          code.maybe_read_set(),
+          code.maybe_write_set(),
+          code.maybe_undef_set()
+        };
+        current.add_summary(aux.get_leading_label(), aux.get_may_must_sets(mms));
+      }
+      current.recompute();
+      segments++;
+      continue;
+    }
+
+    proposals++;
+    if (!entry.info.success) {
+      failed++;
+      continue;
+    }
+    if (entry.info.move_type >= transform.size() ||
+        entry.info.undo_index[0] >= current.get_code().size() + 1) {
+      Console::error(1) << "Trace does not match this transform configuration and rewrite" << endl;
+    }
+
+    // Moves that rewrite several instructions undo from a copy of the code
+    // from the one they start at; this isn't part of the move's cost
+    entry.info.undo_code.assign(current.get_code().begin() + min(entry.info.undo_index[0], current.get_code().size()),
+                                current.get_code().end());
+
+    // undo() needs the instruction that redo() overwrites or removes
+    auto t0 = steady_clock::now();
+    if (entry.info.undo_index[0] < current.get_code().size()) {
+      entry.info.undo_instr = current.get_code()[entry.info.undo_index[0]];
+    }
+    transform.redo(current, entry.info);
+    auto t1 = steady_clock::now();
+    transform_time += duration_cast<duration<double>>(t1 - t0);
+
+    if (need_test) {
+      run_sandbox(training_sb, current);
+    }
+    if (need_perf) {
+      run_sandbox(perf_sb, current);
+    }
+    auto t2 = steady_clock::now();
+    sandbox_time += duration_cast<duration<double>>(t2 - t1);
+
+    const auto res = fxn(current, entry.max);
+    auto t3 = steady_clock::now();
+    cost_time += duration_cast<duration<double>>(t3 - t2);
+
+    // Costs at or above the bound may be truncated differently; anything below must match
+    if (entry.cost < entry.max && res.second != entry.cost) {
+      diverged++;
+    }
+
+    if (entry.accepted) {
+      accepted++;
+    } else {
+      transform.undo(current, entry.info);
+      transform_time += duration_cast<duration<double>>(steady_clock::now() - t3);
+    }
+  }
+  const auto dur = duration_cast<duration<double>>(steady_clock::now() - start);
+
+  if (reader.has_error()) {
+    Console::error(1) << "Error reading trace: " << reader.get_error() << endl;
+  }
+
+  Console::msg() << fixed;
+  Console::msg() << "Segments:   " << segments << endl;
+  Console::msg() << "Proposals:  " << proposals << " (" << failed << " failed, " << accepted << " accepted)" << endl;
+  Console::msg() << "Runtime:    " << dur.count() << " seconds" << endl;
+  Console::msg() << "Transform:  " << transform_time.count() << " seconds" << endl;
+  Console::msg() << "Sandbox:    " << sandbox_time.count() << " seconds" << endl;
+  Console::msg() << "Cost:       " << cost_time.count() << " seconds" << endl;
+  Console::msg() << "Throughput: " << (proposals - failed) / dur.count() << " / second" << endl;
+
+  if (diverged > 0) {
+    Console::warn() << diverged << " proposals produced a different cost than when they were recorded; "
+                    << "check that the target, testcases and cost function match the recorded search" << endl;
+  }
+
+  return 0;
+}
@@ -14,11 +14,14 @@
 
 #include <chrono>
 #include <iostream>
+#include <sstream>
+#include <string>
 
 #include "src/ext/cpputil/include/command_line/command_line.h"
 #include "src/ext/cpputil/include/io/console.h"
 #include "src/ext/cpputil/include/signal/debug_handler.h"
 
+#include "src/state/cpu_states_parser.h"
 #include "tools/args/benchmark.inc"
 #include "tools/gadgets/seed.h"
 #include "tools/gadgets/testcases.h"
@@ -28,6 +31,19 @@ using namespace std;
 using namespace std::chrono;
 using namespace stoke;
 
+auto& parse_tcs_arg = ValueArg<size_t>::create("parse_testcases")
+                      .usage("<int>")
+                      .description("Number of testcases to parse when benchmarking the text parsers")
+                      .default_val(1000);
+
+/** Prints the runtime and throughput of a benchmark. */
+void report(time_point<steady_clock> start, size_t n) {
+  const auto dur = duration_cast<duration<double>>(steady_clock::now() - start);
+  Console::msg() << fixed;
+  Console::msg() << "Runtime:    " << dur.count() << " seconds" << endl;
+  Console::msg() << "Throughput: " << n / dur.count() << " / second" << endl;
+}
+
 int main(int argc, char** argv) {
   CommandLineConfig::strict_with_convenience(argc, argv);
   DebugHandler::install_sigsegv();
@@ -39,18 +55,45 @@ int main(int argc, char** argv) {
 
   Console::msg() << "Memory::copy_defined()..." << endl;
 
-  const auto start = steady_clock::now();
+  auto start = steady_clock::now();
   for (size_t i = 0; i < benchmark_itr_arg; ++i) {
     tc1.stack = tc2.stack;
     tc1.heap = tc2.heap;
     tc1.data = tc2.data;
   }
-  const auto dur = duration_cast<duration<double>>(steady_clock::now() - start);
-  const auto cps = benchmark_itr_arg / dur.count();
+  report(start, benchmark_itr_arg);
 
-  Console::msg() << fixed;
-  Console::msg() << "Runtime:    " << dur.count() << " seconds" << endl;
-  Console::msg() << "Throughput: " << cps << " / second" << endl;
+  CpuStates tcs;
+  tcs.assign(parse_tcs_arg.value(), tc2);
+  stringstream ss;
+  tcs.write_text(ss);
+  const auto text = ss.str();
+
+  stringstream one;
+  tc2.write_text(one);
+  const auto one_text = one.str();
+
+  Console::msg() << endl << "CpuState::read_text()..." << endl;
+
+  start = steady_clock::now();
+  for (size_t i = 0, ie = tcs.size(); i < ie; ++i) {
+    istringstream iss(one_text);
+    tc1.read_text(iss);
+  }
+  report(start, tcs.size());
+
+  Console::msg() << endl << "CpuStatesParser (1 thread)..." << endl;
+
+  start = steady_clock::now();
+  CpuStates res;
+  CpuStatesParser().set_num_threads(1)(text, res);
+  report(start, tcs.size());
+
+  Console::msg() << endl << "CpuStatesParser (all threads)..." << endl;
+
+  start = steady_clock::now();
+  CpuStatesParser().set_num_threads(0)(text, res);
+  report(start, tcs.size());
 
   return 0;
 }
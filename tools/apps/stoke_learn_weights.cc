@@ -0,0 +1,128 @@
+// Copyright 2013-2016 Stanford University
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem/operations.hpp>
+#include <boost/filesystem/path.hpp>
+
+#include "src/ext/cpputil/include/command_line/command_line.h"
+#include "src/ext/cpputil/include/io/console.h"
+#include "src/ext/cpputil/include/io/fail.h"
+#include "src/ext/cpputil/include/signal/debug_handler.h"
+
+#include "src/transform/opcode_model.h"
+#include "src/tunit/tunit.h"
+
+namespace fs = boost::filesystem;
+
+using namespace cpputil;
+using namespace std;
+using namespace stoke;
+
+auto& io = Heading::create("I/O Options:");
+auto& corpus_arg = ValueArg<string>::create("corpus")
+                   .usage("<path/to/file>")
+                   .description("File listing target/rewrite pairs, one per line as '<target.s> <rewrite.s>'; if the rewrite is a directory, every result-*.s file in it is paired with the target")
+                   .required();
+auto& out_arg = ValueArg<string>::create("out")
+                .alternate("o")
+                .usage("<path/to/file>")
+                .description("File to write learned opcode weights to (for use with --opcode_weights)")
+                .default_val("weights.txt");
+
+/** Reads a function from a file; exits with an error on failure. */
+TUnit read_tunit(const string& path) {
+  ifstream ifs(path);
+  if (!ifs.is_open()) {
+    Console::error(1) << "Unable to open " << path << endl;
+  }
+
+  TUnit t;
+  ifs >> t;
+  if (failed(ifs)) {
+    Console::error(1) << "Unable to parse " << path << ": " << fail_msg(ifs) << endl;
+  }
+  return t;
+}
+
+/** Expands a rewrite path into the list of rewrite files it denotes. */
+vector<string> rewrite_files(const string& path) {
+  vector<string> res;
+  if (!fs::is_directory(path)) {
+    res.push_back(path);
+    return res;
+  }
+
+  for (fs::directory_iterator i(path), ie; i != ie; ++i) {
+    const auto name = i->path().filename().string();
+    if (name.compare(0, 7, "result-") == 0 && i->path().extension() == ".s") {
+      res.push_back(i->path().string());
+    }
+  }
+  sort(res.begin(), res.end());
+  return res;
+}
+
+int main(int argc, char** argv) {
+  CommandLineConfig::strict_with_convenience(argc, argv);
+  DebugHandler::install_sigsegv();
+  DebugHandler::install_sigill();
+
+  ifstream corpus(corpus_arg.value());
+  if (!corpus.is_open()) {
+    Console::error(1) << "Unable to open corpus file " << corpus_arg.value() << endl;
+  }
+
+  OpcodeModel model;
+  size_t line_no = 0;
+  for (string line; getline(corpus, line);) {
+    line_no++;
+    istringstream iss(line);
+
+    string target_path;
+    string rewrite_path;
+    if (!(iss >> target_path) || target_path[0] == '#') {
+      continue;
+    }
+    if (!(iss >> rewrite_path)) {
+      Console::error(1) << corpus_arg.value() << ":" << line_no << ": expected '<target.s> <rewrite.s>'" << endl;
+    }
+
+    const auto target = read_tunit(target_path);
+    const auto rewrites = rewrite_files(rewrite_path);
+    if (rewrites.empty()) {
+      Console::warn() << corpus_arg.value() << ":" << line_no << ": no rewrites found in " << rewrite_path << endl;
+    }
+    for (const auto& r : rewrites) {
+      model.add_pair(target.get_code(), read_tunit(r).get_code());
+    }
+  }
+
+  if (model.empty()) {
+    Console::error(1) << "The corpus does not contain any target/rewrite pairs" << endl;
+  }
+
+  ofstream ofs(out_arg.value());
+  ofs << model;
+
+  Console::msg() << "Learned opcode weights from " << model.num_pairs() << " rewrites" << endl;
+
+  return 0;
+}
@@ -0,0 +1,127 @@
+// Copyright 2013-2016 Stanford University
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include "src/ext/cpputil/include/command_line/command_line.h"
+#include "src/ext/cpputil/include/io/column.h"
+#include "src/ext/cpputil/include/io/console.h"
+#include "src/ext/cpputil/include/io/filterstream.h"
+#include "src/ext/cpputil/include/signal/debug_handler.h"
+
+#include "src/search/metrics_stream.h"
+
+using namespace cpputil;
+using namespace stoke;
+using namespace std;
+using namespace std::chrono;
+
+auto& input_heading = Heading::create("Input Options:");
+auto& metrics_arg =
+  ValueArg<string>::create("metrics")
+  .usage("<path/to/file.jsonl,...>")
+  .description("Comma-separated list of files written by stoke search --metrics; reads stdin if empty")
+  .default_val("");
+
+auto& report_heading = Heading::create("Report Options:");
+auto& stall_arg =
+  ValueArg<double>::create("stall_seconds")
+  .usage("<double>")
+  .description("Flag runs whose lowest cost hasn't improved for this many seconds of search")
+  .default_val(600);
+
+int main(int argc, char** argv) {
+  CommandLineConfig::strict_with_convenience(argc, argv);
+  DebugHandler::install_sigsegv();
+  DebugHandler::install_sigill();
+
+  MetricsSummary summary;
+  if (metrics_arg.value() == "") {
+    summary.read(cin);
+  } else {
+    istringstream paths(metrics_arg.value());
+    string path;
+    while (getline(paths, path, ',')) {
+      ifstream ifs(path);
+      if (!ifs.is_open()) {
+        Console::error(1) << "Unable to open metrics file " << path << endl;
+      }
+      summary.read(ifs);
+    }
+  }
+
+  const auto& runs = summary.get_runs();
+  const auto now = duration_cast<duration<double>>(system_clock::now().time_since_epoch()).count();
+
+  ofilterstream<Column> ofs(Console::msg());
+  ofs.filter().padding(3);
+
+  ofs << "Run" << endl << endl;
+  for (const auto& r : runs) {
+    ofs << r.first << endl;
+  }
+  ofs.filter().next();
+  ofs << "Iterations" << endl << endl;
+  for (const auto& r : runs) {
+    ofs << (size_t)r.second.iterations << endl;
+  }
+  ofs.filter().next();
+  ofs << "Iterations/s" << endl << endl;
+  for (const auto& r : runs) {
+    ofs << (size_t)r.second.iterations_per_sec << endl;
+  }
+  ofs.filter().next();
+  ofs << "Current" << endl << endl;
+  for (const auto& r : runs) {
+    ofs << (size_t)r.second.current_cost << endl;
+  }
+  ofs.filter().next();
+  ofs << "Lowest" << endl << endl;
+  for (const auto& r : runs) {
+    ofs << (size_t)r.second.best_yet_cost << endl;
+  }
+  ofs.filter().next();
+  ofs << "Correct" << endl << endl;
+  for (const auto& r : runs) {
+    ofs << (size_t)r.second.best_correct_cost << endl;
+  }
+  ofs.filter().next();
+  ofs << "Verified" << endl << endl;
+  for (const auto& r : runs) {
+    ofs << (size_t)r.second.verifications << " (" << r.second.verification_time << "s)" << endl;
+  }
+  ofs.filter().next();
+  ofs << "Last Update" << endl << endl;
+  for (const auto& r : runs) {
+    ofs << (size_t)(now - r.second.time) << "s ago" << endl;
+  }
+  ofs.filter().next();
+  ofs << "Status" << endl << endl;
+  for (const auto& r : runs) {
+    if (r.second.final) {
+      ofs << "finished" << endl;
+    } else if (r.second.elapsed - r.second.improved >= stall_arg.value()) {
+      ofs << "stalled " << (size_t)(r.second.elapsed - r.second.improved) << "s" << endl;
+    } else {
+      ofs << "running" << endl;
+    }
+  }
+  ofs.filter().done();
+
+  return 0;
+}
@@ -13,8 +13,11 @@
 // limitations under the License.
 
 #include <chrono>
+#include <fstream>
 #include <iostream>
+#include <memory>
 #include <sys/time.h>
+#include <unistd.h>
 
 #include "src/ext/cpputil/include/command_line/command_line.h"
 #include "src/ext/cpputil/include/io/column.h"
@@ -30,13 +33,18 @@
 #include "src/search/new_best_correct_callback.h"
 #include "src/search/statistics_callback.h"
 #include "src/search/failed_verification_action.h"
+#include "src/search/metrics_stream.h"
 #include "src/search/postprocessing.h"
+#include "src/search/trace_recorder.h"
 
 #include "tools/args/search.inc"
 #include "tools/args/target.inc"
+#include "tools/args/trace.inc"
 #include "tools/gadgets/cost_function.h"
 #include "tools/gadgets/correctness_cost.h"
+#include "tools/gadgets/enumerative.h"
 #include "tools/gadgets/functions.h"
+#include "tools/gadgets/pareto_archive.h"
 #include "tools/gadgets/sandbox.h"
 #include "tools/gadgets/search.h"
 #include "tools/gadgets/search_state.h"
@@ -83,6 +91,18 @@ auto& stat_int =
   .description("Number of iterations between statistics updates")
   .default_val(1000000);
 
+auto& metrics_arg =
+  ValueArg<string>::create("metrics")
+  .usage("<path/to/file.jsonl|unix:path/to/socket>")
+  .description("Append a JSON record to a file or send it to a unix socket at every statistics update")
+  .default_val("");
+
+auto& metrics_id_arg =
+  ValueArg<string>::create("metrics_id")
+  .usage("<string>")
+  .description("Identifier for this run in metrics records; defaults to host:pid")
+  .default_val("");
+
 auto& automation_heading = Heading::create("Automation Options:");
 
 auto& timeout_iterations_arg =
@@ -119,6 +139,17 @@ auto& no_progress_update_arg =
   cpputil::FlagArg::create("no_progress_update")
   .description("Don't show a progress update whenever a new best program is discovered");
 
+// Global so that it is flushed when we exit early
+ofstream trace_ofs;
+
+// Global so that the final update can write to it
+MetricsStream metrics;
+// Global so that the final update can write it out, if search keeps one
+ParetoArchive* pareto = nullptr;
+// Verifications of new best correct rewrites, and the time spent on them
+static size_t num_verifications = 0;
+static duration<double> verification_time = duration<double>(0.0);
+
 void sep(ostream& os, string c = "*") {
   for (size_t i = 0; i < 80; ++i) {
     os << c;
@@ -241,6 +272,12 @@ void scb(const StatisticsCallbackData& data, void* arg) {
 
   os << endl << endl;
   sep(os);
+
+  if (metrics.is_open()) {
+    metrics.write(data, {{"verifications", num_verifications}, {"verification_time", verification_time.count()},
+      {"rss", Validator::current_rss()}, {"peak_rss", Validator::peak_rss()}
+    });
+  }
 }
 
 void show_final_update(const StatisticsCallbackData& stats, SearchState& state,
@@ -256,6 +293,7 @@ void show_final_update(const StatisticsCallbackData& stats, SearchState& state,
   Console::msg() << "Number of attempted searches:  " << total_restarts << endl;
   Console::msg() << "Total search time:             " << search_elapsed.count() << "s" << endl;
   Console::msg() << "Total time:                    " << total_elapsed.count() << "s" << endl;
+  Console::msg() << "Peak memory:                   " << (Validator::peak_rss() >> 20) << "MB" << endl;
   Console::msg() << endl << "Statistics of last search" << endl << endl;
   // get the state first (because it updates some static variables)
   ostringstream stream;
@@ -266,6 +304,19 @@ void show_final_update(const StatisticsCallbackData& stats, SearchState& state,
   Console::msg() << endl << endl;
   sep(Console::msg(), "#");
 
+  if (pareto != nullptr) {
+    ofstream pareto_ofs(pareto_out_arg.value());
+    pareto->write(pareto_ofs);
+    Console::msg() << "Wrote " << pareto->size() << " Pareto-optimal rewrite(s) to " << pareto_out_arg.value() << endl << endl;
+  }
+
+  if (metrics.is_open()) {
+    metrics.write(stats, {{"verifications", num_verifications}, {"verification_time", verification_time.count()},
+      {"total_iterations", total_iterations}, {"total_time", total_elapsed.count()}, {"verified", verified},
+      {"rss", Validator::current_rss()}, {"peak_rss", Validator::peak_rss()}, {"final", 1}
+    });
+  }
+
   // output machine-readable result
   if (machine_output_arg.has_been_provided()) {
     auto code_to_string = [](x64asm::Code code) {
@@ -325,7 +376,10 @@ void new_best_correct_callback(const NewBestCorrectCallbackData& data, void* arg
     }
 
     // verify the new best correct rewrite
+    const auto verify_start = steady_clock::now();
     const auto verified = verifier.verify(target, res);
+    verification_time += duration_cast<duration<double>>(steady_clock::now() - verify_start);
+    num_verifications++;
 
     if (verifier.has_error()) {
       Console::msg() << "The verifier encountered an error: " << verifier.error() << endl << endl;
@@ -402,6 +456,7 @@ int main(int argc, char** argv) {
   TransformPoolsGadget transform_pools(target, aux_fxns, seed);
   WeightedTransformGadget transform(transform_pools, seed);
   SearchGadget search(&transform, seed);
+  EnumerativeSearchGadget enumerator(transform_pools);
 
   TestSetGadget test_set(seed);
   SandboxGadget test_sb(test_set, aux_fxns);
@@ -409,9 +464,30 @@ int main(int argc, char** argv) {
   PerformanceSetGadget perf_set(seed);
   SandboxGadget perf_sb(perf_set, aux_fxns);
 
+  // Measured costs count the runs of their sandbox, so every objective gets its own copy
+  ParetoArchiveGadget pareto_archive(target, &training_sb, perf_sb);
+  if (pareto_archive.enabled()) {
+    pareto = &pareto_archive;
+    search.set_pareto_archive(pareto);
+  }
+
   CorrectnessCostGadget holdout_fxn(target, &test_sb);
   VerifierGadget verifier(test_sb, holdout_fxn);
 
+  if (metrics_arg.value() != "") {
+    if (!metrics.open(metrics_arg.value())) {
+      Console::error(1) << metrics.get_error() << endl;
+    }
+    auto id = metrics_id_arg.value();
+    if (id == "") {
+      char host[256] = {0};
+      gethostname(host, sizeof(host) - 1);
+      id = string(host) + ":" + to_string(getpid());
+    }
+    metrics.set_run_id(id);
+    search.set_phase_timing(true);
+  }
+
   ScbArg scb_arg {&Console::msg(), nullptr};
   search.set_statistics_callback(scb, &scb_arg)
   .set_statistics_interval(stat_int);
@@ -420,6 +496,20 @@ int main(int argc, char** argv) {
   }
   auto nbcc_data = pair<VerifierGadget&, TargetGadget&>(verifier, target);
   search.set_new_best_correct_callback(new_best_correct_callback, &nbcc_data);
+  if (snapshot_interval_arg.value() > 0) {
+    search.set_snapshot_sandbox(&training_sb)
+    .set_snapshot_lag(snapshot_lag_arg);
+  }
+
+  unique_ptr<TraceRecorder> trace;
+  if (trace_arg.value() != "") {
+    trace_ofs.open(trace_arg.value(), ios::out | ios::binary);
+    if (!trace_ofs.is_open()) {
+      Console::error(1) << "Unable to open trace file " << trace_arg.value() << endl;
+    }
+    trace.reset(new TraceRecorder(trace_ofs));
+    search.set_trace_recorder(trace.get());
+  }
 
   size_t total_iterations = 0;
   size_t total_restarts = 0;
@@ -485,10 +575,29 @@ int main(int argc, char** argv) {
     }
 
     const auto start_search = steady_clock::now();
-    search.run(target, fxn, init_arg, state, aux_fxns);
+    if (enumerate_arg.value()) {
+      enumerator.set_timeout_itr(std::min(cur_timeout, timeout_left));
+      if (timeout_seconds_arg.value() != 0) {
+        enumerator.set_timeout_sec(duration<double>(timeout_seconds_arg.value()) - duration_cast<duration<double>>(steady_clock::now() - start));
+      }
+      enumerator.run(target, fxn, training_sb, state);
+      total_iterations += enumerator.get_iterations();
+      if (state.success) {
+        Console::msg() << "Enumerated a correct rewrite after " << enumerator.get_iterations() << " programs." << endl << endl;
+      } else {
+        Console::msg() << "Enumeration found no rewrite after " << enumerator.get_iterations() << " programs; falling back to search." << endl << endl;
+      }
+    }
+    if (!state.success) {
+      search.run(target, fxn, init_arg, state, aux_fxns);
+      total_iterations += search.get_statistics().iterations;
+    }
     search_elapsed += duration_cast<duration<double>>(steady_clock::now() - start_search);
+    // Covers the target and anything the enumerator found
+    if (pareto != nullptr) {
+      pareto->insert(state.best_correct);
+    }
 
-    total_iterations += search.get_statistics().iterations;
     total_restarts++;
 
     if (state.interrupted) {
@@ -498,7 +607,10 @@ int main(int argc, char** argv) {
       exit(1);
     }
 
+    const auto verify_start = steady_clock::now();
     const auto verified = verifier.verify(target, state.best_correct);
+    verification_time += duration_cast<duration<double>>(steady_clock::now() - verify_start);
+    num_verifications++;
 
     if (verifier.has_error()) {
       Console::msg() << "The verifier encountered an error:" << endl;
@@ -527,9 +639,12 @@ int main(int argc, char** argv) {
     }
 
     if (!verified && verifier.counter_examples_available() && failed_verification_action.value() == FailedVerificationAction::ADD_COUNTEREXAMPLE) {
-      Console::msg() << "Restarting search using new testcase (counterexample from verifier):" << endl << endl;
-      Console::msg() << verifier.get_counter_examples()[0] << endl << endl;
-      training_sb.insert_input(verifier.get_counter_examples()[0]);
+      const auto cegs = verifier.get_counter_examples();
+      Console::msg() << "Restarting search using " << cegs.size() << " new testcase(s) (counterexamples from verifier):" << endl << endl;
+      for (const auto& ceg : cegs) {
+        Console::msg() << ceg << endl << endl;
+        training_sb.insert_input(ceg);
+      }
     } else {
       Console::msg() << "Restarting search" << endl;
     }
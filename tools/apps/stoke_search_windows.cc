@@ -0,0 +1,287 @@
+// Copyright 2013-2016 Stanford University
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "src/ext/cpputil/include/command_line/command_line.h"
+#include "src/ext/cpputil/include/io/console.h"
+#include "src/ext/cpputil/include/io/fail.h"
+#include "src/ext/cpputil/include/signal/debug_handler.h"
+
+#include "src/cfg/cfg_transforms.h"
+#include "src/search/window_partition.h"
+#include "src/tunit/tunit.h"
+
+#include "tools/args/search.inc"
+#include "tools/args/target.inc"
+#include "tools/gadgets/cost_function.h"
+#include "tools/gadgets/correctness_cost.h"
+#include "tools/gadgets/functions.h"
+#include "tools/gadgets/sandbox.h"
+#include "tools/gadgets/search.h"
+#include "tools/gadgets/seed.h"
+#include "tools/gadgets/solver.h"
+#include "tools/gadgets/target.h"
+#include "tools/gadgets/testcases.h"
+#include "tools/gadgets/transform_pools.h"
+#include "tools/gadgets/validator.h"
+#include "tools/gadgets/verifier.h"
+#include "tools/gadgets/weighted_transform.h"
+
+using namespace cpputil;
+using namespace std;
+using namespace stoke;
+
+auto& io = Heading::create("Output Options:");
+auto& out = ValueArg<string>::create("out")
+            .alternate("o")
+            .usage("<path/to/file.s>")
+            .description("File to write the stitched result to")
+            .default_val("result.s");
+
+auto& window_heading = Heading::create("Window Options:");
+auto& window_min_arg = ValueArg<size_t>::create("window_min")
+                       .usage("<int>")
+                       .description("Smallest number of instructions worth searching in a window")
+                       .default_val(2);
+auto& window_max_arg = ValueArg<size_t>::create("window_max")
+                       .usage("<int>")
+                       .description("Largest number of instructions to put in a window")
+                       .default_val(16);
+auto& windows_arg = ValueArg<size_t>::create("windows")
+                    .usage("<int>")
+                    .description("Number of hottest windows to search, or 0 to search every window")
+                    .default_val(0);
+auto& window_states_arg = ValueArg<size_t>::create("window_testcases")
+                          .usage("<int>")
+                          .description("Maximum number of profiled machine states to use as testcases for a window")
+                          .default_val(32);
+auto& window_timeout_arg = ValueArg<size_t>::create("window_timeout")
+                           .usage("<int>")
+                           .description("Number of search iterations to spend on each window")
+                           .default_val(100000);
+auto& window_jobs_arg = ValueArg<size_t>::create("window_jobs")
+                        .usage("<int>")
+                        .description("Number of windows to search concurrently (each in its own process)")
+                        .default_val(1);
+
+/** A running search over a single window. */
+struct Job {
+  size_t window;
+  pid_t pid;
+  int fd;
+};
+
+/** Searches one window and writes an improved rewrite (if any) to fd. */
+void search_window(const Cfg& wcfg, const CpuStates& tcs, vector<TUnit>& aux_fxns,
+                   SeedGadget& seed, int fd) {
+  // Anything the window writes to memory may be read later in the function.
+  stack_out_arg.value() = true;
+  heap_out_arg.value() = true;
+
+  SandboxGadget sb(tcs, aux_fxns);
+  sb.set_abi_check(false);
+
+  CostFunctionGadget fxn(wcfg, &sb, &sb);
+  TransformPoolsGadget pools(wcfg, aux_fxns, seed);
+  WeightedTransformGadget transform(pools, seed);
+  SearchGadget search(&transform, seed);
+  search.set_timeout_itr(window_timeout_arg.value());
+
+  const auto start_cost = fxn(wcfg);
+  SearchState state(wcfg, wcfg, Init::TARGET, max_instrs_arg.value());
+  search.run(wcfg, fxn, Init::TARGET, state, aux_fxns);
+
+  if (state.success && state.best_correct_cost < start_cost.second) {
+    CfgTransforms::remove_nop(state.best_correct);
+    ostringstream oss;
+    oss << state.best_correct.get_function();
+    const auto s = oss.str();
+    for (size_t written = 0; written < s.length();) {
+      const auto n = write(fd, s.c_str() + written, s.length() - written);
+      if (n <= 0) {
+        break;
+      }
+      written += n;
+    }
+  }
+}
+
+/** Reads a child's output until it exits; returns true if it produced a rewrite. */
+bool finish_job(const Job& job, Cfg& rewrite) {
+  string s;
+  char buf[4096];
+  for (ssize_t n; (n = read(job.fd, buf, sizeof(buf))) > 0;) {
+    s.append(buf, n);
+  }
+  close(job.fd);
+  waitpid(job.pid, nullptr, 0);
+
+  if (s.empty()) {
+    return false;
+  }
+
+  istringstream iss(s);
+  TUnit fxn;
+  iss >> fxn;
+  if (failed(iss)) {
+    Console::warn() << "Unable to parse the rewrite for window " << job.window << endl;
+    return false;
+  }
+  rewrite = Cfg(fxn, rewrite.def_ins(), rewrite.live_outs());
+  return true;
+}
+
+int main(int argc, char** argv) {
+  CommandLineConfig::strict_with_convenience(argc, argv);
+  DebugHandler::install_sigsegv();
+  DebugHandler::install_sigill();
+
+  SeedGadget seed;
+  FunctionsGadget aux_fxns;
+  TargetGadget target(aux_fxns, false);
+
+  TrainingSetGadget training_set(seed);
+  SandboxGadget training_sb(training_set, aux_fxns);
+
+  TestSetGadget test_set(seed);
+  SandboxGadget test_sb(test_set, aux_fxns);
+
+  CorrectnessCostGadget holdout_fxn(target, &test_sb);
+  VerifierGadget verifier(test_sb, holdout_fxn);
+
+  // Find the windows and rank them by how much work the target does inside each one.
+  auto windows = WindowPartition()
+                 .set_min_size(window_min_arg.value())
+                 .set_max_size(window_max_arg.value())(target);
+  vector<CpuStates> states;
+  WindowPartition::profile(training_sb, target, windows, states, window_states_arg.value());
+
+  vector<size_t> order;
+  for (size_t i = 0, ie = windows.size(); i < ie; ++i) {
+    if (windows[i].hits > 0) {
+      order.push_back(i);
+    }
+  }
+  stable_sort(order.begin(), order.end(), [&windows](size_t a, size_t b) {
+    return windows[a].hits * windows[a].size() > windows[b].hits * windows[b].size();
+  });
+  if (windows_arg.value() > 0 && order.size() > windows_arg.value()) {
+    order.resize(windows_arg.value());
+  }
+
+  Console::msg() << "Searching " << order.size() << " of " << windows.size() << " windows" << endl;
+
+  // Search each window in a separate process.  Sandbox and Search both keep
+  // process-wide signal state, so threads are not an option here.
+  vector<Cfg> window_cfgs;
+  for (size_t i = 0, ie = windows.size(); i < ie; ++i) {
+    window_cfgs.push_back(WindowPartition::extract(target, windows[i], x64asm::Label(".window_" + to_string(i))));
+  }
+
+  vector<size_t> improved;
+  vector<Cfg> rewrites = window_cfgs;
+  deque<Job> running;
+  const auto jobs = max((size_t)1, window_jobs_arg.value());
+
+  auto reap = [&]() {
+    const auto job = running.front();
+    running.pop_front();
+    if (finish_job(job, rewrites[job.window])) {
+      improved.push_back(job.window);
+    }
+  };
+
+  for (auto w : order) {
+    if (running.size() >= jobs) {
+      reap();
+    }
+
+    int fds[2];
+    if (pipe(fds) != 0) {
+      Console::error(1) << "Unable to create a pipe for window " << w << endl;
+    }
+
+    const auto pid = fork();
+    if (pid < 0) {
+      Console::error(1) << "Unable to fork a search for window " << w << endl;
+    } else if (pid == 0) {
+      close(fds[0]);
+      search_window(window_cfgs[w], states[w], aux_fxns, seed, fds[1]);
+      close(fds[1]);
+      _exit(0);
+    }
+
+    close(fds[1]);
+    running.push_back({w, pid, fds[0]});
+  }
+  while (!running.empty()) {
+    reap();
+  }
+
+  sort(improved.begin(), improved.end());
+  Console::msg() << "Found improvements in " << improved.size() << " windows" << endl;
+
+  // Try everything at once; if that doesn't verify, accept windows one at a time.
+  auto stitch = [&](const vector<size_t>& ws) {
+    vector<Window> sel;
+    vector<Cfg> rws;
+    for (auto w : ws) {
+      sel.push_back(windows[w]);
+      rws.push_back(rewrites[w]);
+    }
+    return WindowPartition::stitch(target, sel, rws);
+  };
+
+  vector<size_t> accepted;
+  auto result = stitch(improved);
+  if (!improved.empty() && verifier.verify(target, result)) {
+    accepted = improved;
+  } else if (!improved.empty()) {
+    Console::msg() << "Unable to verify all windows together; checking them one at a time" << endl;
+    for (auto w : improved) {
+      auto candidate = accepted;
+      candidate.push_back(w);
+      const auto cfg = stitch(candidate);
+      if (verifier.verify(target, cfg)) {
+        accepted = candidate;
+      } else {
+        Console::msg() << "Rejected the rewrite for window " << w << endl;
+      }
+    }
+    result = stitch(accepted);
+  }
+
+  if (verifier.has_error()) {
+    Console::msg() << "The verifier encountered an error:" << endl;
+    Console::msg() << verifier.error() << endl;
+  }
+
+  Console::msg() << "Accepted rewrites for " << accepted.size() << " windows" << endl;
+
+  ofstream ofs(out.value());
+  ofs << result.get_function();
+
+  return 0;
+}
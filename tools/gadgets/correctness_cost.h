@@ -18,15 +18,23 @@
 #include "src/cfg/cfg.h"
 #include "src/cost/correctness.h"
 #include "src/cost/cost_function.h"
+#include "src/ext/cpputil/include/io/console.h"
 #include "src/sandbox/sandbox.h"
 #include "tools/args/correctness.inc"
 #include "tools/args/in_out.inc"
+#include "tools/gadgets/seed.h"
 
 namespace stoke {
 
 class CorrectnessCostGadget : public CorrectnessCost {
 public:
   CorrectnessCostGadget(const Cfg& target, Sandbox* sb) : CorrectnessCost(sb) {
+    // Cutpoint traces are taken over every testcase, so the two don't compose
+    if (cutpoints_arg.value() && minibatch_arg.value() > 0) {
+      cpputil::Console::error(1) << "--cutpoints can't be combined with --minibatch." << std::endl;
+    }
+    set_cutpoints(cutpoints_arg);
+    set_reference_cache(reference_cache_arg || reference_cache_dir_arg.value() != "", reference_cache_dir_arg.value());
     set_target(target, stack_out_arg, heap_out_arg);
 
     set_distance(distance_arg);
@@ -35,6 +43,8 @@ public:
     set_penalty(misalign_penalty_arg, sig_penalty_arg);
     set_min_ulp(min_ulp_arg);
     set_reduction(reduction_arg);
+    set_minibatch(minibatch_arg, minibatch_beta_arg);
+    set_seed(SeedGadget());
   }
 };
 
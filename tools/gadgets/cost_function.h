@@ -24,7 +24,9 @@
 #include "src/cost/sseavx.h"
 #include "src/cost/nongoal.h"
 #include "tools/args/cost.inc"
+#include "tools/gadgets/avx_transition_cost.h"
 #include "tools/gadgets/correctness_cost.h"
+#include "tools/gadgets/frontend_cost.h"
 #include "tools/gadgets/latency_cost.h"
 #include "tools/gadgets/nongoal_cost.h"
 
@@ -43,20 +45,43 @@ public:
     return (*fxn_)(cfg);
   }
 
-private:
+  bool need_test_sandbox() {
+    return fxn_->need_test_sandbox();
+  }
 
-  CostFunction* fxn_;
+  bool need_perf_sandbox() {
+    return fxn_->need_perf_sandbox();
+  }
 
-  static CostFunction* build_fxn(const Cfg& target, Sandbox* test_sb, Sandbox* perf_sb) {
+  /** Set whether the wrapped function runs the sandboxes itself or the client does. */
+  CostFunctionGadget& set_run_sandboxes(bool test, bool perf) {
+    fxn_->set_run_test_sandbox(test);
+    fxn_->set_run_perf_sandbox(perf);
+    return *this;
+  }
 
+  /** Returns fresh instances of the cost functions that expressions can name. */
+  static CostParser::SymbolTable symbol_table(const Cfg& target, Sandbox* test_sb) {
     CostParser::SymbolTable st;
+    st["avx_transitions"] = new AvxTransitionCostGadget();
     st["binsize"] =      new BinSizeCost();
     st["correctness"] =  new CorrectnessCostGadget(target, test_sb);
+    st["frontend"] =     new FrontEndCostGadget();
     st["latency"] =      new LatencyCostGadget();
     st["measured"] =     new MeasuredCost();
     st["size"] =         new SizeCost();
     st["sseavx"] =       new SseAvxCost();
     st["nongoal"] =      new NonGoalCostGadget(target);
+    return st;
+  }
+
+private:
+
+  CostFunction* fxn_;
+
+  static CostFunction* build_fxn(const Cfg& target, Sandbox* test_sb, Sandbox* perf_sb) {
+
+    auto st = symbol_table(target, test_sb);
 
     CostParser cost_p(cost_function_arg.value(), st);
     auto cost_fxn = cost_p.run();
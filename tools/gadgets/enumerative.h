@@ -0,0 +1,35 @@
+// Copyright 2013-2016 Stanford University
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef STOKE_TOOLS_GADGETS_ENUMERATIVE_H
+#define STOKE_TOOLS_GADGETS_ENUMERATIVE_H
+
+#include "src/search/enumerative.h"
+#include "src/transform/pools.h"
+#include "tools/args/enumerative.inc"
+
+namespace stoke {
+
+class EnumerativeSearchGadget : public EnumerativeSearch {
+public:
+  EnumerativeSearchGadget(TransformPools& pools) : EnumerativeSearch(pools) {
+    set_max_length(enumerate_length_arg.value());
+    set_max_programs(enumerate_programs_arg.value());
+    set_jobs(enumerate_jobs_arg.value());
+  }
+};
+
+} // namespace stoke
+
+#endif
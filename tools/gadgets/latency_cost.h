@@ -24,6 +24,7 @@ namespace stoke {
 class LatencyCostGadget : public LatencyCost {
 public:
   LatencyCostGadget() : LatencyCost() {
+    set_profile(latency_profile_arg.value());
   }
 };
 
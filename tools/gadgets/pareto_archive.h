@@ -0,0 +1,93 @@
+// Copyright 2013-2016 Stanford University
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef STOKE_TOOLS_GADGETS_PARETO_ARCHIVE_H
+#define STOKE_TOOLS_GADGETS_PARETO_ARCHIVE_H
+
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "src/ext/cpputil/include/io/console.h"
+
+#include "src/cost/cost_parser.h"
+#include "src/search/pareto_archive.h"
+#include "tools/args/pareto.inc"
+#include "tools/gadgets/cost_function.h"
+
+namespace stoke {
+
+class ParetoArchiveGadget : public ParetoArchive {
+public:
+  /** Every objective gets its own copy of perf_sb, so that measured costs only
+    count their own runs. */
+  ParetoArchiveGadget(const Cfg& target, Sandbox* test_sb, const Sandbox& perf_sb) : ParetoArchive() {
+    set_capacity(pareto_size_arg.value());
+
+    std::istringstream iss(pareto_objectives_arg.value());
+    std::string objective;
+    while (std::getline(iss, objective, ',')) {
+      if (objective.empty()) {
+        continue;
+      }
+      // Every objective gets its own cost functions, since some keep state between runs
+      symbol_tables_.push_back(CostFunctionGadget::symbol_table(target, test_sb));
+      CostParser p(objective, symbol_tables_.back());
+      auto fxn = p.run();
+      if (p.get_error().size()) {
+        cpputil::Console::error(1) << "Error parsing pareto objective '" << objective << "': " << p.get_error() << std::endl;
+      }
+      if (fxn == NULL) {
+        cpputil::Console::error(1) << "Unknown error parsing pareto objective '" << objective << "'." << std::endl;
+      }
+      perf_sbs_.emplace_back(new Sandbox(perf_sb));
+      fxn->setup_test_sandbox(test_sb).setup_perf_sandbox(perf_sbs_.back().get());
+      roots_.push_back(fxn);
+      add_objective(objective, fxn);
+    }
+  }
+  /** The gadget owns its cost functions and sandboxes. */
+  ParetoArchiveGadget(const ParetoArchiveGadget& rhs) = delete;
+  ParetoArchiveGadget& operator=(const ParetoArchiveGadget& rhs) = delete;
+
+  /** Frees every cost function, including the ones no objective named. */
+  ~ParetoArchiveGadget() {
+    for (auto fxn : roots_) {
+      delete fxn;
+    }
+    for (auto& st : symbol_tables_) {
+      for (auto& entry : st) {
+        delete entry.second;
+      }
+    }
+  }
+
+  /** Were any objectives given? */
+  bool enabled() const {
+    return !get_objectives().empty();
+  }
+
+private:
+  /** The cost functions that each objective could name. */
+  std::vector<CostParser::SymbolTable> symbol_tables_;
+  /** The parsed objectives. */
+  std::vector<CostFunction*> roots_;
+  /** A performance sandbox for each objective. */
+  std::vector<std::unique_ptr<Sandbox>> perf_sbs_;
+};
+
+} // namespace stoke
+
+#endif
@@ -34,6 +34,9 @@ public:
     set_abi_check(abi_check_arg);
     set_stack_check(stack_check_arg);
     set_max_jumps(max_jumps_arg);
+    set_huge_pages(huge_pages_arg);
+    set_native(native_arg);
+    set_snapshot_interval(snapshot_interval_arg);
 
     for (const auto& fxn : aux_fxns) {
       insert_function(Cfg(fxn, x64asm::RegSet::empty(), x64asm::RegSet::empty()));
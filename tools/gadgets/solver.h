@@ -60,7 +60,7 @@ public:
   bool get_model_bool(const std::string& var) {
     return solver_->get_model_bool(var);
   }
-  std::pair<std::map<uint64_t, cpputil::BitVector>, uint8_t>
+  std::pair<std::map<uint64_t, cpputil::BitVector>, uint64_t>
   get_model_array(const std::string& var, uint16_t key_size, uint16_t value_size) {
     return solver_->get_model_array(var, key_size, value_size);
   }
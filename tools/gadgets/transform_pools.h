@@ -94,6 +94,12 @@ public:
     // Set memory read/write, and add memory opcodes, immediates.
     add_target(cfg);
 
+    // Bias opcodes towards those that appear in good rewrites of similar targets
+    const auto& model = opcode_model_arg.value();
+    for (const auto& w : model.get_weights(cfg.get_code(), opcode_model_max_weight_arg.value())) {
+      set_opcode_bias(w.first, w.second);
+    }
+
     // Set cpu flags to choose opcodes from.
     set_flags(cpu_flags());
 
@@ -102,6 +102,8 @@ private:
       return ObligationChecker::AliasStrategy::FLAT;
     } else if (alias == "arm") {
       return ObligationChecker::AliasStrategy::ARM;
+    } else if (alias == "word") {
+      return ObligationChecker::AliasStrategy::WORD;
     } else {
       std::cerr << "Unrecognized alias strategy \"" << alias << "\"" << std::endl;
       exit(1);
@@ -114,7 +116,11 @@ private:
       bv->set_bound(bound_arg.value());
       bv->set_alias_strategy(parse_alias());
       bv->set_no_bailout(no_bailout_arg.value());
+      bv->set_deepening(bound_deepening_arg.value(), std::chrono::duration<double>(bound_timeout_arg.value()));
       bv->set_nacl(verify_nacl_arg);
+      bv->set_abstract_nonlinear(abstract_nonlinear_arg.value());
+      bv->set_max_counterexamples(max_counterexamples_arg.value());
+      bv->set_memory_budget(memory_budget_arg.value() << 20);
       return bv;
     } else if (s == "ddec") {
       auto ddec = new DdecValidator(*solver_);
@@ -122,6 +128,8 @@ private:
       ddec->set_alias_strategy(parse_alias());
       ddec->set_bound(bound_arg.value());
       ddec->set_nacl(verify_nacl_arg);
+      ddec->set_abstract_nonlinear(abstract_nonlinear_arg.value());
+      ddec->set_memory_budget(memory_budget_arg.value() << 20);
       return ddec;
     } else if (s == "hold_out") {
       return new HoldOutVerifier(fxn);
@@ -0,0 +1,38 @@
+// Copyright 2013-2016 Stanford University
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef STOKE_TOOLS_IO_OPCODE_MODEL_H
+#define STOKE_TOOLS_IO_OPCODE_MODEL_H
+
+#include <iostream>
+
+#include "src/transform/opcode_model.h"
+
+namespace stoke {
+
+struct OpcodeModelReader {
+  void operator()(std::istream& is, OpcodeModel& m) {
+    m.read_text(is);
+  }
+};
+
+struct OpcodeModelWriter {
+  void operator()(std::ostream& os, const OpcodeModel& m) {
+    m.write_text(os);
+  }
+};
+
+} // namespace stoke
+
+#endif